@@ -0,0 +1,378 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Purpose: measures the throughput of the decoder kernels, the header parser and the buffered stream reader.
+//          The kernels are measured for a range of image sizes, with odd and even widths and with padded rows.
+//          The header parser and the buffered stream reader read from memory (as from a memory mapped file): the
+//          benchmark has no Windows dependencies and also runs on Linux (see CMakeLists.txt).
+
+import std;
+
+import ascii_parser;
+import buffered_stream_reader;
+import pixel_conversion;
+import pnm_header;
+
+using std::byte;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::vector;
+using std::chrono::steady_clock;
+
+namespace {
+
+struct image_size final
+{
+    size_t width;
+    size_t height;
+};
+
+// Tiny images measure the overhead per row and the scalar tails, odd widths the partial bytes and SIMD tails at the end
+// of every row, large images the memory bandwidth.
+constexpr std::array image_sizes{image_size{4, 1},       image_size{5, 1},       image_size{7, 1},
+                                 image_size{64, 64},     image_size{63, 65},     image_size{1024, 1024},
+                                 image_size{1023, 1025}, image_size{4096, 4096}, image_size{4095, 4097},
+                                 image_size{16384, 16384}};
+
+constexpr size_t minimum_iterations{5};
+constexpr std::chrono::milliseconds minimum_duration{500};
+
+template<typename Function>
+[[nodiscard]] double measure_seconds_per_iteration(Function&& function)
+{
+    function(); // warm-up: page in the buffers.
+
+    size_t iterations{};
+    const auto start{steady_clock::now()};
+    auto elapsed{steady_clock::duration{}};
+    do
+    {
+        function();
+        ++iterations;
+        elapsed = steady_clock::now() - start;
+    } while (iterations < minimum_iterations || elapsed < minimum_duration);
+
+    return std::chrono::duration<double>(elapsed).count() / static_cast<double>(iterations);
+}
+
+void report(const std::string_view name, const size_t bytes, const size_t pixels, const double seconds)
+{
+    std::println("{:<64} {:>10.2f} GB/s {:>10.1f} Mpixels/s", name, static_cast<double>(bytes) / seconds / 1e9,
+                 static_cast<double>(pixels) / seconds / 1e6);
+}
+
+[[nodiscard]] vector<byte> create_random_bytes(const size_t size)
+{
+    vector<byte> bytes(size);
+    std::mt19937 generator{static_cast<uint32_t>(size)};
+    std::ranges::generate(bytes, [&generator] { return static_cast<byte>(generator()); });
+    return bytes;
+}
+
+/// <summary>
+/// Calls convert_row for every row of the image, once with packed destination rows and once with padded rows (as in
+/// the buffer passed to CopyPixels). The padding of 6 bytes moves the destination rows off their 16 byte alignment.
+/// </summary>
+template<typename ConvertRow>
+void benchmark_rows(const std::string_view name, const vector<byte>& source, const size_t width, const size_t height,
+                    const size_t destination_row_size, ConvertRow convert_row)
+{
+    const size_t source_row_size{source.size() / height};
+    for (const size_t padding : {size_t{0}, size_t{6}})
+    {
+        const size_t stride{destination_row_size + padding};
+        vector<byte> destination(stride * height);
+
+        const double seconds{measure_seconds_per_iteration([&] {
+            for (size_t row{}; row != height; ++row)
+            {
+                convert_row(source.data() + (row * source_row_size), destination.data() + (row * stride));
+            }
+        })};
+        report(std::format("{} (stride +{})", name, padding), source.size(), width * height, seconds);
+    }
+}
+
+[[nodiscard]] vector<byte> create_random_pixels(const size_t pixel_count, const uint32_t max_value)
+{
+    vector pixels{create_random_bytes(pixel_count)};
+    std::ranges::transform(pixels, pixels.begin(), [max_value](const byte pixel) {
+        return static_cast<byte>(std::to_integer<uint32_t>(pixel) % (max_value + 1));
+    });
+    return pixels;
+}
+
+/// <summary>
+/// Measures the packing of 2 and 4 bit gray pixels into crumbs and nibbles. 8 bit and 16 bit samples need no packing:
+/// a copy and a byte swap of the big endian samples are measured as the baseline of the same rows.
+/// </summary>
+void benchmark_pack(const size_t width, const size_t height)
+{
+    const vector crumbs{create_random_pixels(width * height, 3)};
+    const size_t crumb_row_size{(width + 3) / 4};
+    benchmark_rows("pack_to_crumbs scalar", crumbs, width, height, crumb_row_size,
+                   [width](const byte* source, byte* destination) {
+                       scalar::pack_row_to_crumbs(source, destination, width);
+                   });
+    benchmark_rows("pack_to_crumbs", crumbs, width, height, crumb_row_size,
+                   [width](const byte* source, byte* destination) { pack_row_to_crumbs(source, destination, width); });
+
+    const vector nibbles{create_random_pixels(width * height, 15)};
+    const size_t nibble_row_size{(width + 1) / 2};
+    benchmark_rows("pack_to_nibbles scalar", nibbles, width, height, nibble_row_size,
+                   [width](const byte* source, byte* destination) {
+                       scalar::pack_row_to_nibbles(source, destination, width);
+                   });
+    benchmark_rows("pack_to_nibbles", nibbles, width, height, nibble_row_size,
+                   [width](const byte* source, byte* destination) { pack_row_to_nibbles(source, destination, width); });
+
+    const vector bytes{create_random_bytes(width * height)};
+    benchmark_rows("8-bit copy", bytes, width, height, width,
+                   [width](const byte* source, byte* destination) { std::copy_n(source, width, destination); });
+
+    const vector words{create_random_bytes(width * height * 2)};
+    benchmark_rows("16-bit byte swap scalar", words, width, height, width * 2,
+                   [width](const byte* source, byte* destination) {
+                       scalar::convert_to_little_endian(source, reinterpret_cast<uint16_t*>(destination), width);
+                   });
+    benchmark_rows("16-bit byte swap", words, width, height, width * 2, [width](const byte* source, byte* destination) {
+        convert_to_little_endian(source, reinterpret_cast<uint16_t*>(destination), width);
+    });
+}
+
+/// <summary>
+/// Measures the conversion of big endian 16 bit samples: the exact rescale of the maximum values of 10 and 12 bit
+/// samples and of a maximum value that is not 2^n - 1, and the rescale to 8 bit samples. The plain byte swap is
+/// measured by benchmark_pack. The rescale of 8 bit samples is measured with the same image size.
+/// </summary>
+void benchmark_convert_to_little_endian(const size_t width, const size_t height)
+{
+    const vector source{create_random_bytes(width * height * 2)};
+    const auto to_samples{[](byte* destination) { return reinterpret_cast<uint16_t*>(destination); }};
+
+    for (const uint32_t max_value : {1023U, 4095U, 1000U})
+    {
+        benchmark_rows(std::format("convert_to_little_endian_and_rescale {} scalar", max_value), source, width, height,
+                       width * 2, [&](const byte* row, byte* destination) {
+                           scalar::convert_to_little_endian_and_rescale(row, to_samples(destination), width,
+                                                                        max_value);
+                       });
+        benchmark_rows(std::format("convert_to_little_endian_and_rescale {}", max_value), source, width, height,
+                       width * 2, [&](const byte* row, byte* destination) {
+                           convert_to_little_endian_and_rescale(row, to_samples(destination), width, max_value);
+                       });
+    }
+
+    benchmark_rows("convert_to_8_bit_and_rescale scalar", source, width, height, width,
+                   [width](const byte* row, byte* destination) {
+                       scalar::convert_to_8_bit_and_rescale(row, destination, width, 65535);
+                   });
+    benchmark_rows("convert_to_8_bit_and_rescale", source, width, height, width,
+                   [width](const byte* row, byte* destination) {
+                       convert_to_8_bit_and_rescale(row, destination, width, 65535);
+                   });
+
+    const vector bytes{create_random_pixels(width * height, 100)};
+    benchmark_rows("rescale_8_bit scalar", bytes, width, height, width, [width](const byte* row, byte* destination) {
+        scalar::rescale_8_bit(row, destination, width, 100);
+    });
+    benchmark_rows("rescale_8_bit", bytes, width, height, width,
+                   [width](const byte* row, byte* destination) { rescale_8_bit(row, destination, width, 100); });
+}
+
+/// <summary>
+/// Measures the RGB to BGR(A) swizzles against a plain copy of the RGB pixels (the native 24bppRGB output).
+/// </summary>
+void benchmark_rgb_swizzle(const size_t width, const size_t height)
+{
+    const size_t pixel_count{width * height};
+    const vector source{create_random_bytes(pixel_count * 3)};
+    vector<byte> destination(pixel_count * 4);
+
+    const double copy_seconds{
+        measure_seconds_per_iteration([&] { std::copy_n(source.data(), source.size(), destination.data()); })};
+    report("RGB copy", source.size(), pixel_count, copy_seconds);
+
+    for (const bool simd : {false, true})
+    {
+        const double bgr_seconds{measure_seconds_per_iteration([&] {
+            simd ? swap_red_and_blue(source.data(), destination.data(), pixel_count)
+                 : scalar::swap_red_and_blue(source.data(), destination.data(), pixel_count);
+        })};
+        report(simd ? "swap_red_and_blue" : "swap_red_and_blue scalar", source.size(), pixel_count, bgr_seconds);
+
+        const double bgra_seconds{measure_seconds_per_iteration([&] {
+            simd ? expand_rgb_to_bgra(source.data(), destination.data(), pixel_count)
+                 : scalar::expand_rgb_to_bgra(source.data(), destination.data(), pixel_count);
+        })};
+        report(simd ? "expand_rgb_to_bgra" : "expand_rgb_to_bgra scalar", source.size(), pixel_count, bgra_seconds);
+    }
+}
+
+/// <summary>
+/// Compares the 2 input paths of the decoder: the buffered stream reader copies the file data into its 1 MB read
+/// buffer before it is copied or converted into the destination, a memory mapped file is copied or converted directly.
+/// The file is kept in memory, as a stand-in for the page cache, to measure only the memory traffic of both paths.
+/// </summary>
+void benchmark_input_path(const size_t width, const size_t height)
+{
+    constexpr size_t read_buffer_size{1024 * 1024};
+    const size_t sample_count{width * height};
+    const vector file{create_random_bytes(sample_count * 2)};
+    vector<byte> read_buffer(read_buffer_size);
+    vector<byte> destination(file.size());
+
+    const auto read_buffered{[&](const size_t size, auto process) {
+        for (size_t offset{}; offset < size; offset += read_buffer_size)
+        {
+            const size_t chunk_size{std::min(read_buffer_size, size - offset)};
+            std::copy_n(file.data() + offset, chunk_size, read_buffer.data());
+            process(read_buffer.data(), offset, chunk_size);
+        }
+    }};
+
+    const double buffered_8_bit_seconds{measure_seconds_per_iteration([&] {
+        read_buffered(sample_count, [&](const byte* source, const size_t offset, const size_t size) {
+            std::copy_n(source, size, destination.data() + offset);
+        });
+    })};
+    report("8-bit input buffered stream reader", sample_count, sample_count, buffered_8_bit_seconds);
+
+    const double mapped_8_bit_seconds{
+        measure_seconds_per_iteration([&] { std::copy_n(file.data(), sample_count, destination.data()); })};
+    report("8-bit input memory mapped", sample_count, sample_count, mapped_8_bit_seconds);
+
+    const double buffered_16_bit_seconds{measure_seconds_per_iteration([&] {
+        read_buffered(file.size(), [&](const byte* source, const size_t offset, const size_t size) {
+            convert_to_little_endian(source, reinterpret_cast<uint16_t*>(destination.data() + offset), size / 2);
+        });
+    })};
+    report("16-bit input buffered stream reader", file.size(), sample_count, buffered_16_bit_seconds);
+
+    const double mapped_16_bit_seconds{measure_seconds_per_iteration([&] {
+        convert_to_little_endian(file.data(), reinterpret_cast<uint16_t*>(destination.data()), sample_count);
+    })};
+    report("16-bit input memory mapped", file.size(), sample_count, mapped_16_bit_seconds);
+}
+
+/// <summary>
+/// Measures reading a binary graymap (P5) from memory with the buffered stream reader, as a memory mapped file is
+/// read: the header is parsed and every row is read as a view and copied, or read into the destination.
+/// </summary>
+void benchmark_stream_reader(const size_t width, const size_t height)
+{
+    const std::string header{std::format("P5\n# benchmark\n{} {}\n255\n", width, height)};
+    vector file{create_random_bytes(header.size() + (width * height))};
+    std::ranges::transform(header, file.begin(), [](const char c) { return static_cast<byte>(c); });
+    vector<byte> destination(width * height);
+
+    const auto read_image{[&](buffered_stream_reader& reader) {
+        const pnm_header pnm{reader};
+        for (size_t row{}; row != pnm.height; ++row)
+        {
+            const auto pixels{reader.read_span(pnm.width)};
+            std::ranges::copy(pixels, destination.begin() + static_cast<std::ptrdiff_t>(row * width));
+        }
+    }};
+
+    const double span_seconds{measure_seconds_per_iteration([&] {
+        buffered_stream_reader reader{std::span<const byte>{file}};
+        read_image(reader);
+    })};
+    report("buffered_stream_reader read_span", file.size(), width * height, span_seconds);
+
+    const double bytes_seconds{measure_seconds_per_iteration([&] {
+        buffered_stream_reader reader{std::span<const byte>{file}};
+        const pnm_header pnm{reader};
+        for (size_t row{}; row != pnm.height; ++row)
+        {
+            reader.read_bytes(destination.data() + (row * width), width);
+        }
+    })};
+    report("buffered_stream_reader read_bytes", file.size(), width * height, bytes_seconds);
+}
+
+/// <summary>
+/// Measures the parsing of typical headers from memory: a short graymap header, a pixmap header with comments (as
+/// written by image editors) and a PAM header.
+/// </summary>
+void benchmark_header_parsing()
+{
+    constexpr size_t batch_size{10000};
+    constexpr std::array headers{
+        std::pair{"P5", std::string_view{"P5 640 480 255\n"}},
+        std::pair{"P6 with comments",
+                  std::string_view{"P6\n# CREATOR: GIMP PNM Filter Version 1.1\n# 16 bit\n4096 4096\n65535\n"}},
+        std::pair{"P7",
+                  std::string_view{"P7\nWIDTH 4096\nHEIGHT 4096\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n"}}};
+
+    for (const auto& [name, header] : headers)
+    {
+        const std::span bytes{reinterpret_cast<const byte*>(header.data()), header.size()};
+        const double seconds{measure_seconds_per_iteration([&] {
+            for (size_t i{}; i != batch_size; ++i)
+            {
+                buffered_stream_reader reader{bytes};
+                std::ignore = pnm_header{reader};
+            }
+        })};
+        std::println("{:<64} {:>10.2f} GB/s {:>10.1f} ns/header", std::format("pnm_header {}", name),
+                     static_cast<double>(bytes.size() * batch_size) / seconds / 1e9,
+                     seconds / static_cast<double>(batch_size) * 1e9);
+    }
+}
+
+/// <summary>
+/// Compares serial and parallel parsing of the pixel data of a plain (ASCII) pixmap, as written by exporters that
+/// only support the plain formats. The text is generated in memory, the size is printed with the results.
+/// </summary>
+void benchmark_ascii_parsing(const size_t width, const size_t height)
+{
+    const size_t sample_count{width * height * 3};
+    std::string text;
+    text.reserve(sample_count * 4);
+    std::mt19937 generator{static_cast<uint32_t>(sample_count)};
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        text += std::to_string(generator() % 256);
+        text += i % 12 == 11 ? '\n' : ' ';
+    }
+    const auto* first{reinterpret_cast<const byte*>(text.data())};
+    vector<uint16_t> samples(sample_count);
+
+    std::println("Plain pixmap {} x {}, {} MB", width, height, text.size() / (1024 * 1024));
+
+    const double serial_seconds{measure_seconds_per_iteration(
+        [&] { std::ignore = parse_decimal_values(first, text.size(), samples.data(), sample_count); })};
+    report("ASCII parse serial", text.size(), width * height, serial_seconds);
+
+    const size_t thread_count{std::max(std::thread::hardware_concurrency(), 1U)};
+    const double parallel_seconds{measure_seconds_per_iteration([&] {
+        std::ignore = parse_decimal_values_parallel(first, text.size(), samples.data(), sample_count, thread_count);
+    })};
+    report(std::format("ASCII parse parallel ({} threads)", thread_count), text.size(), width * height,
+           parallel_seconds);
+}
+
+} // namespace
+
+
+int main()
+{
+    for (const auto& [width, height] : image_sizes)
+    {
+        std::println("Image size {} x {}", width, height);
+        benchmark_pack(width, height);
+        benchmark_convert_to_little_endian(width, height);
+        benchmark_stream_reader(width, height);
+    }
+
+    std::println("Image size 4096 x 4096");
+    benchmark_rgb_swizzle(4096, 4096);
+    benchmark_input_path(4096, 4096);
+    benchmark_ascii_parsing(4096, 4096);
+
+    std::println("Headers");
+    benchmark_header_parsing();
+}
@@ -0,0 +1,19 @@
+# Copyright (c) Team CharLS.
+# SPDX-License-Identifier: BSD-3-Clause
+
+# Converts a C++ module unit to a header for toolchains without C++ modules: the module declaration becomes
+# #pragma once (or an #include of the interface for an implementation unit), imports become #includes of the
+# converted modules and the export keywords are removed. The conversion is line based and relies on the layout of the
+# module units of this repository: declarations and imports start at the beginning of a line.
+function(convert_module_to_header source destination)
+  file(READ ${source} content)
+  string(REGEX REPLACE "\nmodule;\n" "\n\n" content "${content}")
+  string(REGEX REPLACE "\nexport module [a-z_.]+;" "\n#pragma once" content "${content}")
+  string(REGEX REPLACE "\nmodule ([a-z_]+);" "\n#include \"\\1.hpp\"" content "${content}")
+  string(REGEX REPLACE "\nimport <([a-z_.]+)>;" "\n#include \"\\1\"" content "${content}")
+  string(REGEX REPLACE "\nimport ([a-z_.]+);" "\n#include \"\\1.hpp\"" content "${content}")
+  string(REGEX REPLACE "\nexport {" "\ninline namespace exported {" content "${content}")
+  string(REGEX REPLACE "\nexport " "\n" content "${content}")
+  file(WRITE ${destination} "${content}")
+  set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${source})
+endfunction()
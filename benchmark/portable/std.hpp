@@ -0,0 +1,66 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+// Replaces import std for toolchains without C++ modules (see CMakeLists.txt). Standard libraries without <format>
+// (GCC 12) or <print> (GCC 13) use the {fmt} library, which has the same format string syntax.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <version>
+
+#ifdef __cpp_lib_format
+#include <format>
+#else
+#include <fmt/format.h>
+
+namespace std {
+using fmt::format;
+}
+#endif
+
+#ifdef __cpp_lib_print
+#include <print>
+#else
+namespace std {
+
+template<typename... Args>
+void println(const std::string_view format_string, Args&&... args)
+{
+#ifdef __cpp_lib_format
+    const std::string line{std::vformat(format_string, std::make_format_args(args...))};
+#else
+    const std::string line{fmt::vformat(format_string, fmt::make_format_args(args...))};
+#endif
+    std::fputs(line.c_str(), stdout);
+    std::fputc('\n', stdout);
+}
+
+} // namespace std
+#endif
@@ -0,0 +1,39 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+// Replaces the Windows headers for the parts of the codec that the benchmark builds on other platforms: the integer
+// types and the error codes of the errors module. The values match the Windows SDK.
+
+#include <cstdint>
+
+using BYTE = std::uint8_t;
+using USHORT = std::uint16_t;
+using ULONG = std::uint32_t;
+using HRESULT = std::int32_t;
+
+#define S_OK static_cast<HRESULT>(0)
+#define E_FAIL static_cast<HRESULT>(0x80004005)
+#define E_POINTER static_cast<HRESULT>(0x80004003)
+#define E_INVALIDARG static_cast<HRESULT>(0x80070057)
+#define CLASS_E_NOAGGREGATION static_cast<HRESULT>(0x80040110)
+#define CLASS_E_CLASSNOTAVAILABLE static_cast<HRESULT>(0x80040111)
+#define SELFREG_E_CLASS static_cast<HRESULT>(0x80040201)
+
+#define WINCODEC_ERR_WRONGSTATE static_cast<HRESULT>(0x88982F04)
+#define WINCODEC_ERR_NOTINITIALIZED static_cast<HRESULT>(0x88982F0C)
+#define WINCODEC_ERR_CODECNOTHUMBNAIL static_cast<HRESULT>(0x88982F44)
+#define WINCODEC_ERR_PALETTEUNAVAILABLE static_cast<HRESULT>(0x88982F45)
+#define WINCODEC_ERR_CODECTOOMANYSCANLINES static_cast<HRESULT>(0x88982F46)
+#define WINCODEC_ERR_COMPONENTNOTFOUND static_cast<HRESULT>(0x88982F50)
+#define WINCODEC_ERR_BADIMAGE static_cast<HRESULT>(0x88982F60)
+#define WINCODEC_ERR_BADHEADER static_cast<HRESULT>(0x88982F61)
+#define WINCODEC_ERR_FRAMEMISSING static_cast<HRESULT>(0x88982F62)
+#define WINCODEC_ERR_BADSTREAMDATA static_cast<HRESULT>(0x88982F70)
+#define WINCODEC_ERR_STREAMWRITE static_cast<HRESULT>(0x88982F71)
+#define WINCODEC_ERR_STREAMREAD static_cast<HRESULT>(0x88982F72)
+#define WINCODEC_ERR_STREAMNOTAVAILABLE static_cast<HRESULT>(0x88982F73)
+#define WINCODEC_ERR_UNSUPPORTEDPIXELFORMAT static_cast<HRESULT>(0x88982F80)
+#define WINCODEC_ERR_UNSUPPORTEDOPERATION static_cast<HRESULT>(0x88982F81)
+#define WINCODEC_ERR_INSUFFICIENTBUFFER static_cast<HRESULT>(0x88982F8C)
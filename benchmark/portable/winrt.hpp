@@ -0,0 +1,54 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+// Replaces the error handling of C++/WinRT for the parts of the codec that the benchmark builds on other platforms.
+
+#include <cstdint>
+#include <exception>
+
+namespace winrt {
+
+struct hresult final
+{
+    std::int32_t value{};
+
+    constexpr hresult() noexcept = default;
+
+    constexpr hresult(const std::int32_t result) noexcept : value{result}
+    {
+    }
+
+    constexpr operator std::int32_t() const noexcept
+    {
+        return value;
+    }
+};
+
+struct hresult_error final : std::exception
+{
+    explicit hresult_error(const hresult result) noexcept : code{result}
+    {
+    }
+
+    [[nodiscard]] const char* what() const noexcept override
+    {
+        return "hresult_error";
+    }
+
+    hresult code;
+};
+
+[[noreturn]] inline void throw_hresult(const hresult result)
+{
+    throw hresult_error{result};
+}
+
+inline void check_hresult(const hresult result)
+{
+    if (result < 0)
+        throw_hresult(result);
+}
+
+} // namespace winrt
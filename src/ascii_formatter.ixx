@@ -0,0 +1,152 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module ascii_formatter;
+
+import std;
+
+// Purpose: formats the pixel values of the plain (ASCII) formats as decimal text, many values per call, without
+//          a call to a formatting function per value. This module only depends on the C++ standard library.
+
+using std::byte;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+
+/// <summary>
+/// Maximum number of characters of a line of a plain Netpbm file (without the line feed).
+/// </summary>
+export constexpr size_t max_line_length{70};
+
+/// <summary>
+/// Returns the size of the destination buffer that format_decimal_values needs for count values.
+/// </summary>
+export [[nodiscard]] constexpr size_t max_formatted_size(const size_t count) noexcept
+{
+    // 5 digits and a separator per value. The digits are stored 8 bytes at a time: the last store can write past
+    // the last digit.
+    return (count * 6) + 8;
+}
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little,
+              "The first character of a word must be its least significant byte");
+
+/// <summary>
+/// The 2 characters of the decimal values 0 to 99, the first character in the low byte.
+/// </summary>
+constexpr auto digit_pairs{[] {
+    std::array<uint16_t, 100> pairs{};
+    for (uint32_t i{}; i != pairs.size(); ++i)
+    {
+        pairs[i] = static_cast<uint16_t>(('0' + (i / 10)) | (('0' + (i % 10)) << 8));
+    }
+    return pairs;
+}()};
+
+/// <summary>
+/// Returns the 5 decimal characters of value (leading zeros included) in the low bytes of a word. The most
+/// significant digit is stored in the lowest byte, which is the first byte in memory.
+/// </summary>
+[[nodiscard]] constexpr uint64_t to_decimal_characters(const uint32_t value) noexcept
+{
+    const uint32_t low{value % 10000};
+    return ('0' + (value / 10000)) | (uint64_t{digit_pairs[low / 100]} << 8) |
+           (uint64_t{digit_pairs[low % 100]} << 24);
+}
+
+[[nodiscard]] constexpr uint32_t decimal_digit_count(const uint32_t value) noexcept
+{
+    return 1U + (value >= 10) + (value >= 100) + (value >= 1000) + (value >= 10000);
+}
+
+/// <summary>
+/// The separator and the leading zeros are handled with selects instead of branches: the separator is always
+/// stored and only kept when needed, the leading zeros are shifted out of the word of characters.
+/// </summary>
+template<typename Sample>
+[[nodiscard]] size_t format_values(const Sample* values, const size_t count, byte* destination,
+                                   size_t& line_length) noexcept
+{
+    byte* position{destination};
+    size_t length{line_length};
+    for (size_t i{}; i != count; ++i)
+    {
+        const uint32_t value{values[i]};
+        const uint32_t digit_count{decimal_digit_count(value)};
+
+        const bool separate{length != 0};
+        const bool wrap{length + 1 + digit_count > max_line_length};
+        *position = wrap ? byte{'\n'} : byte{' '};
+        position += separate;
+        length = wrap ? 0 : length + separate;
+
+        const uint64_t characters{to_decimal_characters(value) >> (8 * (5 - digit_count))};
+        std::memcpy(position, &characters, sizeof characters);
+        position += digit_count;
+        length += digit_count;
+    }
+
+    line_length = length;
+    return static_cast<size_t>(position - destination);
+}
+
+} // namespace
+
+export namespace scalar {
+
+/// <summary>
+/// Reference implementation of format_decimal_values, formats the values 1 at a time with std::to_chars.
+/// </summary>
+[[nodiscard]] size_t format_decimal_values(const uint16_t* values, const size_t count, byte* destination,
+                                           size_t& line_length) noexcept
+{
+    auto* position{reinterpret_cast<char*>(destination)};
+    for (size_t i{}; i != count; ++i)
+    {
+        std::array<char, 5> characters;
+        const auto digit_count{
+            static_cast<size_t>(std::to_chars(characters.data(), characters.data() + characters.size(), values[i]).ptr -
+                                characters.data())};
+        if (line_length != 0)
+        {
+            if (line_length + 1 + digit_count > max_line_length)
+            {
+                *position++ = '\n';
+                line_length = 0;
+            }
+            else
+            {
+                *position++ = ' ';
+                ++line_length;
+            }
+        }
+
+        position = std::copy_n(characters.data(), digit_count, position);
+        line_length += digit_count;
+    }
+
+    return static_cast<size_t>(position - reinterpret_cast<char*>(destination));
+}
+
+} // namespace scalar
+
+/// <summary>
+/// Formats count values as decimal text, separated by a space or, when the line would become longer than
+/// max_line_length, by a line feed. line_length is the length of the current line, 0 when the values start a new
+/// line. The destination must have room for max_formatted_size(count) bytes. Returns the number of bytes used.
+/// </summary>
+export [[nodiscard]] size_t format_decimal_values(const uint16_t* values, const size_t count, byte* destination,
+                                                  size_t& line_length) noexcept
+{
+    return format_values(values, count, destination, line_length);
+}
+
+export [[nodiscard]] size_t format_decimal_values(const uint8_t* values, const size_t count, byte* destination,
+                                                  size_t& line_length) noexcept
+{
+    return format_values(values, count, destination, line_length);
+}
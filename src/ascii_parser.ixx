@@ -0,0 +1,430 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "simd.hpp"
+
+export module ascii_parser;
+
+import std;
+
+import band_pipeline;
+
+// Purpose: scans the ASCII parts of Netpbm files (the header and the pixel values of the plain formats) a word or
+//          a SIMD register at a time. This module only depends on the C++ standard library.
+
+using std::byte;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little,
+              "The first byte of a word must be its least significant byte");
+
+[[nodiscard]] constexpr uint64_t repeat_byte(const std::uint8_t value) noexcept
+{
+    return 0x0101'0101'0101'0101ULL * value;
+}
+
+constexpr uint64_t high_bits{repeat_byte(0x80)};
+constexpr uint64_t low_bits{repeat_byte(0x7F)};
+
+/// <summary>
+/// Returns a mask with the high bit set for every byte of word that is not zero, without carries between bytes.
+/// </summary>
+[[nodiscard]] constexpr uint64_t non_zero_bytes(const uint64_t word) noexcept
+{
+    return (((word & low_bits) + low_bits) | word) & high_bits;
+}
+
+[[nodiscard]] uint64_t load_word(const byte* source) noexcept
+{
+    uint64_t word;
+    std::memcpy(&word, source, sizeof word);
+    return word;
+}
+
+} // namespace
+
+/// <summary>
+/// Returns true for the Netpbm whitespace characters: space, tab, line feed, vertical tab, form feed and carriage
+/// return. Unlike std::isspace, this doesn't depend on the locale.
+/// </summary>
+export [[nodiscard]] constexpr bool is_whitespace(const byte value) noexcept
+{
+    const auto c{std::to_integer<unsigned int>(value)};
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/// <summary>
+/// Returns a mask with the high bit set for every byte of word that is not whitespace.
+/// </summary>
+export [[nodiscard]] constexpr uint64_t non_whitespace_bytes(const uint64_t word) noexcept
+{
+    const uint64_t not_space{non_zero_bytes(word ^ repeat_byte(' '))};
+
+    // \t (9) to \r (13): with the high bit of every byte set, the subtraction cannot borrow from the next byte.
+    const uint64_t at_least_tab{((word | high_bits) - repeat_byte('\t')) & high_bits};
+    const uint64_t above_carriage_return{((word | high_bits) - repeat_byte('\r' + 1)) & high_bits};
+    const uint64_t control_whitespace{at_least_tab & ~above_carriage_return & ~word & high_bits};
+
+    return not_space & ~control_whitespace;
+}
+
+/// <summary>
+/// Returns the offset of the first byte that is not whitespace, or size when all bytes are whitespace.
+/// </summary>
+export [[nodiscard]] size_t find_non_whitespace(const byte* source, const size_t size) noexcept
+{
+    size_t offset{};
+    for (; size - offset >= sizeof(uint64_t); offset += sizeof(uint64_t))
+    {
+        if (const uint64_t mask{non_whitespace_bytes(load_word(source + offset))}; mask != 0)
+            return offset + (static_cast<size_t>(std::countr_zero(mask)) / 8);
+    }
+
+    while (offset != size && is_whitespace(source[offset]))
+    {
+        ++offset;
+    }
+
+    return offset;
+}
+
+/// <summary>
+/// Returns the offset of the first line feed or carriage return, or size when there is none.
+/// </summary>
+export [[nodiscard]] size_t find_end_of_line(const byte* source, const size_t size) noexcept
+{
+    if (size == 0)
+        return 0;
+
+    const auto* first{reinterpret_cast<const char*>(source)};
+    const auto* line_feed{static_cast<const char*>(std::memchr(first, '\n', size))};
+    const size_t line_feed_offset{line_feed ? static_cast<size_t>(line_feed - first) : size};
+    const auto* carriage_return{static_cast<const char*>(std::memchr(first, '\r', line_feed_offset))};
+
+    return carriage_return ? static_cast<size_t>(carriage_return - first) : line_feed_offset;
+}
+
+/// <summary>
+/// Result of parsing whitespace separated decimal values.
+/// </summary>
+export struct decimal_parse_result final
+{
+    size_t consumed;    // Number of bytes that were parsed, up to the end of the last value or all trailing whitespace.
+    size_t value_count; // Number of values that were stored.
+    bool valid;         // False when a character is not a digit or whitespace or when a value is larger than 65535.
+};
+
+export namespace scalar {
+
+/// <summary>
+/// Parses at most max_count whitespace separated decimal values. A value at the end of text must be complete: the
+/// caller passes text that ends at whitespace or at the end of the data.
+/// </summary>
+[[nodiscard]] decimal_parse_result parse_decimal_values(const byte* text, const size_t size, uint16_t* values,
+                                                        const size_t max_count) noexcept
+{
+    size_t position{};
+    size_t count{};
+    while (count != max_count)
+    {
+        position += find_non_whitespace(text + position, size - position);
+        if (position == size)
+            break;
+
+        const size_t first{position};
+        uint32_t value{};
+        for (; position != size; ++position)
+        {
+            const uint32_t digit{std::to_integer<uint32_t>(text[position]) - '0'};
+            if (digit > 9)
+                break;
+
+            value = (value * 10) + digit;
+            if (value > std::numeric_limits<uint16_t>::max())
+                return {position, count, false};
+        }
+
+        if (position == first || (position != size && !is_whitespace(text[position])))
+            return {position, count, false};
+
+        values[count++] = static_cast<uint16_t>(value);
+    }
+
+    return {position, count, true};
+}
+
+} // namespace scalar
+
+namespace {
+
+/// <summary>
+/// Converts 1 to 8 ASCII digits to their value without branches, 3 multiplications for all digits of the word.
+/// The 8 bytes starting at digits must be readable.
+/// </summary>
+[[nodiscard]] uint32_t convert_digits(const byte* digits, const size_t length) noexcept
+{
+    // Shift the bytes after the digits out: the zero bytes that are shifted in act as leading zeros.
+    uint64_t word{load_word(digits) << (8 * (sizeof(uint64_t) - length))};
+    word = ((word & repeat_byte(0x0F)) * ((10 << 8) + 1)) >> 8;
+    word = ((word & 0x00FF'00FF'00FF'00FFULL) * ((100 << 16) + 1)) >> 16;
+    return static_cast<uint32_t>(((word & 0x0000'FFFF'0000'FFFFULL) * ((10000ULL << 32) + 1)) >> 32);
+}
+
+#ifdef SIMD_SSE2
+
+struct character_classes final
+{
+    uint64_t digits;
+    uint64_t whitespace;
+};
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 character_classes classify_characters_avx2(const byte* text) noexcept
+{
+    character_classes classes{};
+    for (size_t i{}; i != 64; i += 32)
+    {
+        const __m256i characters{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i))};
+        const __m256i digit_values{_mm256_sub_epi8(characters, _mm256_set1_epi8('0'))};
+        const __m256i digits{_mm256_cmpeq_epi8(_mm256_min_epu8(digit_values, _mm256_set1_epi8(9)), digit_values)};
+        const __m256i control_values{_mm256_sub_epi8(characters, _mm256_set1_epi8('\t'))};
+        const __m256i whitespace{_mm256_or_si256(
+            _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(' ')),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(control_values, _mm256_set1_epi8('\r' - '\t')), control_values))};
+
+        classes.digits |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(digits))} << i;
+        classes.whitespace |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))} << i;
+    }
+
+    return classes;
+}
+
+#endif
+
+/// <summary>
+/// Classifies 64 characters: a bit is set in digits or whitespace for every character of that class.
+/// </summary>
+[[nodiscard]] character_classes classify_characters(const byte* text) noexcept
+{
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+        return classify_characters_avx2(text);
+#endif
+
+    character_classes classes{};
+    for (size_t i{}; i != 64; i += 16)
+    {
+        const __m128i characters{_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i))};
+        const __m128i digit_values{_mm_sub_epi8(characters, _mm_set1_epi8('0'))};
+        const __m128i digits{_mm_cmpeq_epi8(_mm_min_epu8(digit_values, _mm_set1_epi8(9)), digit_values)};
+        const __m128i control_values{_mm_sub_epi8(characters, _mm_set1_epi8('\t'))};
+        const __m128i whitespace{_mm_or_si128(
+            _mm_cmpeq_epi8(characters, _mm_set1_epi8(' ')),
+            _mm_cmpeq_epi8(_mm_min_epu8(control_values, _mm_set1_epi8('\r' - '\t')), control_values))};
+
+        classes.digits |= uint64_t{static_cast<uint32_t>(_mm_movemask_epi8(digits))} << i;
+        classes.whitespace |= uint64_t{static_cast<uint32_t>(_mm_movemask_epi8(whitespace))} << i;
+    }
+
+    return classes;
+}
+
+/// <summary>
+/// Parses values 64 characters at a time. Returns the number of bytes parsed, which is always at the start of a
+/// value or at whitespace. Stops at the end of the text, at invalid characters and at values with more than 8
+/// digits: the scalar implementation continues from there (and reports errors).
+/// </summary>
+[[nodiscard]] size_t parse_decimal_values_simd(const byte* text, const size_t size, uint16_t* values,
+                                               const size_t max_count, size_t& count) noexcept
+{
+    constexpr size_t window_size{64};
+
+    size_t position{};
+
+    // The digits of a value are converted with an 8 byte load: a value that starts in the window must be readable.
+    while (count != max_count && size - position >= window_size + sizeof(uint64_t))
+    {
+        const auto [digits, whitespace]{classify_characters(text + position)};
+        if ((digits | whitespace) != ~uint64_t{})
+            break;
+
+        // The window starts at whitespace or at the first digit of a value (never in the middle of a value).
+        uint64_t starts{digits & ~(digits << 1)};
+        size_t next{window_size};
+        while (starts != 0)
+        {
+            const auto start{static_cast<size_t>(std::countr_zero(starts))};
+            const auto length{static_cast<size_t>(std::countr_zero(~(digits >> start)))};
+            if (start + length == window_size)
+            {
+                // The value may continue in the next window: parse it from there.
+                next = start;
+                break;
+            }
+
+            if (length > sizeof(uint64_t))
+                return position + start;
+
+            const uint32_t value{convert_digits(text + position + start, length)};
+            if (value > std::numeric_limits<uint16_t>::max())
+                return position + start;
+
+            values[count++] = static_cast<uint16_t>(value);
+            if (count == max_count)
+            {
+                next = start + length;
+                break;
+            }
+
+            starts &= starts - 1;
+        }
+
+        if (next == 0)
+            break; // A value with 64 or more digits.
+
+        position += next;
+    }
+
+    return position;
+}
+
+/// <summary>
+/// Counts the values that start in the first (size / 64) * 64 bytes of text. Returns the number of bytes processed,
+/// previous_in_value is 1 when the last processed byte is part of a value.
+/// </summary>
+[[nodiscard]] size_t count_values_simd(const byte* text, const size_t size, size_t& count,
+                                       uint64_t& previous_in_value) noexcept
+{
+    constexpr size_t window_size{64};
+
+    size_t offset{};
+    for (; size - offset >= window_size; offset += window_size)
+    {
+        const uint64_t in_value{~classify_characters(text + offset).whitespace};
+        count += static_cast<size_t>(std::popcount(in_value & ~((in_value << 1) | previous_in_value)));
+        previous_in_value = in_value >> 63;
+    }
+
+    return offset;
+}
+
+#else
+
+[[nodiscard]] size_t parse_decimal_values_simd(const byte*, size_t, uint16_t*, size_t, size_t&) noexcept
+{
+    return 0;
+}
+
+[[nodiscard]] size_t count_values_simd(const byte*, size_t, size_t&, uint64_t&) noexcept
+{
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+/// <summary>
+/// Returns the number of whitespace separated values (any run of other characters) in text.
+/// </summary>
+export [[nodiscard]] size_t count_values(const byte* text, const size_t size) noexcept
+{
+    // A value starts at every byte that is not whitespace and follows whitespace (or the start of the text).
+    size_t count{};
+    uint64_t previous_in_value{};
+    size_t offset{count_values_simd(text, size, count, previous_in_value)};
+    for (; size - offset >= sizeof(uint64_t); offset += sizeof(uint64_t))
+    {
+        const uint64_t in_value{non_whitespace_bytes(load_word(text + offset)) >> 7};
+        count += static_cast<size_t>(std::popcount(in_value & ~((in_value << 8) | previous_in_value)));
+        previous_in_value = in_value >> 56;
+    }
+
+    for (; offset != size; ++offset)
+    {
+        const uint64_t in_value{!is_whitespace(text[offset])};
+        count += static_cast<size_t>(in_value & ~previous_in_value);
+        previous_in_value = in_value;
+    }
+
+    return count;
+}
+
+/// <summary>
+/// Parses at most max_count whitespace separated decimal values. A value at the end of text must be complete: the
+/// caller passes text that ends at whitespace or at the end of the data.
+/// </summary>
+export [[nodiscard]] decimal_parse_result parse_decimal_values(const byte* text, const size_t size, uint16_t* values,
+                                                               const size_t max_count) noexcept
+{
+    size_t count{};
+    const size_t parsed{parse_decimal_values_simd(text, size, values, max_count, count)};
+    const auto [consumed, value_count, valid]{
+        scalar::parse_decimal_values(text + parsed, size - parsed, values + count, max_count - count)};
+    return {parsed + consumed, count + value_count, valid};
+}
+
+/// <summary>
+/// Parses count whitespace separated decimal values on thread_count threads. The text is split in chunks at
+/// whitespace, the values of every chunk are counted first: the sum of the counts of the previous chunks is the
+/// position of the first value of a chunk. The chunks are then parsed concurrently.
+/// Returns the same result as parse_decimal_values when all values are valid.
+/// </summary>
+export [[nodiscard]] decimal_parse_result parse_decimal_values_parallel(const byte* text, const size_t size,
+                                                                        uint16_t* values, const size_t count,
+                                                                        const size_t thread_count)
+{
+    // Multiple chunks per thread balance the load when the values have different lengths in parts of the text.
+    constexpr size_t minimum_chunk_size{256 * 1024};
+    const size_t chunk_count{std::clamp(size / minimum_chunk_size, size_t{1}, thread_count * 4)};
+
+    std::vector<size_t> chunk_starts(chunk_count + 1);
+    chunk_starts[chunk_count] = size;
+    for (size_t chunk{1}; chunk != chunk_count; ++chunk)
+    {
+        size_t start{std::max(size / chunk_count * chunk, chunk_starts[chunk - 1])};
+        while (start != size && !is_whitespace(text[start]))
+        {
+            ++start;
+        }
+        chunk_starts[chunk] = start;
+    }
+
+    const auto chunk_size{[&](const size_t chunk) noexcept { return chunk_starts[chunk + 1] - chunk_starts[chunk]; }};
+
+    // first_values[chunk] is the index of the first value of the chunk, first_values[chunk_count] the total count.
+    std::vector<size_t> first_values(chunk_count + 1);
+    run_parallel(chunk_count, thread_count, [&](const size_t chunk) noexcept {
+        first_values[chunk + 1] = count_values(text + chunk_starts[chunk], chunk_size(chunk));
+    });
+    std::partial_sum(first_values.begin(), first_values.end(), first_values.begin());
+
+    // Values after the requested count are not parsed: the text may continue with other data.
+    const auto chunk_value_count{[&](const size_t chunk) noexcept {
+        return std::min(first_values[chunk + 1], count) - std::min(first_values[chunk], count);
+    }};
+    std::vector<decimal_parse_result> results(chunk_count);
+    run_parallel(chunk_count, thread_count, [&](const size_t chunk) noexcept {
+        results[chunk] = parse_decimal_values(text + chunk_starts[chunk], chunk_size(chunk),
+                                              values + std::min(first_values[chunk], count), chunk_value_count(chunk));
+    });
+
+    decimal_parse_result result{.consumed{}, .value_count{}, .valid{true}};
+    for (size_t chunk{}; chunk != chunk_count && first_values[chunk] < count; ++chunk)
+    {
+        const auto [consumed, value_count, valid]{results[chunk]};
+        result = {chunk_starts[chunk] + consumed, result.value_count + value_count, valid};
+        if (!valid || value_count != chunk_value_count(chunk))
+            break;
+    }
+
+    return result;
+}
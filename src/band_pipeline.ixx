@@ -0,0 +1,179 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module band_pipeline;
+
+import std;
+#ifdef _WIN32
+import <win.hpp>;
+#endif
+
+// Purpose: splits the rows of an image in horizontal bands and converts them on worker threads, while the calling
+//          thread reads the next band, and runs independent tasks on worker threads.
+//          The worker threads are the threads of the process wide Windows thread pool: a decode doesn't create
+//          threads. Other than the thread pool, this module only depends on the C++ standard library.
+
+using std::size_t;
+
+/// <summary>
+/// Runs copies of 1 task on worker threads. The task must not throw: an exception on a worker thread terminates the
+/// process. The copies are expected to claim their work from a shared counter, and the calling thread to run the
+/// task itself before wait(): a copy that didn't start yet would find no work and is cancelled.
+/// </summary>
+class worker_group final
+{
+public:
+    explicit worker_group(std::function<void()> task) : task_{std::move(task)}
+    {
+#ifdef _WIN32
+        work_ = CreateThreadpoolWork(run, this, nullptr);
+        if (!work_)
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category());
+#endif
+    }
+
+    ~worker_group()
+    {
+        wait();
+#ifdef _WIN32
+        CloseThreadpoolWork(work_);
+#endif
+    }
+
+    worker_group(const worker_group&) = delete;
+    worker_group(worker_group&&) = delete;
+    worker_group& operator=(const worker_group&) = delete;
+    worker_group& operator=(worker_group&&) = delete;
+
+    /// <summary>
+    /// Starts count copies of the task.
+    /// </summary>
+    void submit(const size_t count)
+    {
+        for (size_t i{}; i != count; ++i)
+        {
+#ifdef _WIN32
+            SubmitThreadpoolWork(work_);
+#else
+            threads_.emplace_back(task_);
+#endif
+        }
+    }
+
+    /// <summary>
+    /// Waits until the running copies return, the copies that didn't start yet are cancelled.
+    /// </summary>
+    void wait() noexcept
+    {
+#ifdef _WIN32
+        WaitForThreadpoolWorkCallbacks(work_, true);
+#else
+        threads_.clear();
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    static void __stdcall run(PTP_CALLBACK_INSTANCE, void* context, PTP_WORK) noexcept
+    {
+        static_cast<worker_group*>(context)->task_();
+    }
+
+    PTP_WORK work_;
+#else
+    std::vector<std::jthread> threads_;
+#endif
+    std::function<void()> task_;
+};
+
+/// <summary>
+/// Processes row_count rows in bands of rows_per_band rows.
+/// read_band(band_index, first_row, band_row_count) is called on the calling thread and makes the raw bytes of a
+/// band available. convert_rows(band_index, first_row, row_count) is called on the worker threads and on the calling
+/// thread, each call converts a contiguous part of the band. Band n + 1 is read while band n is converted: the caller
+/// needs to use 2 band buffers (band_index % 2) when the raw bytes are not read into their final location.
+/// </summary>
+export template<typename ReadBand, typename ConvertRows>
+void run_band_pipeline(const size_t row_count, const size_t rows_per_band, const size_t thread_count,
+                       ReadBand read_band, ConvertRows convert_rows)
+{
+    const size_t band_count{(row_count + rows_per_band - 1) / rows_per_band};
+    const auto band_rows{[&](const size_t band) noexcept -> std::pair<size_t, size_t> {
+        const size_t first_row{band * rows_per_band};
+        return {first_row, std::min(rows_per_band, row_count - first_row)};
+    }};
+
+    if (band_count == 0)
+        return;
+
+    {
+        const auto [first_row, band_row_count]{band_rows(0)};
+        read_band(size_t{}, first_row, band_row_count);
+    }
+
+    // Every band is converted in thread_count parts. The parts are claimed with a counter by the worker threads and,
+    // after it has read the next band, by the calling thread: a band never waits for a worker thread to start.
+    size_t current_band{};
+    std::atomic<size_t> next_part{};
+    const auto convert_parts{[&]() noexcept {
+        const auto [first_row, band_row_count]{band_rows(current_band)};
+        for (size_t part{next_part++}; part < thread_count; part = next_part++)
+        {
+            const size_t begin{band_row_count * part / thread_count};
+            const size_t end{band_row_count * (part + 1) / thread_count};
+            if (begin != end)
+            {
+                convert_rows(current_band, first_row + begin, end - begin);
+            }
+        }
+    }};
+    worker_group workers{convert_parts};
+
+    for (size_t band{}; band != band_count; ++band)
+    {
+        current_band = band;
+        next_part = 0;
+        workers.submit(thread_count - 1);
+
+        std::exception_ptr exception;
+        if (band + 1 != band_count)
+        {
+            try
+            {
+                const auto [first_row, band_row_count]{band_rows(band + 1)};
+                read_band(band + 1, first_row, band_row_count);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+        }
+
+        convert_parts();
+        workers.wait();
+        if (exception)
+            std::rethrow_exception(exception);
+    }
+}
+
+/// <summary>
+/// Calls task(task_index) for every task index below task_count, on thread_count threads (the calling thread is 1 of
+/// them). The tasks are handed out in order, the task with the next index goes to the first thread that is idle.
+/// Tasks must not throw: an exception on a worker thread terminates the process.
+/// </summary>
+export template<typename Task>
+void run_parallel(const size_t task_count, const size_t thread_count, Task task)
+{
+    std::atomic<size_t> next_task{};
+    const auto run_tasks{[&]() noexcept {
+        for (size_t task_index{next_task++}; task_index < task_count; task_index = next_task++)
+        {
+            task(task_index);
+        }
+    }};
+
+    worker_group workers{run_tasks};
+    workers.submit(std::max(std::min(thread_count, task_count), size_t{1}) - 1);
+    run_tasks();
+    workers.wait();
+}
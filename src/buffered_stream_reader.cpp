@@ -10,40 +10,94 @@ module buffered_stream_reader;
 
 import <win.hpp>;
 
+import ascii_parser;
 import errors;
+#ifdef _WIN32
 import util;
+#endif
 
 using std::uint32_t;
+using std::uint64_t;
 
-constexpr UINT MAX_BUFFER_SIZE = 65536;
+// Large reads reduce the number of Read calls, which is important for network streams.
+constexpr size_t max_buffer_size{1024 * 1024};
 
 
-buffered_stream_reader::buffered_stream_reader(_In_ IStream* stream) : buffer_(MAX_BUFFER_SIZE)
+#ifdef _WIN32
+buffered_stream_reader::buffered_stream_reader(_In_ IStream* stream, const size_t initial_read_size,
+                                               std::pmr::memory_resource* memory_resource) :
+    memory_resource_{memory_resource}
 {
     ASSERT(stream);
 
     stream_.copy_from(stream);
 
-    // buffer_ = new BYTE[MAX_BUFFER_SIZE];
+    // The size of the stream is used to prevent allocating and reading more than needed for small files.
+    // Some streams report a size of 0 when the size is not known.
+    if (STATSTG stat; !failed(stream->Stat(&stat, STATFLAG_NONAME)) && stat.cbSize.QuadPart != 0)
+    {
+        stream_size_ = stat.cbSize.QuadPart;
+    }
 
-    unsigned long read;
-    check_hresult(stream->Read(buffer_.data(), MAX_BUFFER_SIZE, &read), wincodec::error_stream_read);
+    grow_buffer(static_cast<size_t>(
+        std::min(remaining_stream_size(), uint64_t{std::clamp(initial_read_size, size_t{1}, max_buffer_size)})));
+    buffer_size_ = read_from_stream(buffer_.data(), buffer_.size());
+}
+#endif
 
-    buffer_size_ = read;
+buffered_stream_reader::buffered_stream_reader(const std::span<const std::byte> data,
+                                               std::pmr::memory_resource* memory_resource) noexcept :
+    memory_resource_{memory_resource}, data_{data.data()}, buffer_size_{data.size()}, stream_position_{data.size()}
+{
 }
 
 uint32_t buffered_stream_reader::read_int()
 {
-    char str[12];
+    skip_whitespace_and_comments();
+
+    // The digits and the terminating whitespace character must be in the buffer to parse them directly from it.
+    constexpr size_t max_token_size{12};
+    if (buffer_size_ - position_ < max_token_size)
+    {
+        RefillBuffer();
+    }
 
-    read_string(str, sizeof(str));
+    const auto* first{reinterpret_cast<const char*>(data_ + position_)};
+    const auto* last{first + std::min(buffer_size_ - position_, max_token_size)};
     uint32_t value;
-    if (const auto [ptr, ec] = std::from_chars(str, std::end(str), value); ec != std::errc())
-        winrt::throw_hresult(WINCODEC_ERR_BADSTREAMDATA);
+    const auto [ptr, ec]{std::from_chars(first, last, value)};
+    if (ec != std::errc() || ptr == last || !is_whitespace(static_cast<std::byte>(*ptr)))
+        winrt::throw_hresult(wincodec::error_bad_stream_data);
 
+    // A value is terminated by 1 whitespace character, which is also consumed.
+    position_ += static_cast<size_t>(ptr - first) + 1;
     return value;
 }
 
+std::string_view buffered_stream_reader::read_word()
+{
+    skip_whitespace_and_comments();
+
+    // The word and the terminating whitespace character must be in the buffer to return a view on it.
+    constexpr size_t max_word_size{64};
+    if (buffer_size_ - position_ <= max_word_size)
+    {
+        RefillBuffer();
+    }
+
+    const auto* first{reinterpret_cast<const char*>(data_ + position_)};
+    const size_t available{std::min(buffer_size_ - position_, max_word_size + 1)};
+    const size_t size{static_cast<size_t>(
+        std::find_if(first, first + available, [](const char c) { return is_whitespace(static_cast<std::byte>(c)); }) -
+        first)};
+    if (size == available)
+        winrt::throw_hresult(wincodec::error_bad_stream_data);
+
+    // A word is terminated by 1 whitespace character, which is also consumed.
+    position_ += size + 1;
+    return {first, size};
+}
+
 bool buffered_stream_reader::try_read_bytes(void* buffer, const size_t size)
 {
     ULONG bytes_read;
@@ -54,96 +108,146 @@ bool buffered_stream_reader::try_read_bytes(void* buffer, const size_t size)
     return true;
 }
 
-char buffered_stream_reader::read_char()
+void buffered_stream_reader::skip_whitespace_and_comments()
 {
-    if (position_ + sizeof(char) > buffer_size_)
+    while (true)
     {
-        if (buffer_size_ == MAX_BUFFER_SIZE)
+        position_ += find_non_whitespace(data_ + position_, buffer_size_ - position_);
+        if (position_ == buffer_size_)
         {
             RefillBuffer();
+            if (position_ == buffer_size_)
+                winrt::throw_hresult(wincodec::error_bad_stream_data);
 
-            if (buffer_size_ < sizeof(char))
-                winrt::throw_hresult(WINCODEC_ERR_BADSTREAMDATA);
+            continue;
         }
-        else
-            winrt::throw_hresult(WINCODEC_ERR_BADSTREAMDATA);
-    }
 
-    const char result = buffer_[position_];
+        if (data_[position_] != std::byte{'#'})
+            return;
 
-    position_ += sizeof(char);
+        // A comment runs until the end of the line, which can be beyond the current buffer.
+        while (true)
+        {
+            position_ += find_end_of_line(data_ + position_, buffer_size_ - position_);
+            if (position_ != buffer_size_)
+                break;
 
-    return result;
+            RefillBuffer();
+            if (position_ == buffer_size_)
+                winrt::throw_hresult(wincodec::error_bad_stream_data);
+        }
+    }
 }
 
-void buffered_stream_reader::skip_line()
+void buffered_stream_reader::read_bytes(void* buffer, size_t size)
 {
-    while (true)
+    auto destination{static_cast<std::byte*>(buffer)};
+    const size_t from_buffer{std::min(buffer_size_ - position_, size)};
+    memcpy(destination, data_ + position_, from_buffer);
+    position_ += from_buffer;
+    destination += from_buffer;
+    size -= from_buffer;
+
+    if (size == 0)
+        return;
+
+    if (is_memory_backed())
+        winrt::throw_hresult(wincodec::error_bad_stream_data);
+
+    if (size >= buffer_.size())
     {
-        const char c = read_char();
+        // Large reads bypass the buffer to prevent an extra copy.
+        if (read_from_stream(destination, size) != size)
+            winrt::throw_hresult(wincodec::error_bad_stream_data);
 
-        if (c == 0x0A)
-            return;
+        return;
     }
+
+    RefillBuffer();
+    if (buffer_size_ < size)
+        winrt::throw_hresult(wincodec::error_bad_stream_data);
+
+    memcpy(destination, data_, size);
+    position_ = size;
 }
 
-void buffered_stream_reader::read_string(char* str, ULONG maxCount)
+std::span<const std::byte> buffered_stream_reader::read_span(const size_t size)
 {
-    ASSERT(maxCount > 0);
+    if (buffer_size_ - position_ < size)
+    {
+        // Rows can be larger than the default buffer size: grow the buffer to ensure a row fits in 1 span.
+        if (!is_memory_backed() && buffer_.size() < size)
+        {
+            grow_buffer(size);
+        }
 
-    ULONG charsRead = 0;
+        RefillBuffer();
+        if (buffer_size_ - position_ < size)
+            winrt::throw_hresult(wincodec::error_bad_stream_data);
+    }
 
-    while (true)
+    const std::span result{data_ + position_, size};
+    position_ += size;
+    return result;
+}
+
+std::span<const std::byte> buffered_stream_reader::read_remaining()
+{
+    while (!is_memory_backed())
     {
-        char c = read_char();
+        // The stream size is only an upper bound (or unknown): read until the stream returns less than requested.
+        const size_t remaining{buffer_size_ - position_};
+        const uint64_t stream_remaining{remaining_stream_size()};
+        if (stream_remaining == 0)
+            break;
+
+        constexpr uint64_t max_size{std::numeric_limits<size_t>::max()};
+        const size_t read_size{stream_size_ == std::numeric_limits<uint64_t>::max()
+                                   ? std::max(remaining, max_buffer_size)
+                                   : static_cast<size_t>(std::min(stream_remaining, max_size - remaining))};
+        grow_buffer(remaining + read_size);
+        const size_t bytes_read{read_from_stream(buffer_.data() + remaining, read_size)};
+        buffer_size_ += bytes_read;
+        if (bytes_read != read_size)
+            break;
+    }
 
-        if (isspace(c))
-            if (charsRead == 0)
-                continue;
-            else
-            {
-                *str = 0x00;
-                return;
-            }
+    return read_span(buffer_size_ - position_);
+}
 
-        if (c == '#')
-            if (charsRead == 0)
-            {
-                skip_line();
-                continue;
-            }
-            else
+void buffered_stream_reader::read_decimal_values(std::uint16_t* values, size_t count)
+{
+    bool end_of_data{is_memory_backed()};
+    while (true)
+    {
+        // A value at the end of the buffer may continue in the next read: only parse up to the last whitespace.
+        size_t end{buffer_size_};
+        if (!end_of_data)
+        {
+            while (end != position_ && !is_whitespace(data_[end - 1]))
             {
-                winrt::throw_hresult(WINCODEC_ERR_BADSTREAMDATA);
+                --end;
             }
+        }
 
-        *str = c;
-        str++;
-        charsRead++;
+        const auto [consumed, value_count, valid]{
+            parse_decimal_values(data_ + position_, end - position_, values, count)};
+        if (!valid)
+            winrt::throw_hresult(wincodec::error_bad_stream_data);
 
-        if (charsRead == maxCount)
-            winrt::throw_hresult(WINCODEC_ERR_BADSTREAMDATA);
-    }
-}
+        position_ += consumed;
+        values += value_count;
+        count -= value_count;
+        if (count == 0)
+            return;
 
-void buffered_stream_reader::read_bytes(void* buffer, size_t size)
-{
-    const size_t remaining_in_buffer = buffer_size_ - position_;
+        if (end_of_data)
+            winrt::throw_hresult(wincodec::error_bad_stream_data);
 
-    if (remaining_in_buffer >= size)
-    {
-        memcpy(buffer, buffer_.data() + position_, size);
-        position_ += static_cast<UINT>(size);
-        return;
+        const size_t remaining{buffer_size_ - position_};
+        RefillBuffer();
+        end_of_data = buffer_size_ - position_ == remaining;
     }
-
-    memcpy(buffer, buffer_.data() + position_, remaining_in_buffer);
-    position_ += static_cast<UINT>(remaining_in_buffer);
-    size -= remaining_in_buffer;
-
-    unsigned long read;
-    check_hresult(stream_->Read(static_cast<std::byte*>(buffer) + remaining_in_buffer, static_cast<ULONG>(size), &read),
-                  wincodec::error_stream_read);
 }
 
 void buffered_stream_reader::read_bytes(void* buf, const ULONG count, ULONG* bytesRead)
@@ -155,20 +259,20 @@ void buffered_stream_reader::read_bytes(void* buf, const ULONG count, ULONG* byt
     {
         if (buffer_size_ - position_ >= remaining)
         {
-            memcpy(b, buffer_.data() + position_, remaining);
+            memcpy(b, data_ + position_, remaining);
             position_ += remaining;
             *bytesRead = count;
             return;
         }
 
-        memcpy(b, buffer_.data() + position_, buffer_size_ - position_);
+        memcpy(b, data_ + position_, buffer_size_ - position_);
         b += buffer_size_ - position_;
         remaining -= static_cast<ULONG>(buffer_size_ - position_);
         position_ = buffer_size_;
 
         RefillBuffer();
 
-        if (buffer_size_ == 0)
+        if (position_ == buffer_size_)
         {
             *bytesRead = count - remaining;
             return;
@@ -178,14 +282,67 @@ void buffered_stream_reader::read_bytes(void* buf, const ULONG count, ULONG* byt
 
 void buffered_stream_reader::RefillBuffer()
 {
-    memcpy(buffer_.data(), buffer_.data() + position_, buffer_size_ - position_);
+    // Memory is completely available from the start: there is nothing to refill.
+    if (is_memory_backed())
+        return;
+
+    // The first read only needs to contain the header: use large reads for the pixel data.
+    const size_t remaining{buffer_size_ - position_};
+    const uint64_t needed{std::min(remaining_stream_size(), uint64_t{max_buffer_size}) + remaining};
+    if (const auto capacity{static_cast<size_t>(std::min(needed, uint64_t{max_buffer_size}))};
+        capacity > buffer_.size())
+    {
+        grow_buffer(capacity);
+    }
+    else
+    {
+        memmove(buffer_.data(), buffer_.data() + position_, remaining);
+        buffer_size_ = remaining;
+        position_ = 0;
+    }
 
-    position_ = buffer_size_ - position_;
+    buffer_size_ += read_from_stream(buffer_.data() + remaining, buffer_.size() - remaining);
+}
 
-    unsigned long read;
-    check_hresult(stream_->Read(buffer_.data() + position_, static_cast<ULONG>(buffer_size_ - position_), &read),
-                  wincodec::error_stream_read);
+void buffered_stream_reader::grow_buffer(const size_t capacity)
+{
+    // The buffer is not zero-initialized: only the bytes read from the stream are used.
+    pooled_buffer buffer{capacity, memory_resource_};
+    const size_t remaining{buffer_size_ - position_};
+    if (remaining != 0)
+    {
+        memcpy(buffer.data(), data_ + position_, remaining);
+    }
 
-    buffer_size_ = position_ + read;
+    buffer_ = std::move(buffer);
+    data_ = buffer_.data();
+    buffer_size_ = remaining;
     position_ = 0;
 }
+
+size_t buffered_stream_reader::read_from_stream([[maybe_unused]] void* buffer, [[maybe_unused]] const size_t size)
+{
+#ifdef _WIN32
+    // IStream::Read may return less bytes than requested (for example network streams), continue until end of stream.
+    auto destination{static_cast<std::byte*>(buffer)};
+    size_t total_read{};
+    while (total_read != size)
+    {
+        const auto chunk_size{
+            static_cast<ULONG>(std::min(size - total_read, size_t{std::numeric_limits<ULONG>::max()}))};
+        unsigned long read;
+        check_hresult(stream_->Read(destination + total_read, chunk_size, &read), wincodec::error_stream_read);
+        if (read == 0)
+            break;
+
+        total_read += read;
+    }
+
+    stream_position_ += total_read;
+    return total_read;
+#else
+    // Without IStream only memory can be read: is_memory_backed prevents calls.
+    ASSERT(false);
+    return 0;
+#endif
+}
@@ -11,32 +11,123 @@ import <win.hpp>;
 import std;
 import winrt;
 
+import memory_pool;
+
+// Purpose: reads the header and pixel data of a Netpbm file from an IStream or from memory.
+//          Reading from memory only depends on the C++ standard library (and the Windows integer types): the
+//          benchmark also measures it on other platforms, where the IStream parts are not compiled.
+
 export class buffered_stream_reader final
 {
 public:
-    explicit buffered_stream_reader(_In_ IStream* stream);
+    /// <summary>
+    /// Size of the first read, enough for the header of almost all Netpbm files.
+    /// </summary>
+    static constexpr size_t header_read_size{4096};
+
+#ifdef _WIN32
+    /// <summary>
+    /// Creates a reader for the stream. The first read is limited to initial_read_size bytes (and the size of the
+    /// stream), the buffer grows to larger reads when more data is needed. The read buffer is allocated from
+    /// memory_resource.
+    /// </summary>
+    explicit buffered_stream_reader(_In_ IStream* stream, size_t initial_read_size = header_read_size,
+                                    std::pmr::memory_resource* memory_resource = thread_memory_pool());
+#endif
+
+    /// <summary>
+    /// Reads from memory (for example a memory mapped file) instead of a stream: read_span returns views on data.
+    /// The memory resource is only used by read_bytes and by the callers that allocate scratch memory for the decode.
+    /// </summary>
+    explicit buffered_stream_reader(std::span<const std::byte> data,
+                                    std::pmr::memory_resource* memory_resource = thread_memory_pool()) noexcept;
 
     [[nodiscard]] std::uint32_t read_int();
+
+    /// <summary>
+    /// Reads a header word (a PAM keyword or tuple type) of at most 64 characters. The view is valid until the next
+    /// read.
+    /// </summary>
+    [[nodiscard]] std::string_view read_word();
     [[nodiscard]] bool try_read_bytes(void* buffer, size_t size);
     void read_bytes(void* buffer, size_t size);
 
-    [[nodiscard]] std::vector<std::byte> read_bytes(const size_t size)
+    [[nodiscard]] std::pmr::vector<std::byte> read_bytes(const size_t size)
     {
-        std::vector<std::byte> bytes(size);
+        std::pmr::vector<std::byte> bytes(size, memory_resource_);
         read_bytes(bytes.data(), bytes.size());
         return bytes;
     }
 
     void read_bytes(void* buf, ULONG count, ULONG* bytesRead);
 
+    /// <summary>
+    /// Returns a view on the next size bytes, directly from the read buffer. The view is valid until the next read.
+    /// </summary>
+    [[nodiscard]] std::span<const std::byte> read_span(size_t size);
+
+    /// <summary>
+    /// Returns a view on all remaining bytes, until the end of the stream or memory. The view is valid until the next
+    /// read.
+    /// </summary>
+    [[nodiscard]] std::span<const std::byte> read_remaining();
+
+    /// <summary>
+    /// Reads count whitespace separated decimal values (the pixel data of the plain Netpbm formats).
+    /// </summary>
+    void read_decimal_values(std::uint16_t* values, size_t count);
+
+    /// <summary>
+    /// Returns the number of bytes consumed from the stream, counted from its position at construction.
+    /// </summary>
+    [[nodiscard]] std::uint64_t position() const noexcept
+    {
+        return stream_position_ - (buffer_size_ - position_);
+    }
+
+    /// <summary>
+    /// Returns the memory resource of the reader. The decode functions that get a reader allocate their scratch memory
+    /// from it as well.
+    /// </summary>
+    [[nodiscard]] std::pmr::memory_resource* memory_resource() const noexcept
+    {
+        return memory_resource_;
+    }
+
+    /// <summary>
+    /// Returns true when the reader reads from memory: views returned by read_span then stay valid.
+    /// </summary>
+    [[nodiscard]] bool is_memory_backed() const noexcept
+    {
+#ifdef _WIN32
+        return !stream_;
+#else
+        return true;
+#endif
+    }
+
 private:
-    char read_char();
-    void skip_line();
-    void read_string(char* str, ULONG maxCount);
+    void skip_whitespace_and_comments();
     void RefillBuffer();
+    void grow_buffer(size_t capacity);
+    size_t read_from_stream(void* buffer, size_t size);
+
+    /// <summary>
+    /// Returns an upper bound of the number of bytes that can still be read from the stream.
+    /// </summary>
+    [[nodiscard]] std::uint64_t remaining_stream_size() const noexcept
+    {
+        return stream_size_ > stream_position_ ? stream_size_ - stream_position_ : 0;
+    }
 
+#ifdef _WIN32
     winrt::com_ptr<IStream> stream_;
-    std::vector<BYTE> buffer_;
+#endif
+    std::pmr::memory_resource* memory_resource_{std::pmr::get_default_resource()};
+    pooled_buffer buffer_;
+    const std::byte* data_{}; // The read buffer or the memory passed at construction.
     size_t buffer_size_{};
     size_t position_{};
+    std::uint64_t stream_position_{};
+    std::uint64_t stream_size_{std::numeric_limits<std::uint64_t>::max()}; // Unknown until Stat succeeds.
 };
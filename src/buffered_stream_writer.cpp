@@ -0,0 +1,69 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "macros.hpp"
+#include "intellisense.hpp"
+
+module buffered_stream_writer;
+
+import <win.hpp>;
+
+import errors;
+import util;
+
+
+buffered_stream_writer::buffered_stream_writer(_In_ IStream* stream, std::pmr::memory_resource* memory_resource) :
+    buffer_{buffer_size, memory_resource}
+{
+    ASSERT(stream);
+
+    stream_.copy_from(stream);
+}
+
+void buffered_stream_writer::write_bytes(const void* data, const size_t size)
+{
+    const auto* bytes{static_cast<const std::byte*>(data)};
+    if (size > buffer_.size() - position_)
+    {
+        flush();
+
+        // Large blocks are written directly, without a copy in the write buffer.
+        if (size >= buffer_.size())
+        {
+            unsigned long bytes_written;
+            check_hresult(stream_->Write(bytes, static_cast<ULONG>(size), &bytes_written),
+                          wincodec::error_stream_write);
+            check_condition(bytes_written == size, wincodec::error_stream_write);
+            return;
+        }
+    }
+
+    std::copy_n(bytes, size, buffer_.data() + position_);
+    position_ += size;
+}
+
+std::span<std::byte> buffered_stream_writer::reserve(const size_t size)
+{
+    ASSERT(size <= buffer_.size());
+
+    if (size > buffer_.size() - position_)
+    {
+        flush();
+    }
+
+    return {buffer_.data() + position_, buffer_.size() - position_};
+}
+
+void buffered_stream_writer::flush()
+{
+    if (position_ == 0)
+        return;
+
+    unsigned long bytes_written;
+    check_hresult(stream_->Write(buffer_.data(), static_cast<ULONG>(position_), &bytes_written),
+                  wincodec::error_stream_write);
+    check_condition(bytes_written == position_, wincodec::error_stream_write);
+    position_ = 0;
+}
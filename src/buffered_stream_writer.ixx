@@ -0,0 +1,60 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module buffered_stream_writer;
+
+import <win.hpp>;
+import std;
+import winrt;
+
+import memory_pool;
+
+// Purpose: the counterpart of buffered_stream_reader. Small writes (the header, the rows of a narrow image) are
+//          coalesced in a write buffer, rows can be converted directly into it.
+
+export class buffered_stream_writer final
+{
+public:
+    /// <summary>
+    /// Size of the write buffer: large writes reduce the number of Write calls.
+    /// </summary>
+    static constexpr size_t buffer_size{1024 * 1024};
+
+    /// <summary>
+    /// Creates a writer for the stream. The write buffer is allocated from memory_resource.
+    /// </summary>
+    explicit buffered_stream_writer(_In_ IStream* stream,
+                                    std::pmr::memory_resource* memory_resource = thread_memory_pool());
+
+    void write_bytes(const void* data, size_t size);
+
+    void write_string(const std::string_view text)
+    {
+        write_bytes(text.data(), text.size());
+    }
+
+    /// <summary>
+    /// Returns a view on free space of at least size bytes (at most buffer_size) in the write buffer, to convert
+    /// data directly into it. The view is valid until the next write; commit passes the bytes that are used.
+    /// </summary>
+    [[nodiscard]] std::span<std::byte> reserve(size_t size);
+
+    void commit(const size_t size) noexcept
+    {
+        position_ += size;
+    }
+
+    /// <summary>
+    /// Writes the buffered bytes to the stream. Must be called after the last write: the destructor doesn't flush.
+    /// </summary>
+    void flush();
+
+private:
+    winrt::com_ptr<IStream> stream_;
+    pooled_buffer buffer_;
+    size_t position_{};
+};
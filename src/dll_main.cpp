@@ -9,6 +9,7 @@ import <win.hpp>;
 import winrt;
 
 import netpbm_bitmap_decoder;
+import netpbm_bitmap_encoder;
 import errors;
 import guids;
 import registry;
@@ -22,11 +23,12 @@ using namespace std::string_literals;
 
 namespace {
 
-constexpr wchar_t mime_types[]{L"image/x-portable-graymap,image/x-portable-pixmap"};
-constexpr wchar_t file_extensions[]{L".pgm,.ppm"};
+constexpr wchar_t mime_types[]{
+    L"image/x-portable-bitmap,image/x-portable-graymap,image/x-portable-pixmap,image/x-portable-arbitrarymap"};
+constexpr wchar_t file_extensions[]{L".pbm,.pgm,.ppm,.pam"};
 
-void register_general_decoder_settings(const GUID& class_id, const GUID& wic_category_id, const wchar_t* friendly_name,
-                                       const std::span<const GUID*> formats)
+void register_general_codec_settings(const GUID& class_id, const GUID& wic_category_id, const wchar_t* friendly_name,
+                                     const std::span<const GUID*> formats)
 {
     const wstring sub_key = LR"(SOFTWARE\Classes\CLSID\)" + guid_to_string(class_id);
     registry::set_value(sub_key, L"ArbitrationPriority", 10);
@@ -58,7 +60,7 @@ void register_general_decoder_settings(const GUID& class_id, const GUID& wic_cat
 
     // WIC category registration.
     const wstring category_id_key{LR"(SOFTWARE\Classes\CLSID\)" + guid_to_string(wic_category_id) + LR"(\Instance\)" +
-                                  guid_to_string(id::netpbm_decoder)};
+                                  guid_to_string(class_id)};
     registry::set_value(category_id_key, L"FriendlyName", friendly_name);
     registry::set_value(category_id_key, L"CLSID", guid_to_string(class_id).c_str());
 }
@@ -101,18 +103,34 @@ void register_decoder_pattern(const wstring& sub_key, const int index, const std
 
 void register_decoder()
 {
-    array formats{&GUID_WICPixelFormat2bppGray, &GUID_WICPixelFormat4bppGray, &GUID_WICPixelFormat8bppGray,
-                  &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB};
-    register_general_decoder_settings(id::netpbm_decoder, CATID_WICBitmapDecoders, L"Team CharLS Netpbm Decoder", formats);
+    array formats{&GUID_WICPixelFormatBlackWhite, &GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray,
+                  &GUID_WICPixelFormat8bppGray,   &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB,
+                  &GUID_WICPixelFormat48bppRGB,   &GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat64bppRGBA};
+    register_general_codec_settings(id::netpbm_decoder, CATID_WICBitmapDecoders, L"Team CharLS Netpbm Decoder", formats);
 
     const wstring sub_key{LR"(SOFTWARE\Classes\CLSID\)" + guid_to_string(id::netpbm_decoder)};
 
     // Register the byte pattern that allows WICs to identify files as our image type.
     register_decoder_pattern(sub_key, 0, array{std::byte{0x50}, std::byte{0x35}});
     register_decoder_pattern(sub_key, 1, array{std::byte{0x50}, std::byte{0x36}});
+    register_decoder_pattern(sub_key, 2, array{std::byte{0x50}, std::byte{0x32}});
+    register_decoder_pattern(sub_key, 3, array{std::byte{0x50}, std::byte{0x33}});
+    register_decoder_pattern(sub_key, 4, array{std::byte{0x50}, std::byte{0x34}});
+    register_decoder_pattern(sub_key, 5, array{std::byte{0x50}, std::byte{0x37}});
 
+    register_decoder_file_extension(L"pbmfile", L".pbm", L"image/x-portable-bitmap");
     register_decoder_file_extension(L"pgmfile", L".pgm", L"image/x-portable-graymap");
     register_decoder_file_extension(L"ppmfile", L".ppm", L"image/x-portable-pixmap");
+    register_decoder_file_extension(L"pamfile", L".pam", L"image/x-portable-arbitrarymap");
+}
+
+void register_encoder()
+{
+    // The pixel formats that are written without conversion (see get_closest_pixel_format of the frame encoder).
+    array formats{&GUID_WICPixelFormatBlackWhite, &GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray,
+                  &GUID_WICPixelFormat8bppGray,   &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB,
+                  &GUID_WICPixelFormat48bppRGB,   &GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat64bppRGBA};
+    register_general_codec_settings(id::netpbm_encoder, CATID_WICBitmapEncoders, L"Team CharLS Netpbm Encoder", formats);
 }
 
 [[nodiscard]] HRESULT unregister(const GUID& class_id, const GUID& wic_category_id)
@@ -161,11 +179,19 @@ _Check_return_ HRESULT __stdcall DllGetClassObject(_In_ GUID const& class_id, _I
                                                    _Outptr_ void** result)
 try
 {
-    if (class_id != id::netpbm_decoder)
-        return error_class_not_available;
+    if (class_id == id::netpbm_decoder)
+    {
+        create_netpbm_bitmap_decoder_factory(interface_id, result);
+        return error_ok;
+    }
 
-    create_netpbm_bitmap_decoder_factory(interface_id, result);
-    return error_ok;
+    if (class_id == id::netpbm_encoder)
+    {
+        create_netpbm_bitmap_encoder_factory(interface_id, result);
+        return error_ok;
+    }
+
+    return error_class_not_available;
 }
 catch (...)
 {
@@ -185,6 +211,7 @@ try
 {
     TRACE("netpbm-wic-codec::DllRegisterServer\n");
     register_decoder();
+    register_encoder();
 
     SHChangeNotify(SHCNE_ASSOCCHANGED, SHCNF_IDLIST, nullptr, nullptr);
 
@@ -201,7 +228,9 @@ try
 {
     TRACE("netpbm-wic-codec::DllUnregisterServer\n");
     // Note: keep the file registrations intact.
-    return unregister(id::netpbm_decoder, CATID_WICBitmapDecoders);
+    const HRESULT result{unregister(id::netpbm_decoder, CATID_WICBitmapDecoders)};
+    const HRESULT encoder_result{unregister(id::netpbm_encoder, CATID_WICBitmapEncoders)};
+    return failed(result) ? result : encoder_result;
 }
 catch (...)
 {
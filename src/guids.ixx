@@ -10,6 +10,9 @@ export namespace id {
 // {06891bbe-cc02-4bb2-9cf0-303fc4e668c3}
 constexpr GUID netpbm_decoder{0x6891bbe, 0xcc02, 0x4bb2, {0x9c, 0xf0, 0x30, 0x3f, 0xc4, 0xe6, 0x68, 0xc3}};
 
+// {3f1a5d4e-8c27-4b9a-a6e2-5d0c9b7e41f3}
+constexpr GUID netpbm_encoder{0x3f1a5d4e, 0x8c27, 0x4b9a, {0xa6, 0xe2, 0x5d, 0x0c, 0x9b, 0x7e, 0x41, 0xf3}};
+
 // {70ab66f5-cd48-43a1-aa29-10131b7f4ff1}
 constexpr GUID container_format_netpbm{0x70ab66f5, 0xcd48, 0x43a1, {0xaa, 0x29, 0x10, 0x13, 0x1b, 0x7f, 0x4f, 0xf1}};
 
@@ -18,8 +18,12 @@
 
 #else
 
+#ifdef _MSC_VER
 #define ASSERT(expression) \
     __pragma(warning(push)) __pragma(warning(disable : 26493)) assert(expression) __pragma(warning(pop))
+#else
+#define ASSERT(expression) assert(expression)
+#endif
 #define VERIFY(expression) assert(expression)
 
 #endif
@@ -0,0 +1,176 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module memory_mapped_file;
+
+import std;
+import <win.hpp>;
+import winrt;
+
+import util;
+
+// Purpose: maps the local file that backs a stream into memory, to read the pixel data without copying it through a
+//          stream read buffer.
+
+export class memory_mapped_file final
+{
+public:
+    /// <summary>
+    /// Maps the file that backs the stream, when the stream is a file stream (for example created by
+    /// SHCreateStreamOnFileEx) of a file on a fixed local drive of at least minimum_size bytes. Returns nullptr for
+    /// other streams: the caller then reads the stream. The position of the stream is not changed.
+    /// </summary>
+    [[nodiscard]] static std::unique_ptr<memory_mapped_file> try_create(_In_ IStream* stream,
+                                                                       const std::uint64_t minimum_size)
+    {
+        STATSTG stat{};
+        if (failed(stream->Stat(&stat, STATFLAG_DEFAULT)))
+            return {};
+
+        const std::unique_ptr<wchar_t, decltype(&CoTaskMemFree)> name{stat.pwcsName, CoTaskMemFree};
+        if (!name || !is_absolute_drive_path(name.get()) || stat.type != STGTY_STREAM ||
+            stat.cbSize.QuadPart < std::max(minimum_size, std::uint64_t{1}) ||
+            stat.cbSize.QuadPart > std::numeric_limits<size_t>::max())
+            return {};
+
+        std::unique_ptr<memory_mapped_file> mapped_file{
+            new memory_mapped_file{name.get(), static_cast<size_t>(stat.cbSize.QuadPart), stat.mtime}};
+        if (!mapped_file->map() || !has_stream_content(stream, mapped_file->data()))
+            return {};
+
+        return mapped_file;
+    }
+
+    ~memory_mapped_file()
+    {
+        unmap();
+    }
+
+    memory_mapped_file(const memory_mapped_file&) = delete;
+    memory_mapped_file(memory_mapped_file&&) = delete;
+    memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+    memory_mapped_file& operator=(memory_mapped_file&&) = delete;
+
+    /// <summary>
+    /// Maps the view again after unmap. Returns false when the file can't be opened or no longer has the size and
+    /// last write time it had when it was mapped first.
+    /// </summary>
+    [[nodiscard]] bool map()
+    {
+        if (!view_)
+        {
+            view_ = map_view(name_.c_str(), size_, last_write_time_);
+        }
+
+        return view_ != nullptr;
+    }
+
+    /// <summary>
+    /// Releases the view: while a view exists, the file can't be truncated or resized (by the writer of the file).
+    /// </summary>
+    void unmap() noexcept
+    {
+        if (view_)
+        {
+            UnmapViewOfFile(view_);
+            view_ = nullptr;
+        }
+    }
+
+    [[nodiscard]] bool is_mapped() const noexcept
+    {
+        return view_ != nullptr;
+    }
+
+    [[nodiscard]] std::span<const std::byte> data() const noexcept
+    {
+        return {view_, size_};
+    }
+
+private:
+    memory_mapped_file(std::wstring name, const size_t size, const FILETIME last_write_time) :
+        name_{std::move(name)}, size_{size}, last_write_time_{last_write_time}
+    {
+    }
+
+    [[nodiscard]] static const std::byte* map_view(const wchar_t* name, const size_t size,
+                                                   const FILETIME& last_write_time) noexcept
+    {
+        // I/O errors on a mapped file are raised as access violations (EXCEPTION_IN_PAGE_ERROR): only map files on
+        // fixed local drives, not on network shares or removable media that can disappear while the view is used.
+        if (std::array<wchar_t, MAX_PATH + 1> volume_path;
+            !GetVolumePathNameW(name, volume_path.data(), static_cast<DWORD>(volume_path.size())) ||
+            GetDriveTypeW(volume_path.data()) != DRIVE_FIXED)
+            return nullptr;
+
+        // Without FILE_SHARE_WRITE the file can't be opened by a writer while it is mapped (and the open fails when
+        // the file is already open for writing, for example by the stream itself).
+        const winrt::file_handle file{CreateFileW(name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+        if (!file)
+            return nullptr;
+
+        if (FILE_REMOTE_PROTOCOL_INFO remote_protocol_info;
+            GetFileInformationByHandleEx(file.get(), FileRemoteProtocolInfo, &remote_protocol_info,
+                                         sizeof remote_protocol_info))
+            return nullptr;
+
+        // The name is only a hint: the opened file must have the size and last write time of the stream.
+        if (BY_HANDLE_FILE_INFORMATION file_information;
+            !GetFileInformationByHandle(file.get(), &file_information) ||
+            ((static_cast<std::uint64_t>(file_information.nFileSizeHigh) << 32) | file_information.nFileSizeLow) !=
+                size ||
+            CompareFileTime(&file_information.ftLastWriteTime, &last_write_time) != 0)
+            return nullptr;
+
+        const winrt::handle mapping{CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+        if (!mapping)
+            return nullptr;
+
+        // The view keeps the file mapping alive, the handles are no longer needed.
+        return static_cast<const std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0));
+    }
+
+    /// <summary>
+    /// Only drive letter paths (C:\...) are accepted: a relative name would be resolved against the current directory
+    /// of the process, not against the directory of the file that was opened for the stream.
+    /// </summary>
+    [[nodiscard]] static bool is_absolute_drive_path(const wchar_t* name) noexcept
+    {
+        return ((name[0] >= L'A' && name[0] <= L'Z') || (name[0] >= L'a' && name[0] <= L'z')) && name[1] == L':' &&
+               (name[2] == L'\\' || name[2] == L'/');
+    }
+
+    /// <summary>
+    /// Compares the next bytes of the stream (the header that will be parsed from the view) with the mapped file, and
+    /// restores the position of the stream.
+    /// </summary>
+    [[nodiscard]] static bool has_stream_content(IStream* stream, const std::span<const std::byte> data)
+    {
+        ULARGE_INTEGER position;
+        if (failed(stream->Seek({}, STREAM_SEEK_CUR, &position)) || position.QuadPart > data.size())
+            return false;
+
+        std::array<std::byte, 512> bytes;
+        ULONG read_count{};
+        const bool read{!failed(stream->Read(bytes.data(), static_cast<ULONG>(bytes.size()), &read_count))};
+
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(position.QuadPart);
+        if (failed(stream->Seek(offset, STREAM_SEEK_SET, nullptr)) || !read)
+            return false;
+
+        const auto mapped{data.subspan(static_cast<size_t>(position.QuadPart))};
+        return read_count == std::min(mapped.size(), bytes.size()) &&
+               std::equal(bytes.begin(), bytes.begin() + read_count, mapped.begin());
+    }
+
+    std::wstring name_;
+    size_t size_;
+    FILETIME last_write_time_;
+    const std::byte* view_{};
+};
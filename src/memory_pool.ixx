@@ -0,0 +1,175 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module memory_pool;
+
+import std;
+
+// Purpose: recycles the temporary buffers of the decoder (read buffers, row scratch) across decodes, and the pixel
+//          buffers of prefetched frames.
+//          This module only depends on the C++ standard library.
+
+using std::size_t;
+
+namespace {
+
+[[nodiscard]] std::pmr::unsynchronized_pool_resource& thread_pool_resource()
+{
+    // Read buffers are at most 1 MB, larger row scratch buffers are allocated directly from the upstream resource.
+    thread_local std::pmr::unsynchronized_pool_resource pool{
+        std::pmr::pool_options{.max_blocks_per_chunk{4}, .largest_required_pool_block{1024 * 1024}}};
+    return pool;
+}
+
+} // namespace
+
+/// <summary>
+/// Returns the default memory resource for temporary decoder allocations: a pool owned by the calling thread.
+/// The pool is not synchronized: memory must be released on the thread that allocated it, which is the case for
+/// buffers that only live during 1 call.
+/// </summary>
+export [[nodiscard]] std::pmr::memory_resource* thread_memory_pool()
+{
+    return &thread_pool_resource();
+}
+
+/// <summary>
+/// Returns the memory that the pool of the calling thread keeps for reuse (up to 1 MB blocks) to the upstream
+/// resource. Work items on thread pool threads call it before they return: the thread pool keeps idle threads alive,
+/// their pools would keep the memory until the threads exit. All memory allocated from the pool on the calling thread
+/// must be deallocated.
+/// </summary>
+export void release_thread_memory_pool() noexcept
+{
+    thread_pool_resource().release();
+}
+
+/// <summary>
+/// Uninitialized byte buffer, allocated from a memory resource.
+/// </summary>
+export class pooled_buffer final
+{
+public:
+    pooled_buffer() = default;
+
+    pooled_buffer(const size_t size, std::pmr::memory_resource* resource) :
+        data_{static_cast<std::byte*>(resource->allocate(size))}, size_{size}, resource_{resource}
+    {
+    }
+
+    ~pooled_buffer()
+    {
+        if (data_)
+        {
+            resource_->deallocate(data_, size_);
+        }
+    }
+
+    pooled_buffer(const pooled_buffer&) = delete;
+    pooled_buffer& operator=(const pooled_buffer&) = delete;
+
+    pooled_buffer(pooled_buffer&& other) noexcept :
+        data_{std::exchange(other.data_, nullptr)}, size_{std::exchange(other.size_, 0)}, resource_{other.resource_}
+    {
+    }
+
+    pooled_buffer& operator=(pooled_buffer&& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(resource_, other.resource_);
+        return *this;
+    }
+
+    [[nodiscard]] std::byte* data() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return size_;
+    }
+
+private:
+    std::byte* data_{};
+    size_t size_{};
+    std::pmr::memory_resource* resource_{};
+};
+
+/// <summary>
+/// Keeps up to max_free_blocks released blocks and reuses them for allocations with the same size and alignment.
+/// The pixel buffers of the frames of an image sequence have the same size: they are recycled instead of returned
+/// to the operating system and committed (zeroed) again for every frame. Thread safe.
+/// </summary>
+export class recycling_memory_resource final : public std::pmr::memory_resource
+{
+public:
+    explicit recycling_memory_resource(const size_t max_free_blocks,
+                                       std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+        max_free_blocks_{max_free_blocks}, upstream_{upstream}
+    {
+    }
+
+    ~recycling_memory_resource() override
+    {
+        for (const auto& [data, size, alignment] : free_blocks_)
+        {
+            upstream_->deallocate(data, size, alignment);
+        }
+    }
+
+    recycling_memory_resource(const recycling_memory_resource&) = delete;
+    recycling_memory_resource& operator=(const recycling_memory_resource&) = delete;
+    recycling_memory_resource(recycling_memory_resource&&) = delete;
+    recycling_memory_resource& operator=(recycling_memory_resource&&) = delete;
+
+private:
+    struct block final
+    {
+        void* data;
+        size_t size;
+        size_t alignment;
+    };
+
+    void* do_allocate(const size_t size, const size_t alignment) override
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            if (const auto free_block{std::ranges::find_if(
+                    free_blocks_, [&](const block& b) { return b.size == size && b.alignment == alignment; })};
+                free_block != free_blocks_.end())
+            {
+                void* data{free_block->data};
+                free_blocks_.erase(free_block);
+                return data;
+            }
+        }
+
+        return upstream_->allocate(size, alignment);
+    }
+
+    void do_deallocate(void* data, const size_t size, const size_t alignment) override
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            if (free_blocks_.size() < max_free_blocks_)
+            {
+                free_blocks_.push_back({.data{data}, .size{size}, .alignment{alignment}});
+                return;
+            }
+        }
+
+        upstream_->deallocate(data, size, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    size_t max_free_blocks_;
+    std::pmr::memory_resource* upstream_;
+    std::vector<block> free_blocks_;
+    std::mutex mutex_;
+};
@@ -11,15 +11,19 @@ import std;
 import <win.hpp>;
 import winrt;
 
+import buffered_stream_reader;
 import class_factory;
 import errors;
 import pnm_header;
 import guids;
+import memory_pool;
 import netpbm_bitmap_frame_decode;
+import settings;
 import util;
 
 using std::scoped_lock;
 using std::uint32_t;
+using std::uint64_t;
 using winrt::check_hresult;
 using winrt::com_ptr;
 using winrt::to_hresult;
@@ -28,6 +32,17 @@ namespace {
 
 struct netpbm_bitmap_decoder : winrt::implements<netpbm_bitmap_decoder, IWICBitmapDecoder>
 {
+    netpbm_bitmap_decoder() = default;
+
+    /// <summary>
+    /// Creates a decoder that allocates the temporary buffers of the decoder and its frames from memory_resource
+    /// (which must be thread safe). The default decoder uses the pool of the calling thread (thread_memory_pool).
+    /// </summary>
+    explicit netpbm_bitmap_decoder(std::shared_ptr<std::pmr::memory_resource> memory_resource) :
+        memory_resource_{std::move(memory_resource)}
+    {
+    }
+
     // IWICBitmapDecoder
     HRESULT __stdcall QueryCapability(_In_ IStream* stream, _Out_ DWORD* capability) noexcept override
     try
@@ -59,17 +74,24 @@ struct netpbm_bitmap_decoder : winrt::implements<netpbm_bitmap_decoder, IWICBitm
         return to_hresult();
     }
 
-    HRESULT __stdcall Initialize(_In_ IStream* stream,
-                                 [[maybe_unused]] const WICDecodeOptions cache_options) noexcept override
+    HRESULT __stdcall Initialize(_In_ IStream* stream, const WICDecodeOptions cache_options) noexcept override
     try
     {
         TRACE("{} netpbm_bitmap_decoder::Initialize, stream address={}, cache_options={}\n", fmt_ptr(this), fmt_ptr(stream),
               static_cast<int>(cache_options));
 
         scoped_lock lock{mutex_};
+        prefetched_frames_.clear();
         source_stream_.copy_from(check_in_pointer(stream));
+        cache_options_ = cache_options;
         bitmap_frame_decode_.attach(nullptr);
 
+        // The frames of a multi-image stream can only be located when the stream can seek.
+        ULARGE_INTEGER start_position;
+        seekable_ = !failed(stream->Seek({}, STREAM_SEEK_CUR, &start_position));
+        frame_offsets_.assign(1, seekable_ ? start_position.QuadPart : 0);
+        frame_index_complete_ = !seekable_;
+
         return error_ok;
     }
     catch (...)
@@ -154,22 +176,35 @@ struct netpbm_bitmap_decoder : winrt::implements<netpbm_bitmap_decoder, IWICBitm
         return to_hresult();
     }
 
-    HRESULT __stdcall GetThumbnail([[maybe_unused]] _Outptr_ IWICBitmapSource** thumbnail) noexcept override
+    HRESULT __stdcall GetThumbnail(_Outptr_ IWICBitmapSource** thumbnail) noexcept override
+    try
     {
-        TRACE("%p netpbm_bitmap_decoder::GetThumbnail (not supported), thumbnail address=%p\n", fmt_ptr(this),
-              fmt_ptr(thumbnail));
+        TRACE("{} netpbm_bitmap_decoder::GetThumbnail, thumbnail address={}\n", fmt_ptr(this), fmt_ptr(thumbnail));
 
-        // The Netpbm format doesn't support storing thumbnails in the file format.
-        return wincodec::error_codec_no_thumbnail;
+        // The Netpbm format doesn't support storing thumbnails in the file format, create it from the first frame.
+        scoped_lock lock{mutex_};
+        return frame(0)->GetThumbnail(thumbnail);
+    }
+    catch (...)
+    {
+        return to_hresult();
     }
 
     HRESULT __stdcall GetFrameCount(_Out_ uint32_t* count) noexcept override
     try
     {
-        TRACE("{} netpbm_bitmap_decoder::GetFrameCount (always 1), count address={}\n", fmt_ptr(this), fmt_ptr(count));
+        TRACE("{} netpbm_bitmap_decoder::GetFrameCount, count address={}\n", fmt_ptr(this), fmt_ptr(count));
+
+        check_out_pointer(count);
 
-        // Only 1 frame is supported by this implementation (no real world samples are known that have more)
-        *check_out_pointer(count) = 1;
+        scoped_lock lock{mutex_};
+        check_condition(static_cast<bool>(source_stream_), wincodec::error_not_initialized);
+        while (!frame_index_complete_)
+        {
+            index_next_frame();
+        }
+
+        *count = static_cast<uint32_t>(frame_offsets_.size());
         return error_ok;
     }
     catch (...)
@@ -183,25 +218,239 @@ struct netpbm_bitmap_decoder : winrt::implements<netpbm_bitmap_decoder, IWICBitm
         TRACE("{} netpbm_bitmap_decoder::GetFrame, index={}, bitmap_frame_decode address={}\n", fmt_ptr(this), index,
               fmt_ptr(bitmap_frame_decode));
 
-        check_condition(index == 0, wincodec::error_frame_missing);
+        check_out_pointer(bitmap_frame_decode);
 
         scoped_lock lock{mutex_};
+        frame(index).copy_to(bitmap_frame_decode);
+        prefetch_frames(index + 1);
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+private:
+    const com_ptr<IWICBitmapFrameDecode>& frame(const uint32_t index)
+    {
         check_condition(static_cast<bool>(source_stream_), wincodec::error_not_initialized);
 
-        if (!bitmap_frame_decode_)
+        // The index is only extended up to the requested frame: the previous frames are never decoded.
+        while (frame_offsets_.size() <= index && !frame_index_complete_)
         {
-            bitmap_frame_decode_ = winrt::make<netpbm_bitmap_frame_decode>(source_stream_.get(), imaging_factory());
+            index_next_frame();
         }
+        check_condition(index < frame_offsets_.size(), wincodec::error_frame_missing);
 
-        bitmap_frame_decode_.copy_to(check_out_pointer(bitmap_frame_decode));
-        return error_ok;
+        if (!bitmap_frame_decode_ || bitmap_frame_decode_index_ != index)
+        {
+            bitmap_frame_decode_ = take_prefetched_frame(index);
+            if (!bitmap_frame_decode_)
+            {
+                if (seekable_)
+                {
+                    seek(frame_offsets_[index]);
+                }
+
+                bitmap_frame_decode_ = winrt::make<netpbm_bitmap_frame_decode>(source_stream_.get(), imaging_factory(),
+                                                                               cache_options_, memory_resource_);
+            }
+            bitmap_frame_decode_index_ = index;
+        }
+
+        return bitmap_frame_decode_;
+    }
+
+    /// <summary>
+    /// Returns the prefetched frame (after waiting until it is decoded), or nullptr when the frame was not
+    /// prefetched or its prefetch failed. Frames are expected to be requested in order: the prefetched frames before
+    /// index are discarded.
+    /// </summary>
+    com_ptr<IWICBitmapFrameDecode> take_prefetched_frame(const uint32_t index)
+    {
+        while (!prefetched_frames_.empty() && prefetched_frames_.front().index < index)
+        {
+            prefetched_frames_.pop_front();
+        }
+
+        if (prefetched_frames_.empty() || prefetched_frames_.front().index != index)
+        {
+            prefetched_frames_.clear();
+            return nullptr;
+        }
+
+        // The worker may call back into the apartment of the stream: CoWaitForMultipleHandles keeps dispatching COM
+        // calls when the calling thread is a single-threaded apartment.
+        const std::shared_ptr job{std::move(prefetched_frames_.front().job)};
+        prefetched_frames_.pop_front();
+        HANDLE decoded{job->decoded.get()};
+        if (DWORD signaled_index; CoWaitForMultipleHandles(COWAIT_DEFAULT, INFINITE, 1, &decoded, &signaled_index) ==
+                                  CO_E_NOTINITIALIZED)
+        {
+            check_condition(WaitForSingleObject(decoded, INFINITE) == WAIT_OBJECT_0, error_fail);
+        }
+        return job->frame;
+    }
+
+    /// <summary>
+    /// Starts decoding the frames after the requested frame on threads of the Windows thread pool, up to the
+    /// configured number of prefetched frames. Every frame reads from its own clone of the stream (with an independent
+    /// seek position) and decodes into a buffer from a recycling memory resource: the memory use stays flat during
+    /// sequence playback. A frame that can't be prefetched is decoded by GetFrame, which reports the error.
+    /// </summary>
+    void prefetch_frames(const uint32_t first_index) noexcept
+    try
+    {
+        const uint32_t prefetch_frame_count{get_settings().prefetch_frame_count};
+        if (prefetch_frame_count == 0 || !seekable_)
+            return;
+
+        if (!frame_memory_)
+        {
+            frame_memory_ = std::make_shared<recycling_memory_resource>(prefetch_frame_count + 1);
+        }
+
+        for (uint32_t index{prefetched_frames_.empty() ? first_index : prefetched_frames_.back().index + 1};
+             prefetched_frames_.size() < prefetch_frame_count; ++index)
+        {
+            while (frame_offsets_.size() <= index && !frame_index_complete_)
+            {
+                index_next_frame();
+            }
+            if (index >= frame_offsets_.size())
+                return;
+
+            com_ptr<IStream> stream;
+            check_hresult(source_stream_->Clone(stream.put()));
+
+            LARGE_INTEGER offset;
+            offset.QuadPart = static_cast<LONGLONG>(frame_offsets_[index]);
+            check_hresult(stream->Seek(offset, STREAM_SEEK_SET, nullptr));
+
+            // The stream and the factory belong to the apartment of the caller: the worker (in the MTA) resolves
+            // agile references.
+            const auto job{std::make_shared<prefetch_job>()};
+            check_hresult(
+                RoGetAgileReference(AGILEREFERENCE_DEFAULT, IID_IStream, stream.get(), job->stream.put()));
+            job->factory.copy_from(agile_imaging_factory());
+            job->cache_options = cache_options_;
+            job->memory_resource = frame_memory_;
+            job->temporary_memory = memory_resource_;
+            submit_prefetch_job(job);
+            prefetched_frames_.push_back({.index{index}, .job{job}});
+        }
     }
     catch (...)
     {
-        return to_hresult();
+        TRACE("{} netpbm_bitmap_decoder::prefetch_frames failed, hr = {}\n", fmt_ptr(this),
+              static_cast<std::int32_t>(to_hresult()));
+    }
+
+    /// <summary>
+    /// A frame that is decoded ahead. Shared by the decoder and the worker: a decoder that is released while the frame
+    /// is decoded doesn't wait for the worker.
+    /// </summary>
+    struct prefetch_job final
+    {
+        com_ptr<IAgileReference> stream;
+        com_ptr<IAgileReference> factory;
+        WICDecodeOptions cache_options{};
+        std::shared_ptr<recycling_memory_resource> memory_resource;
+        std::shared_ptr<std::pmr::memory_resource> temporary_memory; // nullptr: the pool of the worker thread.
+        winrt::handle decoded{winrt::check_pointer(CreateEventW(nullptr, true, false, nullptr))};
+        com_ptr<IWICBitmapFrameDecode> frame; // Set before decoded is signaled, nullptr when the prefetch failed.
+    };
+
+    static void submit_prefetch_job(const std::shared_ptr<prefetch_job>& job)
+    {
+        // The callback library keeps the DLL loaded while a callback runs, also after the decoder is released.
+        TP_CALLBACK_ENVIRON environment;
+        InitializeThreadpoolEnvironment(&environment);
+        SetThreadpoolCallbackLibrary(&environment, get_current_module());
+
+        auto context{std::make_unique<std::shared_ptr<prefetch_job>>(job)};
+        const bool submitted{TrySubmitThreadpoolCallback(decode_prefetched_frame, context.get(), &environment) != 0};
+        DestroyThreadpoolEnvironment(&environment);
+        if (!submitted)
+            winrt::throw_hresult(HRESULT_FROM_WIN32(GetLastError()));
+
+        context.release();
+    }
+
+    static void __stdcall decode_prefetched_frame(PTP_CALLBACK_INSTANCE, void* context) noexcept
+    {
+        const std::unique_ptr<std::shared_ptr<prefetch_job>> job{static_cast<std::shared_ptr<prefetch_job>*>(context)};
+
+        // Thread pool threads don't belong to an apartment: the worker joins the MTA for the COM calls of the decode.
+        if (const HRESULT result{CoInitializeEx(nullptr, COINIT_MULTITHREADED)}; SUCCEEDED(result))
+        {
+            (*job)->frame = decode_frame(**job);
+            CoUninitialize();
+
+            // The buffers of the decode are released: don't keep their memory alive in an idle thread pool thread.
+            release_thread_memory_pool();
+        }
+        else
+        {
+            TRACE("netpbm_bitmap_decoder::decode_prefetched_frame, CoInitializeEx failed, hr = {}\n", result);
+        }
+
+        SetEvent((*job)->decoded.get());
+    }
+
+    [[nodiscard]] static com_ptr<IWICBitmapFrameDecode> decode_frame(const prefetch_job& job) noexcept
+    try
+    {
+        com_ptr<IStream> stream;
+        check_hresult(job.stream->Resolve(IID_PPV_ARGS(stream.put())));
+
+        com_ptr<IWICImagingFactory> factory;
+        check_hresult(job.factory->Resolve(IID_PPV_ARGS(factory.put())));
+
+        const auto frame{winrt::make_self<netpbm_bitmap_frame_decode>(stream.get(), factory.get(), job.cache_options,
+                                                                     job.temporary_memory)};
+        frame->decode_to_memory(job.memory_resource);
+        return frame.as<IWICBitmapFrameDecode>();
+    }
+    catch (...)
+    {
+        TRACE("netpbm_bitmap_decoder::decode_frame, prefetch failed, hr = {}\n", static_cast<std::int32_t>(to_hresult()));
+        return nullptr;
+    }
+
+    /// <summary>
+    /// Adds the offset of the frame after the last indexed frame, or completes the index. Only the header of the last
+    /// indexed frame is read: the size of its pixel data gives the offset of the next frame.
+    /// </summary>
+    void index_next_frame()
+    {
+        const uint64_t offset{frame_offsets_.back()};
+        seek(offset);
+        buffered_stream_reader stream_reader{source_stream_.get(), buffered_stream_reader::header_read_size,
+                                             memory_resource_ ? memory_resource_.get() : thread_memory_pool()};
+        const pnm_header header{stream_reader};
+
+        // The size of plain (ASCII) pixel data is only known after parsing it: a plain image ends the index.
+        const uint64_t next_offset{offset + stream_reader.position() + header.pixel_data_size()};
+        LARGE_INTEGER next_position;
+        next_position.QuadPart = static_cast<LONGLONG>(next_offset);
+        if (header.AsciiFormat || failed(source_stream_->Seek(next_position, STREAM_SEEK_SET, nullptr)) ||
+            !is_pnm_file(source_stream_.get()))
+        {
+            frame_index_complete_ = true;
+            return;
+        }
+
+        frame_offsets_.push_back(next_offset);
+    }
+
+    void seek(const uint64_t position) const
+    {
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(position);
+        check_hresult(source_stream_->Seek(offset, STREAM_SEEK_SET, nullptr));
     }
 
-private:
     IWICImagingFactory* imaging_factory()
     {
         if (!imaging_factory_)
@@ -213,10 +462,40 @@ struct netpbm_bitmap_decoder : winrt::implements<netpbm_bitmap_decoder, IWICBitm
         return imaging_factory_.get();
     }
 
+    /// <summary>
+    /// Returns an agile reference to the imaging factory of the decoder, created once: the prefetch workers share the
+    /// factory instead of creating one per frame.
+    /// </summary>
+    IAgileReference* agile_imaging_factory()
+    {
+        if (!agile_imaging_factory_)
+        {
+            check_hresult(RoGetAgileReference(AGILEREFERENCE_DEFAULT, IID_IWICImagingFactory, imaging_factory(),
+                                              agile_imaging_factory_.put()));
+        }
+
+        return agile_imaging_factory_.get();
+    }
+
     std::mutex mutex_;
     com_ptr<IWICImagingFactory> imaging_factory_;
+    com_ptr<IAgileReference> agile_imaging_factory_;
     com_ptr<IStream> source_stream_;
+    WICDecodeOptions cache_options_{WICDecodeMetadataCacheOnDemand};
     com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode_;
+    uint32_t bitmap_frame_decode_index_{};
+    bool seekable_{};
+    std::vector<uint64_t> frame_offsets_; // Start position of every frame found so far.
+    bool frame_index_complete_{};
+
+    struct prefetched_frame final
+    {
+        uint32_t index;
+        std::shared_ptr<prefetch_job> job;
+    };
+    std::deque<prefetched_frame> prefetched_frames_;
+    std::shared_ptr<recycling_memory_resource> frame_memory_;
+    std::shared_ptr<std::pmr::memory_resource> memory_resource_; // nullptr: the pool of the calling thread.
 };
 
 } // namespace
@@ -0,0 +1,202 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "macros.hpp"
+
+module netpbm_bitmap_encoder;
+
+import std;
+import <win.hpp>;
+import winrt;
+
+import class_factory;
+import errors;
+import guids;
+import netpbm_bitmap_frame_encode;
+import util;
+
+using std::scoped_lock;
+using std::uint32_t;
+using winrt::check_hresult;
+using winrt::com_ptr;
+using winrt::to_hresult;
+
+namespace {
+
+struct netpbm_bitmap_encoder : winrt::implements<netpbm_bitmap_encoder, IWICBitmapEncoder>
+{
+    // IWICBitmapEncoder
+    HRESULT __stdcall Initialize(_In_ IStream* destination,
+                                 const WICBitmapEncoderCacheOption cache_option) noexcept override
+    try
+    {
+        TRACE("{} netpbm_bitmap_encoder::Initialize, destination address={}, cache_option={}\n", fmt_ptr(this),
+              fmt_ptr(destination), static_cast<int>(cache_option));
+
+        check_in_pointer(destination);
+
+        scoped_lock lock{mutex_};
+        check_condition(!destination_, wincodec::error_wrong_state);
+        destination_.copy_from(destination);
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall GetContainerFormat(_Out_ GUID* container_format) noexcept override
+    try
+    {
+        TRACE("{} netpbm_bitmap_encoder::GetContainerFormat, container_format address={}\n", fmt_ptr(this),
+              fmt_ptr(container_format));
+
+        *check_out_pointer(container_format) = id::container_format_netpbm;
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall GetEncoderInfo(_Outptr_ IWICBitmapEncoderInfo** encoder_info) noexcept override
+    try
+    {
+        TRACE("{} netpbm_bitmap_encoder::GetEncoderInfo, encoder_info address={}\n", fmt_ptr(this),
+              fmt_ptr(encoder_info));
+
+        com_ptr<IWICComponentInfo> component_info;
+        check_hresult(imaging_factory()->CreateComponentInfo(id::netpbm_encoder, component_info.put()));
+        check_hresult(component_info->QueryInterface(IID_PPV_ARGS(encoder_info)));
+
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall SetColorContexts([[maybe_unused]] const uint32_t count,
+                                       [[maybe_unused]] IWICColorContext** color_context) noexcept override
+    {
+        TRACE("{} netpbm_bitmap_encoder::SetColorContexts (not supported), count={}, color_context address={}\n",
+              fmt_ptr(this), count, fmt_ptr(color_context));
+
+        // The Netpbm format doesn't support storing color contexts (ICC profiles) in the file format.
+        return wincodec::error_unsupported_operation;
+    }
+
+    HRESULT __stdcall SetPalette([[maybe_unused]] IWICPalette* palette) noexcept override
+    {
+        TRACE("{} netpbm_bitmap_encoder::SetPalette (not supported), palette address={}\n", fmt_ptr(this),
+              fmt_ptr(palette));
+
+        // NetPbm images don't have palettes.
+        return wincodec::error_unsupported_operation;
+    }
+
+    HRESULT __stdcall SetThumbnail([[maybe_unused]] IWICBitmapSource* thumbnail) noexcept override
+    {
+        TRACE("{} netpbm_bitmap_encoder::SetThumbnail (not supported), thumbnail address={}\n", fmt_ptr(this),
+              fmt_ptr(thumbnail));
+
+        // The Netpbm format doesn't support storing thumbnails in the file format.
+        return wincodec::error_unsupported_operation;
+    }
+
+    HRESULT __stdcall SetPreview([[maybe_unused]] IWICBitmapSource* preview) noexcept override
+    {
+        TRACE("{} netpbm_bitmap_encoder::SetPreview (not supported), preview address={}\n", fmt_ptr(this),
+              fmt_ptr(preview));
+
+        // The Netpbm format doesn't support storing previews in the file format.
+        return wincodec::error_unsupported_operation;
+    }
+
+    HRESULT __stdcall CreateNewFrame(_Outptr_ IWICBitmapFrameEncode** frame_encode,
+                                     IPropertyBag2** encoder_options) noexcept override
+    try
+    {
+        TRACE("{} netpbm_bitmap_encoder::CreateNewFrame, frame_encode address={}, encoder_options address={}\n",
+              fmt_ptr(this), fmt_ptr(frame_encode), fmt_ptr(encoder_options));
+
+        check_out_pointer(frame_encode);
+
+        scoped_lock lock{mutex_};
+        check_condition(static_cast<bool>(destination_), wincodec::error_not_initialized);
+
+        // Images of a multi-image stream are written one after the other: the previous frame must be complete.
+        check_condition(!committed_ && (!frame_encode_ || frame_encode_->is_committed()), wincodec::error_wrong_state);
+
+        if (encoder_options)
+        {
+            PROPBAG2 option{};
+            option.dwType = PROPBAG2_TYPE_DATA;
+            option.vt = VT_BOOL;
+            option.pstrName = const_cast<LPOLESTR>(ascii_format_option_name);
+
+            com_ptr<IWICComponentFactory> component_factory;
+            check_hresult(imaging_factory()->QueryInterface(IID_PPV_ARGS(component_factory.put())));
+            check_hresult(component_factory->CreateEncoderPropertyBag(&option, 1, encoder_options));
+        }
+
+        frame_encode_ = winrt::make_self<netpbm_bitmap_frame_encode>(destination_.get());
+        frame_encode_.as<IWICBitmapFrameEncode>().copy_to(frame_encode);
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall Commit() noexcept override
+    try
+    {
+        TRACE("{} netpbm_bitmap_encoder::Commit\n", fmt_ptr(this));
+
+        scoped_lock lock{mutex_};
+        check_condition(!committed_ && frame_encode_ && frame_encode_->is_committed(), wincodec::error_wrong_state);
+        committed_ = true;
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall GetMetadataQueryWriter(
+        [[maybe_unused]] _Outptr_ IWICMetadataQueryWriter** metadata_query_writer) noexcept override
+    {
+        TRACE("{} netpbm_bitmap_encoder::GetMetadataQueryWriter (not supported), metadata_query_writer address={}\n",
+              fmt_ptr(this), fmt_ptr(metadata_query_writer));
+
+        return wincodec::error_unsupported_operation;
+    }
+
+private:
+    IWICImagingFactory* imaging_factory()
+    {
+        if (!imaging_factory_)
+        {
+            check_hresult(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                                           IID_PPV_ARGS(imaging_factory_.put())));
+        }
+
+        return imaging_factory_.get();
+    }
+
+    std::mutex mutex_;
+    com_ptr<IWICImagingFactory> imaging_factory_;
+    com_ptr<IStream> destination_;
+    com_ptr<netpbm_bitmap_frame_encode> frame_encode_; // The last created frame.
+    bool committed_{};
+};
+
+} // namespace
+
+void create_netpbm_bitmap_encoder_factory(GUID const& interface_id, void** result)
+{
+    check_hresult(winrt::make<class_factory<netpbm_bitmap_encoder>>()->QueryInterface(interface_id, result));
+}
@@ -0,0 +1,8 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module netpbm_bitmap_encoder;
+
+import <win.hpp>;
+
+export void create_netpbm_bitmap_encoder_factory(GUID const& interface_id, void** result);
@@ -12,16 +12,21 @@ import <win.hpp>;
 import winrt;
 
 import errors;
+import ascii_parser;
+import band_pipeline;
 import buffered_stream_reader;
+import memory_pool;
+import pixel_conversion;
 import pnm_header;
+import settings;
 import util;
 
 using std::int32_t;
+using std::scoped_lock;
 using std::span;
 using std::uint16_t;
 using std::uint32_t;
-using std::byteswap;
-using std::ranges::transform;
+using std::uint64_t;
 using winrt::check_hresult;
 using winrt::com_ptr;
 using winrt::throw_hresult;
@@ -30,265 +35,635 @@ using winrt::to_hresult;
 
 namespace {
 
-[[nodiscard]] std::pair<GUID, uint32_t> get_pixel_format_and_shift(const PnmType type, const uint32_t bits_per_sample)
+/// <summary>
+/// Returns the number of bits per sample that is used to store and convert the samples. Gray, gray + alpha and RGB
+/// samples with a maximum value that is not the maximum of a WIC pixel format (1, 3, 15, 255 or 65535) are rescaled to
+/// 8 or 16 bits. A left shift would not fill the low bits (4095 << 4 = 65520): 10 and 12 bit samples are rescaled as
+/// well.
+/// </summary>
+[[nodiscard]] uint32_t get_bits_per_sample(const pnm_header& header) noexcept
 {
-    switch (type)
+    const auto bits_per_sample{static_cast<uint32_t>(std::bit_width(header.MaxColorValue))};
+    const bool complete_range{std::has_single_bit(header.MaxColorValue + 1U)};
+
+    switch (header.tuple_type)
+    {
+    case TupleType::Grayscale:
+        if (complete_range &&
+            (bits_per_sample == 2 || bits_per_sample == 4 || bits_per_sample == 8 || bits_per_sample == 16))
+            return bits_per_sample;
+        break;
+
+    case TupleType::GrayscaleAlpha:
+    case TupleType::Rgb:
+    case TupleType::RgbAlpha:
+        if (complete_range && (bits_per_sample == 8 || bits_per_sample == 16))
+            return bits_per_sample;
+        break;
+
+    default:
+        return bits_per_sample;
+    }
+
+    return bits_per_sample > 8 ? 16 : 8;
+}
+
+[[nodiscard]] GUID get_pixel_format(const pnm_header& header, const uint32_t bits_per_sample)
+{
+    switch (header.tuple_type)
     {
-    case PnmType::Bitmap:
+    case TupleType::BlackAndWhite:
+        // PAM black and white samples are not packed: only P4 bitmaps map directly to BlackWhite.
+        if (header.PnmType == PnmType::Bitmap)
+            return GUID_WICPixelFormatBlackWhite;
         break;
 
-    case PnmType::Graymap:
+    case TupleType::Grayscale:
         switch (bits_per_sample)
         {
         case 2:
-            return {GUID_WICPixelFormat2bppGray, 0};
+            return GUID_WICPixelFormat2bppGray;
 
         case 4:
-            return {GUID_WICPixelFormat4bppGray, 0};
+            return GUID_WICPixelFormat4bppGray;
 
         case 8:
-            return {GUID_WICPixelFormat8bppGray, 0};
+            return GUID_WICPixelFormat8bppGray;
 
-        case 10:
-        case 12:
         case 16:
-            return {GUID_WICPixelFormat16bppGray, 16 - bits_per_sample};
+            return GUID_WICPixelFormat16bppGray;
 
         default:
             break;
         }
         break;
 
-    case PnmType::Pixmap:
+    case TupleType::Rgb:
         switch (bits_per_sample)
         {
         case 8:
-            return {GUID_WICPixelFormat24bppRGB, 0};
+            return GUID_WICPixelFormat24bppRGB;
         case 16:
-            return {GUID_WICPixelFormat48bppRGB, 0};
+            return GUID_WICPixelFormat48bppRGB;
         default:
             break;
         }
         break;
+
+    case TupleType::GrayscaleAlpha:
+    case TupleType::RgbAlpha:
+        // WIC has no gray + alpha pixel format: these samples are expanded to RGBA.
+        switch (bits_per_sample)
+        {
+        case 8:
+            return GUID_WICPixelFormat32bppRGBA;
+        case 16:
+            return GUID_WICPixelFormat64bppRGBA;
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
     }
 
     throw_hresult(wincodec::error_unsupported_pixel_format);
 }
 
-constexpr void convert_to_little_endian(span<uint16_t> samples) noexcept
+/// <summary>
+/// Returns true when the samples are rescaled to the output range: the maximum value is not 2^bits_per_sample - 1.
+/// </summary>
+[[nodiscard]] constexpr bool is_rescaled(const pixel_layout& layout) noexcept
 {
-    transform(samples, samples.begin(), [](const uint16_t sample) noexcept -> uint16_t { return byteswap(sample); });
+    return layout.max_value != (1U << layout.bits_per_sample) - 1;
 }
 
-constexpr void convert_to_little_endian_and_shift(span<uint16_t> samples, const uint32_t sample_shift) noexcept
+/// <summary>
+/// Returns the layout to decode the pixels in the requested pixel format, or nothing if that format is not supported.
+/// 16 bit gray and RGB pixels can also be returned with 8 bit samples: most consumers convert them to 8 bit anyway,
+/// the rescale from the maximum value is done in the same pass as the byte swap.
+/// RGB pixels can also be returned in the BGR(A) order that is used to render, the samples are swizzled while the
+/// rows are copied.
+/// </summary>
+[[nodiscard]] std::optional<pixel_layout> try_get_output_layout(const pixel_layout& layout, const GUID& pixel_format)
 {
-    transform(samples, samples.begin(), [sample_shift](const uint16_t sample) noexcept -> uint16_t {
-        return byteswap(sample) << sample_shift;
-    });
-}
+    if (pixel_format == layout.pixel_format)
+        return layout;
 
-constexpr void convert_to_little_endian_and_optional_shift(const span<uint16_t> samples,
-                                                           const uint32_t sample_shift) noexcept
-{
-    if (sample_shift == 0)
+    pixel_layout output_layout{layout};
+    output_layout.pixel_format = pixel_format;
+
+    if (layout.pixel_format == GUID_WICPixelFormat16bppGray && pixel_format == GUID_WICPixelFormat8bppGray)
     {
-        convert_to_little_endian(samples);
+        output_layout.bitmap_bits_per_sample = 8;
+        return output_layout;
     }
-    else
+
+    if (layout.pixel_format == GUID_WICPixelFormat48bppRGB &&
+        (pixel_format == GUID_WICPixelFormat24bppRGB || pixel_format == GUID_WICPixelFormat24bppBGR))
     {
-        convert_to_little_endian_and_shift(samples, sample_shift);
+        output_layout.bitmap_bits_per_sample = 8;
+        output_layout.bgr_order = pixel_format == GUID_WICPixelFormat24bppBGR;
+        return output_layout;
     }
-}
 
-void pack_to_crumbs(const span<const std::byte> byte_pixels, std::byte* crumb_pixels, const size_t width,
-                    const size_t height, const size_t stride) noexcept
-{
-    for (size_t j{}, row{}; row != height; ++row)
+    if (layout.pixel_format == GUID_WICPixelFormat24bppRGB)
     {
-        std::byte* crumb_row{crumb_pixels + (row * stride)};
-        size_t i{};
-        for (; i != width / 4; ++i)
+        // All pixels are opaque: premultiplied BGRA is identical to BGRA.
+        if (pixel_format == GUID_WICPixelFormat24bppBGR)
         {
-            std::byte value{byte_pixels[j++] << 6};
-            value |= byte_pixels[j++] << 4;
-            value |= byte_pixels[j++] << 2;
-            value |= byte_pixels[j++];
-            crumb_row[i] = value;
+            output_layout.bgr_order = true;
+            return output_layout;
         }
 
-        switch (width % 4)
+        if ((pixel_format == GUID_WICPixelFormat32bppBGRA || pixel_format == GUID_WICPixelFormat32bppPBGRA) &&
+            !is_rescaled(layout))
         {
-        case 3:
-            crumb_row[i] = byte_pixels[j++] << 6;
-            [[fallthrough]];
-
-        case 2:
-            crumb_row[i] |= byte_pixels[j++] << 4;
-            [[fallthrough]];
-
-        case 1:
-            crumb_row[i] |= byte_pixels[j++] << 2;
-            break;
-
-        default:
-            break;
+            output_layout.bitmap_samples_per_pixel = 4;
+            output_layout.bgr_order = true;
+            return output_layout;
         }
     }
+
+    return {};
 }
 
-void pack_to_nibbles(const span<const std::byte> byte_pixels, std::byte* nibble_pixels, const size_t width,
-                     const size_t height, const size_t stride) noexcept
+[[nodiscard]] constexpr size_t bytes_per_sample(const pixel_layout& layout) noexcept
 {
-    for (size_t j{}, row{}; row != height; ++row)
-    {
-        std::byte* nibble_row{nibble_pixels + (row * stride)};
-        size_t i{};
-        for (; i != width / 2; ++i)
-        {
-            nibble_row[i] = byte_pixels[j++] << 4;
-            nibble_row[i] |= byte_pixels[j++];
-        }
-        if (width % 2)
-        {
-            nibble_row[i] = byte_pixels[j++] << 4;
-        }
-    }
+    return layout.bits_per_sample > 8 ? 2 : 1;
 }
 
-void pack_to_bytes(const span<const std::byte> source_pixels, std::byte* destination_pixels, const size_t width,
-                   const size_t height, const size_t stride) noexcept
+/// <summary>
+/// Returns the size in bytes of pixel_count pixels, as stored in the Netpbm file.
+/// Bitmap (P4) pixels are packed 8 per byte, other samples use 1 or 2 bytes.
+/// </summary>
+[[nodiscard]] constexpr size_t file_row_size(const pixel_layout& layout, const size_t pixel_count) noexcept
 {
-    for (size_t row{}; row != height; ++row)
-    {
-        const std::byte* source_row{source_pixels.data() + row * width};
-        std::byte* destination_row{destination_pixels + row * stride};
-        std::copy_n(source_row, width, destination_row);
-    }
+    if (layout.bits_per_sample == 1)
+        return (pixel_count + 7) / 8;
+
+    return pixel_count * layout.samples_per_pixel * bytes_per_sample(layout);
 }
 
-void pack_to_words(const span<const uint16_t> source_pixels, uint16_t* destination_pixels, const size_t width,
-                   const size_t height, const size_t stride) noexcept
+/// <summary>
+/// Returns the size in bytes of pixel_count pixels, as stored in the WIC pixel format.
+/// </summary>
+[[nodiscard]] constexpr size_t bitmap_row_size(const pixel_layout& layout, const size_t pixel_count) noexcept
 {
-    for (size_t row{}; row != height; ++row)
-    {
-        const uint16_t* source_row{source_pixels.data() + row * width};
-        uint16_t* destination_row{destination_pixels + row * (stride / 2)};
-        std::copy_n(source_row, width, destination_row);
-    }
+    if (layout.bitmap_bits_per_sample < 8)
+        return ((pixel_count * layout.bitmap_bits_per_sample) + 7) / 8;
+
+    return pixel_count * layout.bitmap_samples_per_pixel * (layout.bitmap_bits_per_sample / 8);
+}
+
+/// <summary>
+/// Returns true when the bytes in the Netpbm file are identical to the bytes of the WIC pixel format.
+/// </summary>
+[[nodiscard]] constexpr bool is_stored_as_is(const pixel_layout& layout) noexcept
+{
+    return layout.bits_per_sample == 8 && layout.bitmap_bits_per_sample == 8 &&
+           layout.samples_per_pixel == layout.bitmap_samples_per_pixel && !layout.bgr_order && !is_rescaled(layout);
 }
 
-void decode_monochrome_bitmap(buffered_stream_reader& stream_reader, const pnm_header& header,
-                              const uint32_t bits_per_sample, const uint32_t sample_shift, const uint32_t stride,
-                              span<std::byte> destination_pixels)
+/// <summary>
+/// Converts the pixels of 1 row (segment) from the Netpbm file layout into the WIC pixel format.
+/// Binary 16 bit Netpbm images are stored in big endian format (the de facto standard).
+/// Bitmap rows are stored as is, except that PBM uses 1 for black and WIC BlackWhite 1 for white.
+/// PAM gray + alpha pixels are expanded to RGBA. Samples with a maximum value that is not 2^n - 1 are rescaled to
+/// the complete 8 or 16 bit range. 16 bit samples can also be rescaled to 8 bit samples, RGB pixels swizzled to BGR(A).
+/// </summary>
+void convert_row(const pixel_layout& layout, const std::byte* source, std::byte* destination, const size_t pixel_count)
 {
-    switch (bits_per_sample)
+    switch (layout.bits_per_sample)
     {
+    case 1:
+        invert_bits(source, destination, bitmap_row_size(layout, pixel_count));
+        break;
+
     case 2:
-        pack_to_crumbs(stream_reader.read_bytes(static_cast<size_t>(header.width) * header.height),
-                       destination_pixels.data(), header.width, header.height, stride);
+        pack_row_to_crumbs(source, destination, pixel_count);
         break;
 
     case 4:
-        pack_to_nibbles(stream_reader.read_bytes(static_cast<size_t>(header.width) * header.height),
-                        destination_pixels.data(), header.width, header.height, stride);
+        pack_row_to_nibbles(source, destination, pixel_count);
         break;
 
     case 8:
-        if (header.width % stride == 0)
+        if (layout.samples_per_pixel != layout.bitmap_samples_per_pixel)
+        {
+            if (layout.bgr_order)
+            {
+                expand_rgb_to_bgra(source, destination, pixel_count);
+            }
+            else
+            {
+                expand_gray_alpha_to_rgba(source, destination, pixel_count, layout.max_value);
+            }
+            break;
+        }
+
+        if (is_rescaled(layout))
         {
-            stream_reader.read_bytes(destination_pixels.data(), destination_pixels.size());
+            rescale_8_bit(source, destination, pixel_count * layout.samples_per_pixel, layout.max_value);
+            source = destination;
         }
-        else
+
+        if (layout.bgr_order)
+        {
+            swap_red_and_blue(source, destination, pixel_count);
+        }
+        else if (source != destination)
         {
-            pack_to_bytes(stream_reader.read_bytes(static_cast<size_t>(header.width) * header.height),
-                          destination_pixels.data(), header.width, header.height, stride);
+            std::copy_n(source, pixel_count * layout.samples_per_pixel, destination);
         }
         break;
 
     default:
-        if (const auto header_width_in_bytes{static_cast<size_t>(header.width) * 2}; header_width_in_bytes % stride == 0)
+        if (layout.bitmap_bits_per_sample == 8)
         {
-            // Binary 16 bit Netpbm images are stored in big endian format (the de facto standard).
-            stream_reader.read_bytes(destination_pixels.data(), destination_pixels.size());
-            convert_to_little_endian_and_optional_shift(
-                {reinterpret_cast<uint16_t*>(destination_pixels.data()), destination_pixels.size() / sizeof uint16_t},
-                sample_shift);
+            convert_to_8_bit_and_rescale(source, destination, pixel_count * layout.samples_per_pixel,
+                                         layout.max_value);
+            if (layout.bgr_order)
+            {
+                swap_red_and_blue(destination, destination, pixel_count);
+            }
+            break;
         }
-        else
+
+        if (layout.samples_per_pixel != layout.bitmap_samples_per_pixel)
         {
-            auto samples{stream_reader.read_bytes(header_width_in_bytes * header.height)};
-            const span samples_16_bit{reinterpret_cast<uint16_t*>(samples.data()), samples.size() / sizeof uint16_t};
-            convert_to_little_endian_and_optional_shift(samples_16_bit, sample_shift);
-            pack_to_words(samples_16_bit, reinterpret_cast<uint16_t*>(destination_pixels.data()), header.width,
-                          header.height, stride);
+            expand_big_endian_gray_alpha_to_rgba(source, reinterpret_cast<uint16_t*>(destination), pixel_count,
+                                                 layout.max_value);
+            break;
         }
+
+        if (is_rescaled(layout))
+        {
+            convert_to_little_endian_and_rescale(source, reinterpret_cast<uint16_t*>(destination),
+                                                 pixel_count * layout.samples_per_pixel, layout.max_value);
+            break;
+        }
+
+        convert_to_little_endian(source, reinterpret_cast<uint16_t*>(destination), pixel_count * layout.samples_per_pixel);
         break;
     }
 }
 
-void decode_color_bitmap(buffered_stream_reader& stream_reader, const pnm_header& header, const uint32_t bits_per_sample,
-                         const uint32_t stride, span<std::byte> destination_samples)
+/// <summary>
+/// Reads bands of rows on the calling thread, while the previous band is converted by worker threads.
+/// </summary>
+void decode_rows_parallel(buffered_stream_reader& stream_reader, const pixel_layout& layout, const size_t row_count,
+                          const size_t stride, std::byte* destination, const size_t thread_count)
 {
-    constexpr size_t sample_per_pixel{3};
+    constexpr size_t band_size{4 * 1024 * 1024};
+    const size_t row_size{file_row_size(layout, layout.width)};
+    const size_t rows_per_band{std::max(band_size / row_size, thread_count)};
 
-    switch (bits_per_sample)
+    // A memory backed reader returns views that stay valid: the workers convert directly from them.
+    // 16 bit samples and bitmap pixels have the same size in the file and in the bitmap: read them into the
+    // destination rows and convert them in place. Packed pixels need a raw band buffer, 1 to read and 1 to convert.
+    const bool memory_backed{stream_reader.is_memory_backed()};
+    const bool in_place{!memory_backed && row_size == bitmap_row_size(layout, layout.width)};
+    std::array<pooled_buffer, 2> band_buffers;
+    if (!memory_backed && !in_place)
     {
-    case 8:
-        if (const auto header_width_in_bytes{header.width * sample_per_pixel}; header_width_in_bytes % stride == 0)
+        for (auto& band_buffer : band_buffers)
         {
-            stream_reader.read_bytes(destination_samples.data(), destination_samples.size());
+            band_buffer = pooled_buffer{rows_per_band * row_size, stream_reader.memory_resource()};
+        }
+    }
+    std::array<const std::byte*, 2> bands{};
+
+    const auto raw_row{[&](const size_t band, const size_t row) noexcept -> const std::byte* {
+        return in_place ? destination + (row * stride) : bands[band % 2] + ((row % rows_per_band) * row_size);
+    }};
+
+    run_band_pipeline(
+        row_count, rows_per_band, thread_count,
+        [&](const size_t band, const size_t first_row, const size_t band_row_count) {
+            if (memory_backed)
+            {
+                bands[band % 2] = stream_reader.read_span(band_row_count * row_size).data();
+                return;
+            }
+
+            if (!in_place)
+            {
+                stream_reader.read_bytes(band_buffers[band % 2].data(), band_row_count * row_size);
+                bands[band % 2] = band_buffers[band % 2].data();
+                return;
+            }
+
+            for (size_t row{first_row}; row != first_row + band_row_count; ++row)
+            {
+                stream_reader.read_bytes(destination + (row * stride), row_size);
+            }
+        },
+        [&](const size_t band, const size_t first_row, const size_t band_row_count) noexcept {
+            for (size_t row{first_row}; row != first_row + band_row_count; ++row)
+            {
+                convert_row(layout, raw_row(band, row), destination + (row * stride), layout.width);
+            }
+        });
+}
+
+/// <summary>
+/// Decodes complete rows, starting at the current position of the stream reader. The rows are converted directly
+/// from the read buffer into the destination rows, without a temporary copy of the complete image.
+/// </summary>
+void decode_rows(buffered_stream_reader& stream_reader, const pixel_layout& layout, const size_t row_count,
+                 const size_t stride, std::byte* destination)
+{
+    const size_t row_size{file_row_size(layout, layout.width)};
+
+    if (is_stored_as_is(layout))
+    {
+        // 8 bit samples are stored as is: read them directly into the destination.
+        if (row_size == stride)
+        {
+            stream_reader.read_bytes(destination, row_size * row_count);
         }
         else
         {
-            std::byte* line{destination_samples.data()};
-            for (uint32_t row{header.height}; row; --row)
+            for (size_t row{}; row != row_count; ++row)
             {
-                stream_reader.read_bytes(line, header.width * size_t{3});
-                line += stride;
+                stream_reader.read_bytes(destination + (row * stride), row_size);
             }
         }
-        break;
+        return;
+    }
+
+    if (const auto& settings{get_settings()};
+        settings.thread_count > 1 && row_size * row_count >= settings.parallel_threshold)
+    {
+        decode_rows_parallel(stream_reader, layout, row_count, stride, destination, settings.thread_count);
+        return;
+    }
+
+    for (size_t row{}; row != row_count; ++row)
+    {
+        convert_row(layout, stream_reader.read_span(row_size).data(), destination + (row * stride), layout.width);
+    }
+}
+
+/// <summary>
+/// Converts the parsed values of 1 row of a plain (ASCII) Netpbm image into the WIC pixel format.
+/// byte_samples is scratch memory for 1 row of 2 and 4 bit samples.
+/// </summary>
+void convert_ascii_row(const pixel_layout& layout, const span<const uint16_t> samples, std::byte* destination,
+                       std::byte* byte_samples)
+{
+    check_condition(std::ranges::max(samples) <= layout.max_value, wincodec::error_bad_stream_data);
+
+    const bool rescaled{is_rescaled(layout)};
+    if (bytes_per_sample(layout) == 2)
+    {
+        std::ranges::transform(samples, reinterpret_cast<uint16_t*>(destination), [&](const uint16_t sample) {
+            return static_cast<uint16_t>(rescaled ? ((sample * 65535U) + (layout.max_value / 2)) / layout.max_value
+                                                  : sample);
+        });
+        return;
+    }
+
+    std::byte* bytes{layout.bits_per_sample == 8 ? destination : byte_samples};
+    std::ranges::transform(samples, bytes, [&](const uint16_t sample) {
+        return static_cast<std::byte>(rescaled ? ((sample * 255U) + (layout.max_value / 2)) / layout.max_value
+                                               : sample);
+    });
+    if (bytes != destination)
+    {
+        convert_row(layout, bytes, destination, layout.width);
+    }
+}
+
+/// <summary>
+/// Decodes the rows of a plain (ASCII) Netpbm image: every sample is a whitespace separated decimal value.
+/// Plain rows have a variable size, large images are parsed in parallel chunks of the complete pixel data.
+/// </summary>
+void decode_ascii_rows(buffered_stream_reader& stream_reader, const pixel_layout& layout, const size_t stride,
+                       std::byte* destination)
+{
+    const size_t sample_count{static_cast<size_t>(layout.width) * layout.samples_per_pixel};
+    const pooled_buffer byte_samples{layout.bits_per_sample < 8 ? sample_count : 0, stream_reader.memory_resource()};
+
+    // Every value is at least 1 digit and 1 whitespace character.
+    if (const auto& settings{get_settings()};
+        settings.thread_count > 1 && sample_count * layout.height * 2 >= settings.parallel_threshold)
+    {
+        const auto text{stream_reader.read_remaining()};
+        std::pmr::vector<uint16_t> samples(sample_count * layout.height, stream_reader.memory_resource());
+        const auto [consumed, value_count, valid]{
+            parse_decimal_values_parallel(text.data(), text.size(), samples.data(), samples.size(), settings.thread_count)};
+        check_condition(valid && value_count == samples.size(), wincodec::error_bad_stream_data);
 
-    case 16: {
-        constexpr size_t bytes_per_sample{2};
-        if (const auto header_width_in_bytes{header.width * sample_per_pixel * bytes_per_sample};
-            header_width_in_bytes % stride == 0)
+        // Converting the values is cheap compared to parsing them.
+        for (size_t row{}; row != layout.height; ++row)
         {
-            stream_reader.read_bytes(destination_samples.data(), destination_samples.size());
+            convert_ascii_row(layout, span{samples}.subspan(row * sample_count, sample_count),
+                              destination + (row * stride), byte_samples.data());
         }
-        else
+        return;
+    }
+
+    std::pmr::vector<uint16_t> samples(sample_count, stream_reader.memory_resource());
+    for (size_t row{}; row != layout.height; ++row)
+    {
+        stream_reader.read_decimal_values(samples.data(), sample_count);
+        convert_ascii_row(layout, samples, destination + (row * stride), byte_samples.data());
+    }
+}
+
+void seek(_In_ IStream* stream, const uint64_t position)
+{
+    LARGE_INTEGER offset;
+    offset.QuadPart = static_cast<LONGLONG>(position);
+    check_hresult(stream->Seek(offset, STREAM_SEEK_SET, nullptr));
+}
+
+void read(_In_ IStream* stream, std::byte* buffer, const size_t size)
+{
+    unsigned long bytes_read;
+    check_hresult(stream->Read(buffer, static_cast<ULONG>(size), &bytes_read), wincodec::error_stream_read);
+    check_condition(bytes_read == size, wincodec::error_bad_stream_data);
+}
+
+/// <summary>
+/// Decodes the rows of region, in the coordinates of the image downscaled by factor (power of 2 box filter), and
+/// passes every row in the Netpbm file layout to row_function. The stream reader is positioned at the first row of
+/// the region. The full resolution image is never materialized: only 1 row of vertical sums is kept in memory.
+/// </summary>
+template<typename RowFunction>
+void decode_scaled_rows(buffered_stream_reader stream_reader, const pixel_layout& layout, const WICRect& region,
+                        const size_t factor, RowFunction row_function)
+{
+    const size_t row_size{file_row_size(layout, layout.width)};
+    const auto pixel_count{static_cast<size_t>(region.Width)};
+    const auto row_count{static_cast<size_t>(region.Height)};
+    const size_t source_offset{file_row_size(layout, static_cast<size_t>(region.X) * factor)};
+
+    if (factor == 1)
+    {
+        for (size_t row{}; row != row_count; ++row)
+        {
+            row_function(row, stream_reader.read_span(row_size).data() + source_offset);
+        }
+        return;
+    }
+
+    const bool big_endian{bytes_per_sample(layout) == 2};
+    const size_t sample_count{pixel_count * factor * layout.samples_per_pixel};
+    std::pmr::vector<uint32_t> sums(sample_count, stream_reader.memory_resource());
+    const pooled_buffer scaled_row{file_row_size(layout, pixel_count), stream_reader.memory_resource()};
+
+    for (size_t row{}; row != row_count; ++row)
+    {
+        std::ranges::fill(sums, 0U);
+        for (size_t i{}; i != factor; ++i)
         {
-            std::byte* line{destination_samples.data()};
-            for (uint32_t row{header.height}; row; --row)
+            const std::byte* source{stream_reader.read_span(row_size).data() + source_offset};
+            if (big_endian)
             {
-                stream_reader.read_bytes(line, header.width * sizeof uint16_t * 3);
-                line += stride;
+                accumulate_big_endian_row(source, sums.data(), sample_count);
             }
+            else
+            {
+                accumulate_row(source, sums.data(), sample_count);
+            }
+        }
+
+        if (big_endian)
+        {
+            average_big_endian_row(sums.data(), scaled_row.data(), pixel_count, layout.samples_per_pixel, factor,
+                                   factor);
+        }
+        else
+        {
+            average_row(sums.data(), scaled_row.data(), pixel_count, layout.samples_per_pixel, factor, factor);
         }
-        convert_to_little_endian_and_optional_shift(
-            {reinterpret_cast<uint16_t*>(destination_samples.data()), destination_samples.size() / sizeof uint16_t}, 0);
+
+        row_function(row, scaled_row.data());
+    }
+}
+
+/// <summary>
+/// Returns the power of 2 factor that downscales the image to width x height (as returned by GetClosestSize).
+/// Other sizes are not supported: they fail with E_INVALIDARG, the caller must use a size from GetClosestSize or
+/// scale with IWICBitmapScaler.
+/// </summary>
+[[nodiscard]] uint32_t get_scale_factor(const pixel_layout& layout, const uint32_t width, const uint32_t height)
+{
+    for (uint32_t factor{1}; layout.width / factor != 0 && layout.height / factor != 0; factor *= 2)
+    {
+        if (layout.width / factor == width && layout.height / factor == height)
+            return factor;
     }
-    break;
+
+    throw_hresult(error_invalid_argument);
+}
+
+/// <summary>
+/// Copies count pixels of PixelSize bytes that are step bytes apart in the source (a column or a reversed row).
+/// </summary>
+template<size_t PixelSize>
+void gather_pixels(const std::byte* source, const std::ptrdiff_t step, std::byte* destination,
+                   const size_t count) noexcept
+{
+    for (size_t x{}; x != count; ++x)
+    {
+        // A copy of a constant size is compiled to 1 or 2 moves.
+        std::memcpy(destination + (x * PixelSize), source + (static_cast<std::ptrdiff_t>(x) * step), PixelSize);
+    }
+}
+
+void gather_pixels(const std::byte* source, const std::ptrdiff_t step, const size_t pixel_size, std::byte* destination,
+                   const size_t count) noexcept
+{
+    // The pixels in the file layout have 1 to 4 samples of 1 or 2 bytes.
+    switch (pixel_size)
+    {
+    case 1:
+        gather_pixels<1>(source, step, destination, count);
+        break;
+
+    case 2:
+        gather_pixels<2>(source, step, destination, count);
+        break;
+
+    case 3:
+        gather_pixels<3>(source, step, destination, count);
+        break;
+
+    case 4:
+        gather_pixels<4>(source, step, destination, count);
+        break;
+
+    case 6:
+        gather_pixels<6>(source, step, destination, count);
+        break;
 
     default:
-        ASSERT(false);
+        gather_pixels<8>(source, step, destination, count);
         break;
     }
 }
 
-[[nodiscard]] com_ptr<IWICBitmap> create_bitmap(_In_ IStream* source_stream, _In_ IWICImagingFactory* factory)
+[[nodiscard]] constexpr bool is_supported_transform(const WICBitmapTransformOptions transform) noexcept
 {
-    buffered_stream_reader stream_reader{source_stream};
-    const pnm_header header{stream_reader};
-    const uint32_t bits_per_sample{static_cast<uint32_t>(std::bit_width(header.MaxColorValue))};
-    const auto& [pixel_format, sample_shift] = get_pixel_format_and_shift(header.PnmType, bits_per_sample);
+    constexpr int supported_transforms{3 | WICBitmapTransformFlipHorizontal | WICBitmapTransformFlipVertical};
+    return (transform & ~supported_transforms) == 0;
+}
+
+[[nodiscard]] constexpr bool is_rotated_90(const WICBitmapTransformOptions transform) noexcept
+{
+    const auto rotation{transform & 3};
+    return rotation == WICBitmapTransformRotate90 || rotation == WICBitmapTransformRotate270;
+}
+
+/// <summary>
+/// Returns the region to copy and validates it against the size of the (scaled) image.
+/// </summary>
+[[nodiscard]] WICRect check_region(const WICRect* rectangle, const uint32_t width, const uint32_t height)
+{
+    const WICRect region{rectangle ? *rectangle
+                                   : WICRect{.X{0},
+                                             .Y{0},
+                                             .Width{static_cast<int32_t>(width)},
+                                             .Height{static_cast<int32_t>(height)}}};
+    check_condition(region.X >= 0 && region.Y >= 0 && region.Width > 0 && region.Height > 0 &&
+                        static_cast<uint32_t>(region.Width) <= width - static_cast<uint32_t>(region.X) &&
+                        static_cast<uint32_t>(region.Height) <= height - static_cast<uint32_t>(region.Y),
+                    error_invalid_argument);
+
+    return region;
+}
+
+void check_buffer(const pixel_layout& layout, const size_t width, const size_t height, const uint32_t stride,
+                  const uint32_t buffer_size, const BYTE* buffer)
+{
+    check_in_pointer(buffer);
 
+    // Computed in 64 bits: on 32-bit Windows the size of a large region would wrap around in size_t.
+    const uint64_t row_size{
+        ((static_cast<uint64_t>(width) * layout.bitmap_samples_per_pixel * layout.bitmap_bits_per_sample) + 7) / 8};
+    check_condition(stride >= row_size, error_invalid_argument);
+    check_condition(((static_cast<uint64_t>(height) - 1) * stride) + row_size <= buffer_size,
+                    wincodec::error_insufficient_buffer);
+}
+
+/// <summary>
+/// Creates an in-memory bitmap and lets the decode function fill its pixels.
+/// </summary>
+template<typename DecodeFunction>
+[[nodiscard]] com_ptr<IWICBitmap> create_bitmap(_In_ IWICImagingFactory* factory, const uint32_t width,
+                                                const uint32_t height, const GUID& pixel_format, DecodeFunction decode)
+{
     com_ptr<IWICBitmap> bitmap;
-    check_hresult(factory->CreateBitmap(header.width, header.height, pixel_format, WICBitmapCacheOnLoad, bitmap.put()));
+    check_hresult(factory->CreateBitmap(width, height, pixel_format, WICBitmapCacheOnLoad, bitmap.put()));
     check_hresult(bitmap->SetResolution(96., 96.));
 
     const WICRect complete_image{
-        .X{0}, .Y{0}, .Width{static_cast<int32_t>(header.width)}, .Height{static_cast<int32_t>(header.height)}};
+        .X{0}, .Y{0}, .Width{static_cast<int32_t>(width)}, .Height{static_cast<int32_t>(height)}};
     com_ptr<IWICBitmapLock> bitmap_lock;
     check_hresult(bitmap->Lock(&complete_image, WICBitmapLockWrite, bitmap_lock.put()));
 
@@ -300,62 +675,675 @@ void decode_color_bitmap(buffered_stream_reader& stream_reader, const pnm_header
     winrt::check_hresult(bitmap_lock->GetDataPointer(&data_buffer_size, reinterpret_cast<BYTE**>(&data_buffer)));
     __assume(data_buffer != nullptr);
 
-    switch (header.PnmType)
+    decode(stride, data_buffer);
+
+    return bitmap;
+}
+
+[[nodiscard]] com_ptr<IWICBitmap> create_bitmap(buffered_stream_reader& stream_reader, const pixel_layout& layout,
+                                                _In_ IWICImagingFactory* factory)
+{
+    return create_bitmap(factory, layout.width, layout.height, layout.pixel_format,
+                         [&](const uint32_t stride, std::byte* data_buffer) {
+                             decode_rows(stream_reader, layout, layout.height, stride, data_buffer);
+                         });
+}
+
+/// <summary>
+/// Bitmap source on decoded pixels in a buffer from a (recycling) memory resource. Only used for pixels of 1 or more
+/// bytes: regions start at a byte boundary.
+/// </summary>
+struct memory_bitmap_source : winrt::implements<memory_bitmap_source, IWICBitmapSource>
+{
+    memory_bitmap_source(const pixel_layout& layout, std::shared_ptr<std::pmr::memory_resource> memory_resource) :
+        layout_{layout},
+        stride_{bitmap_row_size(layout, layout.width)},
+        memory_resource_{std::move(memory_resource)},
+        pixels_{stride_ * layout.height, memory_resource_.get()}
     {
-    case PnmType::Graymap:
-        decode_monochrome_bitmap(stream_reader, header, bits_per_sample, sample_shift, stride,
-                                 {data_buffer, data_buffer_size});
-        break;
+    }
 
-    case PnmType::Pixmap:
-        decode_color_bitmap(stream_reader, header, bits_per_sample, stride, {data_buffer, data_buffer_size});
-        break;
+    [[nodiscard]] std::byte* data() const noexcept
+    {
+        return pixels_.data();
+    }
 
-    default:
-        break;
+    [[nodiscard]] uint32_t stride() const noexcept
+    {
+        return static_cast<uint32_t>(stride_);
     }
 
-    return bitmap;
-}
+    HRESULT __stdcall GetSize(uint32_t* width, uint32_t* height) noexcept override
+    try
+    {
+        *check_in_pointer(width) = layout_.width;
+        *check_in_pointer(height) = layout_.height;
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall GetPixelFormat(GUID* pixel_format) noexcept override
+    try
+    {
+        *check_in_pointer(pixel_format) = layout_.pixel_format;
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall GetResolution(double* dpi_x, double* dpi_y) noexcept override
+    try
+    {
+        *check_in_pointer(dpi_x) = 96.;
+        *check_in_pointer(dpi_y) = 96.;
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+    HRESULT __stdcall CopyPalette(IWICPalette*) noexcept override
+    {
+        return wincodec::error_palette_unavailable;
+    }
+
+    HRESULT __stdcall CopyPixels(const WICRect* rectangle, const uint32_t stride, const uint32_t buffer_size,
+                                 BYTE* buffer) noexcept override
+    try
+    {
+        const WICRect region{check_region(rectangle, layout_.width, layout_.height)};
+        const auto row_count{static_cast<size_t>(region.Height)};
+        check_buffer(layout_, static_cast<size_t>(region.Width), row_count, stride, buffer_size, buffer);
+
+        const size_t row_size{bitmap_row_size(layout_, static_cast<size_t>(region.Width))};
+        const std::byte* source{pixels_.data() + (static_cast<size_t>(region.Y) * stride_) +
+                                bitmap_row_size(layout_, static_cast<size_t>(region.X))};
+        for (size_t row{}; row != row_count; ++row)
+        {
+            std::copy_n(source + (row * stride_), row_size, reinterpret_cast<std::byte*>(buffer) + (row * stride));
+        }
+
+        return error_ok;
+    }
+    catch (...)
+    {
+        return to_hresult();
+    }
+
+private:
+    pixel_layout layout_;
+    size_t stride_;
+    std::shared_ptr<std::pmr::memory_resource> memory_resource_; // Must outlive pixels_.
+    pooled_buffer pixels_;
+};
+
+/// <summary>
+/// Maps the file for the duration of 1 call and releases the view afterwards: while a view exists, the writer of the
+/// file can't truncate or resize it. When the file changed after the frame was created, the frame continues with its
+/// clone of the stream, without a clone the pixels are no longer available.
+/// </summary>
+class mapped_view_scope final
+{
+public:
+    mapped_view_scope(std::unique_ptr<memory_mapped_file>& mapped_file, const bool has_stream) :
+        mapped_file_{mapped_file}
+    {
+        if (mapped_file_ && !mapped_file_->map())
+        {
+            mapped_file_.reset();
+            check_condition(has_stream, wincodec::error_bad_stream_data);
+        }
+    }
+
+    ~mapped_view_scope()
+    {
+        if (mapped_file_)
+        {
+            mapped_file_->unmap();
+        }
+    }
+
+    mapped_view_scope(const mapped_view_scope&) = delete;
+    mapped_view_scope(mapped_view_scope&&) = delete;
+    mapped_view_scope& operator=(const mapped_view_scope&) = delete;
+    mapped_view_scope& operator=(mapped_view_scope&&) = delete;
+
+private:
+    std::unique_ptr<memory_mapped_file>& mapped_file_;
+};
+
+// Mapping a file costs more system calls than reading a small file through the read buffer, which is at most 1 MB.
+constexpr uint64_t minimum_mapped_size{1024 * 1024};
 
 } // namespace
 
 
-netpbm_bitmap_frame_decode::netpbm_bitmap_frame_decode(_In_ IStream* source_stream, _In_ IWICImagingFactory* factory) :
-    bitmap_source_{create_bitmap(source_stream, factory)}
+netpbm_bitmap_frame_decode::netpbm_bitmap_frame_decode(_In_ IStream* source_stream, _In_ IWICImagingFactory* factory,
+                                                       const WICDecodeOptions cache_options,
+                                                       std::shared_ptr<std::pmr::memory_resource> memory_resource) :
+    memory_resource_{std::move(memory_resource)}
+{
+    ULARGE_INTEGER start_position;
+    const bool seekable{!failed(source_stream->Seek({}, STREAM_SEEK_CUR, &start_position))};
+    if (seekable)
+    {
+        mapped_file_ = memory_mapped_file::try_create(source_stream, start_position.QuadPart + minimum_mapped_size);
+    }
+
+    // The header parser is independent of the source: a mapped file is parsed directly from memory.
+    buffered_stream_reader stream_reader{
+        mapped_file_ ? create_reader(start_position.QuadPart, buffered_stream_reader::header_read_size)
+                     : buffered_stream_reader{source_stream, buffered_stream_reader::header_read_size,
+                                              temporary_memory()}};
+    const pnm_header header{stream_reader};
+    check_condition(!header.AsciiFormat || header.PnmType != PnmType::Bitmap, wincodec::error_unsupported_pixel_format);
+    const uint32_t bits_per_sample{get_bits_per_sample(header)};
+    layout_ = {.width{header.width},
+               .height{header.height},
+               .samples_per_pixel{header.depth},
+               .bitmap_samples_per_pixel{header.tuple_type == TupleType::GrayscaleAlpha ? 4U : header.depth},
+               .bits_per_sample{bits_per_sample},
+               .bitmap_bits_per_sample{bits_per_sample > 8 ? 16 : bits_per_sample},
+               .max_value{header.MaxColorValue},
+               .pixel_format{get_pixel_format(header, bits_per_sample)}};
+
+    factory_.copy_from(factory);
+    if (header.AsciiFormat)
+    {
+        // Plain rows have a variable size: the rows can only be located by parsing all previous rows.
+        bitmap_source_ = create_bitmap(factory, layout_.width, layout_.height, layout_.pixel_format,
+                                       [&](const uint32_t stride, std::byte* data_buffer) {
+                                           decode_ascii_rows(stream_reader, layout_, stride, data_buffer);
+                                       });
+        mapped_file_.reset();
+        return;
+    }
+
+    if (!seekable)
+    {
+        // The pixels can only be read once: decode the complete image into a cache.
+        bitmap_source_ = create_bitmap(stream_reader, layout_, factory);
+        return;
+    }
+
+    // Binary rows have a fixed size: any region can be decoded directly into the caller's buffer by seek arithmetic.
+    // The decoder and the other frames seek the source stream too (under their own lock): the frame reads from its
+    // own clone, which has an independent seek position. A mapped file only needs the clone when the file changes.
+    // A stream that can't be cloned (and isn't mapped) is decoded completely now.
+    if (com_ptr<IStream> clone; !failed(source_stream->Clone(clone.put())))
+    {
+        source_stream_ = std::move(clone);
+    }
+    else if (!mapped_file_)
+    {
+        bitmap_source_ = create_bitmap(stream_reader, layout_, factory);
+        return;
+    }
+
+    pixel_data_position_ = start_position.QuadPart + stream_reader.position();
+    if (cache_options == WICDecodeMetadataCacheOnLoad)
+    {
+        // The pixels are decoded by CopyPixels, but truncated pixel data must fail now, as it does for a decode on load.
+        ULARGE_INTEGER size;
+        if (mapped_file_)
+        {
+            size.QuadPart = mapped_file_->data().size();
+        }
+        else
+        {
+            check_hresult(source_stream_->Seek({}, STREAM_SEEK_END, &size));
+        }
+        check_condition(size.QuadPart - pixel_data_position_ >=
+                            uint64_t{layout_.height} * file_row_size(layout_, layout_.width),
+                        wincodec::error_bad_stream_data);
+        cache_on_load_ = true;
+    }
+
+    // The view is mapped again by the calls that read pixels.
+    if (mapped_file_)
+    {
+        mapped_file_->unmap();
+    }
+}
+
+bool netpbm_bitmap_frame_decode::is_repeated_region(const WICRect& rectangle)
+{
+    // Tiles that share rows but not columns (or the reverse) are not repeated: only overlapping pixels are.
+    const bool repeated{std::ranges::any_of(decoded_regions_, [&rectangle](const WICRect& decoded) {
+        return rectangle.X < decoded.X + decoded.Width && decoded.X < rectangle.X + rectangle.Width &&
+               rectangle.Y < decoded.Y + decoded.Height && decoded.Y < rectangle.Y + rectangle.Height;
+    })};
+    decoded_regions_.push_back(rectangle);
+
+    return repeated;
+}
+
+void netpbm_bitmap_frame_decode::create_cache()
+{
+    buffered_stream_reader stream_reader{
+        create_reader(pixel_data_position_, layout_.height * file_row_size(layout_, layout_.width))};
+    bitmap_source_ = create_bitmap(stream_reader, layout_, factory_.get());
+
+    source_stream_ = nullptr;
+    mapped_file_.reset();
+    decoded_regions_ = {};
+}
+
+void netpbm_bitmap_frame_decode::decode_to_memory(std::shared_ptr<std::pmr::memory_resource> memory_resource)
+{
+    scoped_lock lock{mutex_};
+    if (bitmap_source_)
+        return; // Already decoded.
+
+    const mapped_view_scope mapped_view{mapped_file_, source_stream_ != nullptr};
+
+    if (layout_.bits_per_sample < 8)
+    {
+        create_cache();
+        return;
+    }
+
+    const auto source{winrt::make_self<memory_bitmap_source>(layout_, std::move(memory_resource))};
+    const WICRect complete_image{
+        .X{0}, .Y{0}, .Width{static_cast<int32_t>(layout_.width)}, .Height{static_cast<int32_t>(layout_.height)}};
+    decode_rectangle(complete_image, source->stride(), source->data());
+    bitmap_source_ = source.as<IWICBitmapSource>();
+
+    source_stream_ = nullptr;
+    mapped_file_.reset();
+    decoded_regions_ = {};
+}
+
+std::pmr::memory_resource* netpbm_bitmap_frame_decode::temporary_memory() const
+{
+    return memory_resource_ ? memory_resource_.get() : thread_memory_pool();
+}
+
+buffered_stream_reader netpbm_bitmap_frame_decode::create_reader(const uint64_t position,
+                                                                 const size_t read_size) const
+{
+    if (mapped_file_)
+    {
+        const auto data{mapped_file_->data()};
+        check_condition(position <= data.size(), wincodec::error_bad_stream_data);
+        return buffered_stream_reader{data.subspan(static_cast<size_t>(position)), temporary_memory()};
+    }
+
+    seek(source_stream_.get(), position);
+    return buffered_stream_reader{source_stream_.get(), read_size, temporary_memory()};
+}
+
+span<const std::byte> netpbm_bitmap_frame_decode::read_at(const uint64_t position, const size_t size,
+                                                          std::byte* buffer) const
 {
+    if (mapped_file_)
+    {
+        const auto data{mapped_file_->data()};
+        check_condition(position <= data.size() && size <= data.size() - position, wincodec::error_bad_stream_data);
+        return data.subspan(static_cast<size_t>(position), size);
+    }
+
+    seek(source_stream_.get(), position);
+    read(source_stream_.get(), buffer, size);
+    return {buffer, size};
 }
 
+com_ptr<IWICBitmapSource> netpbm_bitmap_frame_decode::create_thumbnail() const
+{
+    // Both axes are divided by the same factor to keep the aspect ratio. A side shorter than the factor becomes 1
+    // pixel: the box that is averaged for it is clamped to the side.
+    constexpr uint32_t thumbnail_size{256};
+    const uint32_t factor{(std::max(layout_.width, layout_.height) + thumbnail_size - 1) / thumbnail_size};
+    const uint32_t thumbnail_width{std::max(layout_.width / factor, 1U)};
+    const uint32_t thumbnail_height{std::max(layout_.height / factor, 1U)};
+    const uint32_t box_width{std::min(factor, layout_.width)};
+    const uint32_t box_height{std::min(factor, layout_.height)};
+
+    // Thumbnails of bitmaps are 8-bit gray: the box filter turns areas of black and white pixels into gray levels.
+    const bool bitmap{layout_.bits_per_sample == 1};
+    const GUID& thumbnail_pixel_format{bitmap ? GUID_WICPixelFormat8bppGray : layout_.pixel_format};
+
+    if (bitmap_source_)
+    {
+        com_ptr source{bitmap_source_};
+        if (bitmap)
+        {
+            com_ptr<IWICBitmapSource> gray;
+            check_hresult(WICConvertBitmapSource(thumbnail_pixel_format, source.get(), gray.put()));
+            source = gray;
+        }
+
+        com_ptr<IWICBitmapScaler> scaler;
+        check_hresult(factory_->CreateBitmapScaler(scaler.put()));
+        check_hresult(
+            scaler->Initialize(source.get(), thumbnail_width, thumbnail_height, WICBitmapInterpolationModeFant));
+        return scaler.as<IWICBitmapSource>();
+    }
+
+    // The rows at the center of every band of box_height rows (at most 4 adjacent rows) are read with 1 read per band
+    // and averaged: reading all rows would read the complete image. The vertical sums are box filtered horizontally.
+    constexpr size_t max_band_row_count{4};
+    const size_t band_row_count{std::min(size_t{box_height}, max_band_row_count)};
+    const size_t row_size{file_row_size(layout_, layout_.width)};
+    const size_t source_width{static_cast<size_t>(thumbnail_width) * box_width};
+    const size_t samples_per_pixel{bitmap ? 1 : layout_.samples_per_pixel};
+    std::pmr::vector<uint32_t> sums(source_width * samples_per_pixel, temporary_memory());
+    const pooled_buffer downscaled{file_row_size(layout_, thumbnail_width), temporary_memory()};
+    const pooled_buffer gray{bitmap ? source_width : 0, temporary_memory()};
+
+    return create_bitmap(
+        factory_.get(), thumbnail_width, thumbnail_height, thumbnail_pixel_format,
+        [&](const uint32_t stride, std::byte* data_buffer) {
+            for (size_t row{}; row != thumbnail_height; ++row)
+            {
+                const size_t first_row{(row * box_height) + ((box_height - band_row_count) / 2)};
+                buffered_stream_reader stream_reader{
+                    create_reader(pixel_data_position_ + (first_row * row_size), band_row_count * row_size)};
+
+                std::ranges::fill(sums, 0U);
+                for (size_t i{}; i != band_row_count; ++i)
+                {
+                    const std::byte* source_pixels{stream_reader.read_span(row_size).data()};
+                    if (bitmap)
+                    {
+                        expand_bits_to_gray(source_pixels, gray.data(), source_width);
+                        accumulate_row(gray.data(), sums.data(), sums.size());
+                    }
+                    else if (bytes_per_sample(layout_) == 1)
+                    {
+                        accumulate_row(source_pixels, sums.data(), sums.size());
+                    }
+                    else
+                    {
+                        accumulate_big_endian_row(source_pixels, sums.data(), sums.size());
+                    }
+                }
+
+                if (bitmap)
+                {
+                    average_row(sums.data(), data_buffer + (row * stride), thumbnail_width, 1, box_width,
+                                band_row_count);
+                    continue;
+                }
+
+                if (bytes_per_sample(layout_) == 1)
+                {
+                    average_row(sums.data(), downscaled.data(), thumbnail_width, samples_per_pixel, box_width,
+                                band_row_count);
+                }
+                else
+                {
+                    average_big_endian_row(sums.data(), downscaled.data(), thumbnail_width, samples_per_pixel,
+                                           box_width, band_row_count);
+                }
+
+                convert_row(layout_, downscaled.data(), data_buffer + (row * stride), thumbnail_width);
+            }
+        })
+        .as<IWICBitmapSource>();
+}
+
+void netpbm_bitmap_frame_decode::decode_rectangle(const WICRect& rectangle, const uint32_t stride, std::byte* buffer)
+{
+    const size_t row_size{file_row_size(layout_, layout_.width)};
+    const uint64_t first_row_position{pixel_data_position_ + (static_cast<uint64_t>(rectangle.Y) * row_size)};
+    const auto row_count{static_cast<size_t>(rectangle.Height)};
+
+    if (rectangle.X == 0 && static_cast<uint32_t>(rectangle.Width) == layout_.width)
+    {
+        // Complete rows are stored contiguously: stream them through the read buffer (or the mapped file).
+        buffered_stream_reader stream_reader{create_reader(first_row_position, row_count * row_size)};
+        decode_rows(stream_reader, layout_, row_count, stride, buffer);
+        return;
+    }
+
+    // Bitmap segments are read from the byte that holds the first pixel: a region that doesn't start at a byte
+    // boundary is shifted to it while the bits are inverted.
+    const auto pixel_count{static_cast<size_t>(rectangle.Width)};
+    const size_t bit_offset{layout_.bits_per_sample == 1 ? static_cast<size_t>(rectangle.X) % 8 : 0};
+    const size_t segment_offset{file_row_size(layout_, static_cast<size_t>(rectangle.X) - bit_offset)};
+    const size_t segment_size{file_row_size(layout_, bit_offset + pixel_count)};
+    const pooled_buffer segment{is_stored_as_is(layout_) || mapped_file_ ? 0 : segment_size, temporary_memory()};
+
+    for (size_t row{}; row != row_count; ++row)
+    {
+        // 8 bit samples are read directly into the destination, unless they can be copied from the mapped file.
+        std::byte* destination{buffer + (row * stride)};
+        const std::byte* source{read_at(first_row_position + (row * row_size) + segment_offset, segment_size,
+                                        segment.size() == 0 ? destination : segment.data())
+                                    .data()};
+        if (bit_offset != 0)
+        {
+            shift_and_invert_bits(source, destination, bit_offset, pixel_count);
+        }
+        else if (source != destination)
+        {
+            convert_row(layout_, source, destination, pixel_count);
+        }
+    }
+}
+
+void netpbm_bitmap_frame_decode::decode_transformed_rectangle(const pixel_layout& layout, const WICRect& region,
+                                                              const uint32_t factor,
+                                                              const WICBitmapTransformOptions transform,
+                                                              const uint32_t stride, std::byte* buffer) const
+{
+    const auto width{static_cast<size_t>(region.Width)};
+    const auto height{static_cast<size_t>(region.Height)};
+    const size_t row_size{file_row_size(layout, layout.width)};
+    const size_t file_rows_size{height * factor * row_size};
+    const uint64_t first_row_position{pixel_data_position_ + (static_cast<uint64_t>(region.Y) * factor * row_size)};
+
+    if (transform == WICBitmapTransformRotate0)
+    {
+        decode_scaled_rows(create_reader(first_row_position, file_rows_size), layout, region, factor,
+                           [&](const size_t row, const std::byte* file_row) {
+                               convert_row(layout, file_row, buffer + (row * stride), width);
+                           });
+        return;
+    }
+
+    // Flip and rotate need random access: keep the scaled region (not the full resolution image) in the file layout.
+    const size_t pixel_size{file_row_size(layout, 1)};
+    const size_t region_row_size{file_row_size(layout, width)};
+    const pooled_buffer pixels{region_row_size * height, temporary_memory()};
+    decode_scaled_rows(create_reader(first_row_position, file_rows_size), layout, region, factor,
+                       [&](const size_t row, const std::byte* file_row) {
+                           std::copy_n(file_row, region_row_size, pixels.data() + (row * region_row_size));
+                       });
+
+    const bool rotated{is_rotated_90(transform)};
+    const size_t destination_width{rotated ? height : width};
+    const size_t destination_height{rotated ? width : height};
+    const bool flip_horizontal{(transform & WICBitmapTransformFlipHorizontal) != 0};
+    const bool flip_vertical{(transform & WICBitmapTransformFlipVertical) != 0};
+    const pooled_buffer destination_row{file_row_size(layout, destination_width), temporary_memory()};
+
+    // The flip is applied after the rotation. Every destination row maps back to a row or column of the region: only
+    // its first source pixel and the step between its source pixels (in pixels) depend on the transform.
+    const auto first_flipped_x{static_cast<std::ptrdiff_t>(flip_horizontal ? destination_width - 1 : 0)};
+    const std::ptrdiff_t flipped_x_step{flip_horizontal ? -1 : 1};
+    const auto last_x{static_cast<std::ptrdiff_t>(width - 1)};
+    const auto last_y{static_cast<std::ptrdiff_t>(height - 1)};
+
+    for (size_t y{}; y != destination_height; ++y)
+    {
+        const auto flipped_y{static_cast<std::ptrdiff_t>(flip_vertical ? destination_height - 1 - y : y)};
+
+        std::ptrdiff_t source_x;
+        std::ptrdiff_t source_y;
+        std::ptrdiff_t step_x{};
+        std::ptrdiff_t step_y{};
+        switch (transform & 3)
+        {
+        case WICBitmapTransformRotate90:
+            source_x = flipped_y;
+            source_y = last_y - first_flipped_x;
+            step_y = -flipped_x_step;
+            break;
+
+        case WICBitmapTransformRotate180:
+            source_x = last_x - first_flipped_x;
+            source_y = last_y - flipped_y;
+            step_x = -flipped_x_step;
+            break;
+
+        case WICBitmapTransformRotate270:
+            source_x = last_x - flipped_y;
+            source_y = first_flipped_x;
+            step_y = flipped_x_step;
+            break;
+
+        default:
+            source_x = first_flipped_x;
+            source_y = flipped_y;
+            step_x = flipped_x_step;
+            break;
+        }
+
+        const std::byte* source{pixels.data() + (static_cast<size_t>(source_y) * region_row_size) +
+                                (static_cast<size_t>(source_x) * pixel_size)};
+        if (step_x == 1)
+        {
+            // A vertical flip (or a rotation of 180 degrees with a horizontal flip) keeps the order of the row.
+            convert_row(layout, source, buffer + (y * stride), destination_width);
+            continue;
+        }
+
+        gather_pixels(source,
+                      (step_y * static_cast<std::ptrdiff_t>(region_row_size)) +
+                          (step_x * static_cast<std::ptrdiff_t>(pixel_size)),
+                      pixel_size, destination_row.data(), destination_width);
+        convert_row(layout, destination_row.data(), buffer + (y * stride), destination_width);
+    }
+}
+
+HRESULT netpbm_bitmap_frame_decode::copy_transformed_pixels_from_cache(const WICRect* rectangle, const uint32_t width,
+                                                                      const uint32_t height, const GUID& pixel_format,
+                                                                      const WICBitmapTransformOptions transform,
+                                                                      const uint32_t stride, const uint32_t buffer_size,
+                                                                      BYTE* buffer) const
+{
+    com_ptr source{bitmap_source_};
+
+    if (width != layout_.width || height != layout_.height)
+    {
+        com_ptr<IWICBitmapScaler> scaler;
+        check_hresult(factory_->CreateBitmapScaler(scaler.put()));
+        check_hresult(scaler->Initialize(source.get(), width, height, WICBitmapInterpolationModeFant));
+        source = scaler.as<IWICBitmapSource>();
+    }
+
+    if (rectangle)
+    {
+        com_ptr<IWICBitmapClipper> clipper;
+        check_hresult(factory_->CreateBitmapClipper(clipper.put()));
+        check_hresult(clipper->Initialize(source.get(), rectangle));
+        source = clipper.as<IWICBitmapSource>();
+    }
+
+    if (transform != WICBitmapTransformRotate0)
+    {
+        com_ptr<IWICBitmapFlipRotator> flip_rotator;
+        check_hresult(factory_->CreateBitmapFlipRotator(flip_rotator.put()));
+        check_hresult(flip_rotator->Initialize(source.get(), transform));
+        source = flip_rotator.as<IWICBitmapSource>();
+    }
+
+    if (pixel_format != layout_.pixel_format)
+    {
+        com_ptr<IWICBitmapSource> converted;
+        check_hresult(WICConvertBitmapSource(pixel_format, source.get(), converted.put()));
+        source = converted;
+    }
+
+    return source->CopyPixels(nullptr, stride, buffer_size, buffer);
+}
 
 // IWICBitmapSource
-HRESULT __stdcall netpbm_bitmap_frame_decode::GetSize(uint32_t* width, uint32_t* height)
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetSize(uint32_t* width, uint32_t* height) noexcept
+try
 {
     TRACE("{} netpbm_bitmap_frame_decode::GetSize, width address={}, height address={}\n", fmt_ptr(this), fmt_ptr(width),
           fmt_ptr(height));
-    return bitmap_source_->GetSize(width, height);
+
+    *check_in_pointer(width) = layout_.width;
+    *check_in_pointer(height) = layout_.height;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
-HRESULT __stdcall netpbm_bitmap_frame_decode::GetPixelFormat(GUID* pixel_format)
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetPixelFormat(GUID* pixel_format) noexcept
+try
 {
     TRACE("{} netpbm_bitmap_frame_decode::GetPixelFormat.1, pixel_format address={}\n", fmt_ptr(this),
           fmt_ptr(pixel_format));
-    return bitmap_source_->GetPixelFormat(pixel_format);
+
+    *check_in_pointer(pixel_format) = layout_.pixel_format;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
-HRESULT __stdcall netpbm_bitmap_frame_decode::GetResolution(double* dpi_x, double* dpi_y)
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetResolution(double* dpi_x, double* dpi_y) noexcept
+try
 {
     TRACE("{} netpbm_bitmap_frame_decode::GetResolution, dpi_x address={}, dpi_y address={}\n", fmt_ptr(this),
           fmt_ptr(dpi_x), fmt_ptr(dpi_y));
-    return bitmap_source_->GetResolution(dpi_x, dpi_y);
+
+    // The Netpbm format doesn't store a resolution, use the WIC default.
+    *check_in_pointer(dpi_x) = 96.;
+    *check_in_pointer(dpi_y) = 96.;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
 HRESULT __stdcall netpbm_bitmap_frame_decode::CopyPixels(const WICRect* rectangle, const uint32_t stride,
-                                                         const uint32_t buffer_size, BYTE* buffer)
+                                                         const uint32_t buffer_size, BYTE* buffer) noexcept
+try
 {
     TRACE("{} netpbm_bitmap_frame_decode::CopyPixels, rectangle address={}, stride={}, buffer_size={}, buffer "
           "address={}\n",
           fmt_ptr(this), static_cast<const void*>(rectangle), stride, buffer_size, fmt_ptr(buffer));
-    return bitmap_source_->CopyPixels(rectangle, stride, buffer_size, buffer);
+
+    scoped_lock lock{mutex_};
+    if (bitmap_source_)
+        return bitmap_source_->CopyPixels(rectangle, stride, buffer_size, buffer);
+
+    const WICRect region{check_region(rectangle, layout_.width, layout_.height)};
+    check_buffer(layout_, static_cast<size_t>(region.Width), static_cast<size_t>(region.Height), stride, buffer_size,
+                 buffer);
+
+    const mapped_view_scope mapped_view{mapped_file_, source_stream_ != nullptr};
+
+    // Decoded on load: a single call (or non-overlapping bands) is decoded directly into the caller's buffer,
+    // repeated regions are served from a cache of the complete image.
+    if (cache_on_load_ && is_repeated_region(region))
+    {
+        create_cache();
+        return bitmap_source_->CopyPixels(rectangle, stride, buffer_size, buffer);
+    }
+
+    decode_rectangle(region, stride, reinterpret_cast<std::byte*>(buffer));
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
 HRESULT __stdcall netpbm_bitmap_frame_decode::CopyPalette(IWICPalette*) noexcept
@@ -366,10 +1354,21 @@ HRESULT __stdcall netpbm_bitmap_frame_decode::CopyPalette(IWICPalette*) noexcept
 
 // IWICBitmapFrameDecode : IWICBitmapSource
 
-HRESULT __stdcall netpbm_bitmap_frame_decode::GetThumbnail(IWICBitmapSource**) noexcept
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetThumbnail(IWICBitmapSource** thumbnail) noexcept
+try
 {
-    TRACE("{} netpbm_bitmap_frame_decode::GetThumbnail (not supported)\n", fmt_ptr(this));
-    return wincodec::error_codec_no_thumbnail;
+    TRACE("{} netpbm_bitmap_frame_decode::GetThumbnail, thumbnail address={}\n", fmt_ptr(this), fmt_ptr(thumbnail));
+
+    check_in_pointer(thumbnail);
+
+    scoped_lock lock{mutex_};
+    const mapped_view_scope mapped_view{mapped_file_, source_stream_ != nullptr};
+    *thumbnail = create_thumbnail().detach();
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
 HRESULT __stdcall netpbm_bitmap_frame_decode::GetColorContexts(const uint32_t count, IWICColorContext** color_contexts,
@@ -394,3 +1393,120 @@ HRESULT __stdcall netpbm_bitmap_frame_decode::GetMetadataQueryReader(
           fmt_ptr(metadata_query_reader));
     return wincodec::error_unsupported_operation;
 }
+
+// IWICBitmapSourceTransform
+
+HRESULT __stdcall netpbm_bitmap_frame_decode::CopyPixels(const WICRect* rectangle, const uint32_t width,
+                                                         const uint32_t height, GUID* pixel_format,
+                                                         const WICBitmapTransformOptions transform,
+                                                         const uint32_t stride, const uint32_t buffer_size,
+                                                         BYTE* buffer) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_decode::CopyPixels (transform), rectangle address={}, width={}, height={}, "
+          "transform={}, stride={}, buffer_size={}, buffer address={}\n",
+          fmt_ptr(this), static_cast<const void*>(rectangle), width, height, static_cast<int>(transform), stride,
+          buffer_size, fmt_ptr(buffer));
+
+    const auto layout{pixel_format ? try_get_output_layout(layout_, *pixel_format) : layout_};
+    check_condition(layout.has_value(), wincodec::error_unsupported_pixel_format);
+    check_condition(is_supported_transform(transform), error_invalid_argument);
+    const uint32_t factor{get_scale_factor(layout_, width, height)};
+
+    scoped_lock lock{mutex_};
+    if (bitmap_source_)
+        return copy_transformed_pixels_from_cache(rectangle, width, height, layout->pixel_format, transform, stride,
+                                                  buffer_size, buffer);
+
+    const mapped_view_scope mapped_view{mapped_file_, source_stream_ != nullptr};
+
+    // Bitmap pixels are packed 8 per byte: they are scaled, rotated and converted from the cache. A clip without
+    // other transformations is decoded directly, as by IWICBitmapSource::CopyPixels.
+    if (layout_.bits_per_sample == 1)
+    {
+        if (factor == 1 && transform == WICBitmapTransformRotate0 && layout->pixel_format == layout_.pixel_format)
+        {
+            const WICRect region{check_region(rectangle, width, height)};
+            check_buffer(layout_, static_cast<size_t>(region.Width), static_cast<size_t>(region.Height), stride,
+                         buffer_size, buffer);
+            if (!cache_on_load_ || !is_repeated_region(region))
+            {
+                decode_rectangle(region, stride, reinterpret_cast<std::byte*>(buffer));
+                return error_ok;
+            }
+        }
+
+        create_cache();
+        return copy_transformed_pixels_from_cache(rectangle, width, height, layout->pixel_format, transform, stride,
+                                                  buffer_size, buffer);
+    }
+
+    const WICRect region{check_region(rectangle, width, height)};
+    const bool rotated{is_rotated_90(transform)};
+    check_buffer(*layout, static_cast<size_t>(rotated ? region.Height : region.Width),
+                 static_cast<size_t>(rotated ? region.Width : region.Height), stride, buffer_size, buffer);
+
+    decode_transformed_rectangle(*layout, region, factor, transform, stride, reinterpret_cast<std::byte*>(buffer));
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetClosestSize(uint32_t* width, uint32_t* height) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_decode::GetClosestSize, width address={}, height address={}\n", fmt_ptr(this),
+          fmt_ptr(width), fmt_ptr(height));
+
+    // Only power of 2 reductions are supported: select the largest that is not smaller than the requested size.
+    const uint32_t requested_width{std::max(*check_in_pointer(width), 1U)};
+    const uint32_t requested_height{std::max(*check_in_pointer(height), 1U)};
+    uint32_t factor{1};
+    while (layout_.width / (factor * 2) >= requested_width && layout_.height / (factor * 2) >= requested_height)
+    {
+        factor *= 2;
+    }
+
+    *width = layout_.width / factor;
+    *height = layout_.height / factor;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_decode::GetClosestPixelFormat(GUID* pixel_format) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_decode::GetClosestPixelFormat, pixel_format address={}\n", fmt_ptr(this),
+          fmt_ptr(pixel_format));
+
+    // The requested pixel format is kept when the pixels can be decoded directly into it.
+    if (!try_get_output_layout(layout_, *check_in_pointer(pixel_format)))
+    {
+        *pixel_format = layout_.pixel_format;
+    }
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_decode::DoesSupportTransform(const WICBitmapTransformOptions transform,
+                                                                   BOOL* is_supported) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_decode::DoesSupportTransform, transform={}, is_supported address={}\n",
+          fmt_ptr(this), static_cast<int>(transform), fmt_ptr(is_supported));
+
+    *check_in_pointer(is_supported) = is_supported_transform(transform);
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
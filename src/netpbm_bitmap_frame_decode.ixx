@@ -11,26 +11,89 @@ import std;
 import <win.hpp>;
 import winrt;
 
+import buffered_stream_reader;
+import memory_mapped_file;
+
 using std::uint32_t;
 
+/// <summary>
+/// Describes how the pixels are stored in the Netpbm file and which WIC pixel format is used to return them.
+/// </summary>
+struct pixel_layout
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t samples_per_pixel;        // In the Netpbm file.
+    uint32_t bitmap_samples_per_pixel; // In the WIC pixel format.
+    uint32_t bits_per_sample;          // In the Netpbm file.
+    uint32_t bitmap_bits_per_sample;   // In the WIC pixel format.
+    uint32_t max_value;
+    GUID pixel_format;
+    bool bgr_order{}; // In the WIC pixel format: blue is stored before red.
+};
+
 export struct netpbm_bitmap_frame_decode
-    : winrt::implements<netpbm_bitmap_frame_decode, IWICBitmapFrameDecode, IWICBitmapSource>
+    : winrt::implements<netpbm_bitmap_frame_decode, IWICBitmapFrameDecode, IWICBitmapSource, IWICBitmapSourceTransform>
 {
-    netpbm_bitmap_frame_decode(_In_ IStream* source_stream, _In_ IWICImagingFactory* factory);
+    /// <summary>
+    /// Creates the frame for the image at the current position of the stream. Temporary buffers (read buffers, row
+    /// scratch) are allocated from memory_resource, which must be thread safe when the frame is used by several
+    /// threads. Without a memory resource, they are allocated from the pool of the calling thread (thread_memory_pool).
+    /// </summary>
+    netpbm_bitmap_frame_decode(_In_ IStream* source_stream, _In_ IWICImagingFactory* factory,
+                               WICDecodeOptions cache_options,
+                               std::shared_ptr<std::pmr::memory_resource> memory_resource = {});
 
     // IWICBitmapSource
-    HRESULT __stdcall GetSize(uint32_t* width, uint32_t* height) override;
-    HRESULT __stdcall GetPixelFormat(GUID* pixel_format) override;
-    HRESULT __stdcall GetResolution(double* dpi_x, double* dpi_y) override;
-    HRESULT __stdcall CopyPixels(const WICRect* rectangle, uint32_t stride, uint32_t buffer_size, BYTE* buffer) override;
+    HRESULT __stdcall GetSize(uint32_t* width, uint32_t* height) noexcept override;
+    HRESULT __stdcall GetPixelFormat(GUID* pixel_format) noexcept override;
+    HRESULT __stdcall GetResolution(double* dpi_x, double* dpi_y) noexcept override;
+    HRESULT __stdcall CopyPixels(const WICRect* rectangle, uint32_t stride, uint32_t buffer_size,
+                                 BYTE* buffer) noexcept override;
     HRESULT __stdcall CopyPalette(IWICPalette*) noexcept override;
 
     // IWICBitmapFrameDecode : IWICBitmapSource
-    HRESULT __stdcall GetThumbnail(IWICBitmapSource**) noexcept override;
+    HRESULT __stdcall GetThumbnail(IWICBitmapSource** thumbnail) noexcept override;
     HRESULT __stdcall GetColorContexts(uint32_t count, IWICColorContext** color_contexts,
                                        uint32_t* actual_count) noexcept override;
     HRESULT __stdcall GetMetadataQueryReader(IWICMetadataQueryReader** metadata_query_reader) noexcept override;
 
+    // IWICBitmapSourceTransform
+    HRESULT __stdcall CopyPixels(const WICRect* rectangle, uint32_t width, uint32_t height, GUID* pixel_format,
+                                 WICBitmapTransformOptions transform, uint32_t stride, uint32_t buffer_size,
+                                 BYTE* buffer) noexcept override;
+    HRESULT __stdcall GetClosestSize(uint32_t* width, uint32_t* height) noexcept override;
+    HRESULT __stdcall GetClosestPixelFormat(GUID* pixel_format) noexcept override;
+    HRESULT __stdcall DoesSupportTransform(WICBitmapTransformOptions transform, BOOL* is_supported) noexcept override;
+
+    /// <summary>
+    /// Decodes the complete image into a buffer allocated from memory_resource (used to prefetch frames on a worker
+    /// thread). The frame no longer accesses the stream afterwards.
+    /// </summary>
+    void decode_to_memory(std::shared_ptr<std::pmr::memory_resource> memory_resource);
+
 private:
-    winrt::com_ptr<IWICBitmapSource> bitmap_source_;
+    [[nodiscard]] std::pmr::memory_resource* temporary_memory() const;
+    [[nodiscard]] buffered_stream_reader create_reader(std::uint64_t position, size_t read_size) const;
+    [[nodiscard]] std::span<const std::byte> read_at(std::uint64_t position, size_t size, std::byte* buffer) const;
+    void decode_rectangle(const WICRect& rectangle, uint32_t stride, std::byte* buffer);
+    [[nodiscard]] bool is_repeated_region(const WICRect& rectangle);
+    void create_cache();
+    [[nodiscard]] winrt::com_ptr<IWICBitmapSource> create_thumbnail() const;
+    void decode_transformed_rectangle(const pixel_layout& layout, const WICRect& region, uint32_t factor,
+                                      WICBitmapTransformOptions transform, uint32_t stride, std::byte* buffer) const;
+    HRESULT copy_transformed_pixels_from_cache(const WICRect* rectangle, uint32_t width, uint32_t height,
+                                               const GUID& pixel_format, WICBitmapTransformOptions transform,
+                                               uint32_t stride, uint32_t buffer_size, BYTE* buffer) const;
+
+    pixel_layout layout_{};
+    winrt::com_ptr<IWICBitmapSource> bitmap_source_; // Cache of the complete image, created only when needed.
+    winrt::com_ptr<IStream> source_stream_; // Clone of the stream, can be null when the file is mapped.
+    std::unique_ptr<memory_mapped_file> mapped_file_; // Only used for large files on a local drive, mapped per call.
+    winrt::com_ptr<IWICImagingFactory> factory_;
+    std::shared_ptr<std::pmr::memory_resource> memory_resource_; // nullptr: the pool of the calling thread.
+    std::uint64_t pixel_data_position_{};
+    bool cache_on_load_{};                 // WICDecodeMetadataCacheOnLoad: repeated regions are served from a cache.
+    std::vector<WICRect> decoded_regions_; // Only used for WICDecodeMetadataCacheOnLoad.
+    std::mutex mutex_;
 };
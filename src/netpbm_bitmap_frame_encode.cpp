@@ -0,0 +1,547 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "macros.hpp"
+
+module netpbm_bitmap_frame_encode;
+
+import std;
+import <win.hpp>;
+import winrt;
+
+import ascii_formatter;
+import errors;
+import memory_pool;
+import pixel_conversion;
+import pnm_header;
+import util;
+
+using std::int32_t;
+using std::scoped_lock;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using winrt::check_hresult;
+using winrt::com_ptr;
+using winrt::to_hresult;
+
+
+namespace {
+
+/// <summary>
+/// Describes how the pixels of a supported WIC pixel format are stored in a Netpbm file.
+/// </summary>
+struct encoded_format final
+{
+    PnmType pnm_type;
+    uint32_t samples_per_pixel;
+    uint32_t bits_per_sample; // Of the WIC pixel format: 1, 2 and 4 bit pixels are packed.
+    uint32_t max_value;
+};
+
+[[nodiscard]] encoded_format get_encoded_format(const GUID& pixel_format) noexcept
+{
+    if (pixel_format == GUID_WICPixelFormatBlackWhite)
+        return {.pnm_type{PnmType::Bitmap}, .samples_per_pixel{1}, .bits_per_sample{1}, .max_value{1}};
+
+    if (pixel_format == GUID_WICPixelFormat2bppGray)
+        return {.pnm_type{PnmType::Graymap}, .samples_per_pixel{1}, .bits_per_sample{2}, .max_value{3}};
+
+    if (pixel_format == GUID_WICPixelFormat4bppGray)
+        return {.pnm_type{PnmType::Graymap}, .samples_per_pixel{1}, .bits_per_sample{4}, .max_value{15}};
+
+    if (pixel_format == GUID_WICPixelFormat8bppGray)
+        return {.pnm_type{PnmType::Graymap}, .samples_per_pixel{1}, .bits_per_sample{8}, .max_value{255}};
+
+    if (pixel_format == GUID_WICPixelFormat16bppGray)
+        return {.pnm_type{PnmType::Graymap}, .samples_per_pixel{1}, .bits_per_sample{16}, .max_value{65535}};
+
+    if (pixel_format == GUID_WICPixelFormat32bppRGBA)
+        return {.pnm_type{PnmType::ArbitraryMap}, .samples_per_pixel{4}, .bits_per_sample{8}, .max_value{255}};
+
+    if (pixel_format == GUID_WICPixelFormat64bppRGBA)
+        return {.pnm_type{PnmType::ArbitraryMap}, .samples_per_pixel{4}, .bits_per_sample{16}, .max_value{65535}};
+
+    if (pixel_format == GUID_WICPixelFormat48bppRGB)
+        return {.pnm_type{PnmType::Pixmap}, .samples_per_pixel{3}, .bits_per_sample{16}, .max_value{65535}};
+
+    return {.pnm_type{PnmType::Pixmap}, .samples_per_pixel{3}, .bits_per_sample{8}, .max_value{255}};
+}
+
+/// <summary>
+/// Returns the value of the option AsciiFormat, false when the property bag doesn't have this option.
+/// </summary>
+[[nodiscard]] bool read_ascii_format_option(IPropertyBag2* encoder_options)
+{
+    if (!encoder_options)
+        return false;
+
+    PROPBAG2 option{};
+    option.pstrName = const_cast<LPOLESTR>(ascii_format_option_name);
+    VARIANT value;
+    VariantInit(&value);
+    HRESULT option_result;
+    if (FAILED(encoder_options->Read(1, &option, nullptr, &value, &option_result)) || FAILED(option_result))
+        return false;
+
+    const bool ascii_format{value.vt == VT_BOOL && value.boolVal != VARIANT_FALSE};
+    VariantClear(&value);
+    return ascii_format;
+}
+
+/// <summary>
+/// Returns the pixel format that is written for a requested pixel format: P4 (black and white), P5 (gray, 2, 4, 8 or
+/// 16 bit), P6 (RGB, 8 or 16 bit) or P7 (RGB_ALPHA, 8 or 16 bit). The plain formats have no alpha channel: with
+/// ascii_format the alpha channel is dropped.
+/// </summary>
+[[nodiscard]] GUID get_closest_pixel_format(const GUID& pixel_format, const bool ascii_format) noexcept
+{
+    for (const GUID* format : {&GUID_WICPixelFormatBlackWhite, &GUID_WICPixelFormat2bppGray,
+                               &GUID_WICPixelFormat4bppGray, &GUID_WICPixelFormat8bppGray,
+                               &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB,
+                               &GUID_WICPixelFormat48bppRGB})
+    {
+        if (pixel_format == *format)
+            return pixel_format;
+    }
+
+    // Fixed point, half and float samples can't be stored: they are converted to the closest integer format.
+    for (const GUID* format : {&GUID_WICPixelFormat16bppGrayFixedPoint, &GUID_WICPixelFormat16bppGrayHalf,
+                               &GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat32bppGrayFixedPoint})
+    {
+        if (pixel_format == *format)
+            return GUID_WICPixelFormat16bppGray;
+    }
+
+    // Premultiplied pixels are converted to straight alpha, as PAM stores them.
+    for (const GUID* format : {&GUID_WICPixelFormat64bppRGBA, &GUID_WICPixelFormat64bppBGRA,
+                               &GUID_WICPixelFormat64bppPRGBA, &GUID_WICPixelFormat64bppPBGRA})
+    {
+        if (pixel_format == *format)
+            return ascii_format ? GUID_WICPixelFormat48bppRGB : GUID_WICPixelFormat64bppRGBA;
+    }
+
+    for (const GUID* format : {&GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat32bppBGRA,
+                               &GUID_WICPixelFormat32bppPRGBA, &GUID_WICPixelFormat32bppPBGRA})
+    {
+        if (pixel_format == *format)
+            return ascii_format ? GUID_WICPixelFormat24bppRGB : GUID_WICPixelFormat32bppRGBA;
+    }
+
+    for (const GUID* format : {&GUID_WICPixelFormat48bppBGR, &GUID_WICPixelFormat64bppRGB})
+    {
+        if (pixel_format == *format)
+            return GUID_WICPixelFormat48bppRGB;
+    }
+
+    return GUID_WICPixelFormat24bppRGB;
+}
+
+/// <summary>
+/// Returns the header of a Netpbm file. PAM files (P7) have a different header layout and bitmaps have no maximum value.
+/// </summary>
+[[nodiscard]] std::string format_header(const encoded_format& format, const bool ascii_format, const uint32_t width,
+                                        const uint32_t height)
+{
+    switch (format.pnm_type)
+    {
+    case PnmType::Bitmap:
+        return std::format("P{}\n{} {}\n", magic_number_digit(format.pnm_type, ascii_format), width, height);
+
+    case PnmType::ArbitraryMap:
+        return std::format("P7\nWIDTH {}\nHEIGHT {}\nDEPTH {}\nMAXVAL {}\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width, height,
+                           format.samples_per_pixel, format.max_value);
+
+    default:
+        return std::format("P{}\n{} {}\n{}\n", magic_number_digit(format.pnm_type, ascii_format), width, height,
+                           format.max_value);
+    }
+}
+
+} // namespace
+
+
+netpbm_bitmap_frame_encode::netpbm_bitmap_frame_encode(_In_ IStream* destination)
+{
+    destination_.copy_from(destination);
+}
+
+size_t netpbm_bitmap_frame_encode::row_size() const noexcept
+{
+    const encoded_format format{get_encoded_format(pixel_format_)};
+    return ((static_cast<size_t>(width_) * format.samples_per_pixel * format.bits_per_sample) + 7) / 8;
+}
+
+void netpbm_bitmap_frame_encode::check_can_write(const uint32_t line_count)
+{
+    check_condition(initialized_ && !committed_ && width_ != 0 && pixel_format_ != GUID_NULL,
+                    wincodec::error_wrong_state);
+    check_condition(line_count <= height_ - rows_written_, wincodec::error_codec_too_many_scan_lines);
+
+    if (!writer_)
+    {
+        // The writer lives across calls, which can be made on different threads: don't use the thread pool.
+        writer_.emplace(destination_.get(), std::pmr::get_default_resource());
+        writer_->write_string(format_header(get_encoded_format(pixel_format_), ascii_format_, width_, height_));
+    }
+}
+
+/// <summary>
+/// Writes rows in the WIC pixel format. 8 bit samples are stored as is: rows without stride padding are written as
+/// 1 block. 16 bit samples are converted to big endian, bitmap pixels are inverted and 2 and 4 bit pixels are unpacked
+/// to bytes directly into the write buffer.
+/// </summary>
+void netpbm_bitmap_frame_encode::write_rows(const std::byte* pixels, const size_t stride, const size_t row_count)
+{
+    if (ascii_format_)
+    {
+        write_ascii_rows(pixels, stride, row_count);
+        return;
+    }
+
+    const encoded_format format{get_encoded_format(pixel_format_)};
+    const size_t size{row_size()};
+    if (format.bits_per_sample == 1)
+    {
+        // WIC stores 1 for white, PBM 1 for black. The padding bits of the last byte of a row are written as 0.
+        const auto padding_mask{static_cast<std::byte>(0xFF << ((8 - (width_ % 8)) % 8))};
+        for (size_t row{}; row != row_count; ++row)
+        {
+            const std::byte* bits{pixels + (row * stride)};
+            for (size_t offset{}; offset != size;)
+            {
+                const size_t count{std::min(size - offset, buffered_stream_writer::buffer_size)};
+                const auto space{writer_->reserve(count)};
+                invert_bits(bits + offset, space.data(), count);
+                offset += count;
+                if (offset == size)
+                {
+                    space[count - 1] &= padding_mask;
+                }
+                writer_->commit(count);
+            }
+        }
+        return;
+    }
+
+    if (format.bits_per_sample < 8)
+    {
+        // The chunks are whole bytes of packed pixels: the buffer size is a multiple of 8.
+        for (size_t row{}; row != row_count; ++row)
+        {
+            const std::byte* packed_pixels{pixels + (row * stride)};
+            for (size_t offset{}; offset != width_;)
+            {
+                const size_t count{std::min(width_ - offset, buffered_stream_writer::buffer_size)};
+                const auto space{writer_->reserve(count)};
+                unpack_row(packed_pixels + (offset * format.bits_per_sample / 8), space.data(), count,
+                           format.bits_per_sample);
+                writer_->commit(count);
+                offset += count;
+            }
+        }
+        return;
+    }
+
+    if (format.bits_per_sample == 8)
+    {
+        if (stride == size)
+        {
+            writer_->write_bytes(pixels, size * row_count);
+            return;
+        }
+
+        for (size_t row{}; row != row_count; ++row)
+        {
+            writer_->write_bytes(pixels + (row * stride), size);
+        }
+        return;
+    }
+
+    for (size_t row{}; row != row_count; ++row)
+    {
+        const auto* samples{reinterpret_cast<const uint16_t*>(pixels + (row * stride))};
+        for (size_t remaining{size / 2}; remaining != 0;)
+        {
+            const auto space{writer_->reserve(std::min(remaining * 2, buffered_stream_writer::buffer_size))};
+            const size_t sample_count{std::min(remaining, space.size() / 2)};
+            convert_to_big_endian(samples, space.data(), sample_count);
+            writer_->commit(sample_count * 2);
+            samples += sample_count;
+            remaining -= sample_count;
+        }
+    }
+}
+
+/// <summary>
+/// Formats complete rows as decimal text directly into the write buffer. Every row starts on a new line. Packed pixels
+/// are first unpacked to bytes.
+/// </summary>
+void netpbm_bitmap_frame_encode::write_ascii_rows(const std::byte* pixels, const size_t stride, const size_t row_count)
+{
+    const encoded_format format{get_encoded_format(pixel_format_)};
+    const size_t sample_count{static_cast<size_t>(width_) * format.samples_per_pixel};
+    constexpr size_t max_chunk_sample_count{(buffered_stream_writer::buffer_size - max_formatted_size(0) - 1) / 6};
+    const pooled_buffer unpacked_samples{format.bits_per_sample < 8 ? sample_count : 0, thread_memory_pool()};
+
+    for (size_t row{}; row != row_count; ++row)
+    {
+        const std::byte* samples{pixels + (row * stride)};
+        if (format.bits_per_sample < 8)
+        {
+            unpack_row(samples, unpacked_samples.data(), sample_count, format.bits_per_sample);
+            if (format.pnm_type == PnmType::Bitmap)
+            {
+                // P1 stores 1 for black.
+                std::ranges::for_each(std::span{unpacked_samples.data(), sample_count},
+                                      [](std::byte& pixel) { pixel ^= std::byte{1}; });
+            }
+            samples = unpacked_samples.data();
+        }
+
+        size_t line_length{};
+        for (size_t offset{}; offset != sample_count;)
+        {
+            const size_t count{std::min(sample_count - offset, max_chunk_sample_count)};
+            const auto space{writer_->reserve(max_formatted_size(count) + 1)};
+            size_t size{format.bits_per_sample <= 8
+                            ? format_decimal_values(reinterpret_cast<const uint8_t*>(samples) + offset, count,
+                                                    space.data(), line_length)
+                            : format_decimal_values(reinterpret_cast<const uint16_t*>(samples) + offset, count,
+                                                    space.data(), line_length)};
+            offset += count;
+            if (offset == sample_count)
+            {
+                space[size++] = std::byte{'\n'};
+            }
+            writer_->commit(size);
+        }
+    }
+}
+
+// IWICBitmapFrameEncode
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::Initialize(IPropertyBag2* encoder_options) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::Initialize, encoder_options address={}\n", fmt_ptr(this),
+          fmt_ptr(encoder_options));
+
+    scoped_lock lock{mutex_};
+    check_condition(!initialized_, wincodec::error_wrong_state);
+    ascii_format_ = read_ascii_format_option(encoder_options);
+    initialized_ = true;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetSize(const uint32_t width, const uint32_t height) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetSize, width={}, height={}\n", fmt_ptr(this), width, height);
+
+    scoped_lock lock{mutex_};
+    check_condition(initialized_ && !writer_, wincodec::error_wrong_state);
+    check_condition(width != 0 && height != 0, error_invalid_argument);
+
+    width_ = width;
+    height_ = height;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetResolution(const double dpi_x, const double dpi_y) noexcept
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetResolution, dpi_x={}, dpi_y={}\n", fmt_ptr(this), dpi_x, dpi_y);
+
+    // The Netpbm format doesn't store a resolution.
+    return error_ok;
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetPixelFormat(GUID* pixel_format) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetPixelFormat, pixel_format address={}\n", fmt_ptr(this),
+          fmt_ptr(pixel_format));
+
+    check_in_pointer(pixel_format);
+
+    scoped_lock lock{mutex_};
+    check_condition(initialized_ && !writer_, wincodec::error_wrong_state);
+
+    pixel_format_ = get_closest_pixel_format(*pixel_format, ascii_format_);
+    *pixel_format = pixel_format_;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetColorContexts(const uint32_t count,
+                                                               IWICColorContext** color_context) noexcept
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetColorContexts (not supported), count={}, color_context address={}\n",
+          fmt_ptr(this), count, fmt_ptr(color_context));
+
+    // The Netpbm format doesn't support storing color contexts (ICC profiles).
+    return wincodec::error_unsupported_operation;
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetPalette(IWICPalette* palette) noexcept
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetPalette (not supported), palette address={}\n", fmt_ptr(this),
+          fmt_ptr(palette));
+
+    return wincodec::error_unsupported_operation;
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::SetThumbnail(IWICBitmapSource* thumbnail) noexcept
+{
+    TRACE("{} netpbm_bitmap_frame_encode::SetThumbnail (not supported), thumbnail address={}\n", fmt_ptr(this),
+          fmt_ptr(thumbnail));
+
+    return wincodec::error_codec_no_thumbnail;
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::WritePixels(const uint32_t line_count, const uint32_t stride,
+                                                          const uint32_t buffer_size, BYTE* pixels) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::WritePixels, line_count={}, stride={}, buffer_size={}, pixels address={}\n",
+          fmt_ptr(this), line_count, stride, buffer_size, fmt_ptr(pixels));
+
+    check_in_pointer(pixels);
+
+    scoped_lock lock{mutex_};
+    check_can_write(line_count);
+    if (line_count == 0)
+        return error_ok;
+
+    const size_t size{row_size()};
+    check_condition(stride >= size, error_invalid_argument);
+    // Computed in 64 bits: on 32-bit Windows the size of a large buffer would wrap around in size_t.
+    check_condition(((static_cast<uint64_t>(line_count) - 1) * stride) + size <= buffer_size,
+                    wincodec::error_insufficient_buffer);
+
+    write_rows(reinterpret_cast<const std::byte*>(pixels), stride, line_count);
+    rows_written_ += line_count;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::WriteSource(IWICBitmapSource* bitmap_source, WICRect* rectangle) noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::WriteSource, bitmap_source address={}, rectangle address={}\n",
+          fmt_ptr(this), fmt_ptr(bitmap_source), static_cast<const void*>(rectangle));
+
+    check_in_pointer(bitmap_source);
+
+    scoped_lock lock{mutex_};
+    check_condition(initialized_ && !committed_, wincodec::error_wrong_state);
+
+    uint32_t source_width;
+    uint32_t source_height;
+    check_hresult(bitmap_source->GetSize(&source_width, &source_height));
+    const WICRect region{rectangle ? *rectangle
+                                   : WICRect{.X{0},
+                                             .Y{0},
+                                             .Width{static_cast<int32_t>(source_width)},
+                                             .Height{static_cast<int32_t>(source_height)}}};
+    check_condition(region.X >= 0 && region.Y >= 0 && region.Width > 0 && region.Height > 0 &&
+                        static_cast<uint32_t>(region.Width) <= source_width - static_cast<uint32_t>(region.X) &&
+                        static_cast<uint32_t>(region.Height) <= source_height - static_cast<uint32_t>(region.Y),
+                    error_invalid_argument);
+
+    // Without SetSize and SetPixelFormat, the size of the region and the closest format of the source are used.
+    if (width_ == 0)
+    {
+        width_ = static_cast<uint32_t>(region.Width);
+        height_ = static_cast<uint32_t>(region.Height);
+    }
+    check_condition(static_cast<uint32_t>(region.Width) == width_, error_invalid_argument);
+
+    GUID source_pixel_format;
+    check_hresult(bitmap_source->GetPixelFormat(&source_pixel_format));
+    if (pixel_format_ == GUID_NULL)
+    {
+        pixel_format_ = get_closest_pixel_format(source_pixel_format, ascii_format_);
+    }
+
+    com_ptr<IWICBitmapSource> source;
+    if (source_pixel_format == pixel_format_)
+    {
+        source.copy_from(bitmap_source);
+    }
+    else
+    {
+        check_hresult(WICConvertBitmapSource(pixel_format_, bitmap_source, source.put()));
+    }
+
+    const auto row_count{static_cast<uint32_t>(region.Height)};
+    check_can_write(row_count);
+
+    // The source is copied and written in bands of rows: a large source is never materialized completely.
+    const size_t size{row_size()};
+    const uint32_t rows_per_band{
+        std::min(row_count, static_cast<uint32_t>(std::max(size_t{1}, buffered_stream_writer::buffer_size / size)))};
+    const pooled_buffer band{rows_per_band * size, thread_memory_pool()};
+    for (uint32_t row{}; row < row_count; row += rows_per_band)
+    {
+        const uint32_t band_row_count{std::min(rows_per_band, row_count - row)};
+        const WICRect band_region{.X{region.X},
+                                  .Y{region.Y + static_cast<int32_t>(row)},
+                                  .Width{region.Width},
+                                  .Height{static_cast<int32_t>(band_row_count)}};
+        check_hresult(source->CopyPixels(&band_region, static_cast<uint32_t>(size),
+                                         static_cast<uint32_t>(band_row_count * size),
+                                         reinterpret_cast<BYTE*>(band.data())));
+        write_rows(band.data(), size, band_row_count);
+        rows_written_ += band_row_count;
+    }
+
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::Commit() noexcept
+try
+{
+    TRACE("{} netpbm_bitmap_frame_encode::Commit\n", fmt_ptr(this));
+
+    scoped_lock lock{mutex_};
+    check_condition(initialized_ && !committed_ && writer_ && rows_written_ == height_, wincodec::error_wrong_state);
+
+    writer_->flush();
+    committed_ = true;
+    return error_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall netpbm_bitmap_frame_encode::GetMetadataQueryWriter(
+    IWICMetadataQueryWriter** metadata_query_writer) noexcept
+{
+    TRACE("{} netpbm_bitmap_frame_encode::GetMetadataQueryWriter (not supported), metadata_query_writer address={}\n",
+          fmt_ptr(this), fmt_ptr(metadata_query_writer));
+
+    return wincodec::error_unsupported_operation;
+}
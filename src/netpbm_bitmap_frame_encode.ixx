@@ -0,0 +1,62 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module netpbm_bitmap_frame_encode;
+
+import std;
+import <win.hpp>;
+import winrt;
+
+import buffered_stream_writer;
+
+using std::uint32_t;
+
+/// <summary>
+/// Name of the encoder option (VT_BOOL) that selects the plain (ASCII) formats P2 and P3.
+/// </summary>
+export constexpr const wchar_t* ascii_format_option_name{L"AsciiFormat"};
+
+export struct netpbm_bitmap_frame_encode : winrt::implements<netpbm_bitmap_frame_encode, IWICBitmapFrameEncode>
+{
+    explicit netpbm_bitmap_frame_encode(_In_ IStream* destination);
+
+    // IWICBitmapFrameEncode
+    HRESULT __stdcall Initialize(IPropertyBag2* encoder_options) noexcept override;
+    HRESULT __stdcall SetSize(uint32_t width, uint32_t height) noexcept override;
+    HRESULT __stdcall SetResolution(double dpi_x, double dpi_y) noexcept override;
+    HRESULT __stdcall SetPixelFormat(GUID* pixel_format) noexcept override;
+    HRESULT __stdcall SetColorContexts(uint32_t count, IWICColorContext** color_context) noexcept override;
+    HRESULT __stdcall SetPalette(IWICPalette* palette) noexcept override;
+    HRESULT __stdcall SetThumbnail(IWICBitmapSource* thumbnail) noexcept override;
+    HRESULT __stdcall WritePixels(uint32_t line_count, uint32_t stride, uint32_t buffer_size,
+                                  BYTE* pixels) noexcept override;
+    HRESULT __stdcall WriteSource(IWICBitmapSource* bitmap_source, WICRect* rectangle) noexcept override;
+    HRESULT __stdcall Commit() noexcept override;
+    HRESULT __stdcall GetMetadataQueryWriter(IWICMetadataQueryWriter** metadata_query_writer) noexcept override;
+
+    [[nodiscard]] bool is_committed() const noexcept
+    {
+        return committed_;
+    }
+
+private:
+    void check_can_write(uint32_t line_count);
+    void write_rows(const std::byte* pixels, size_t stride, size_t row_count);
+    void write_ascii_rows(const std::byte* pixels, size_t stride, size_t row_count);
+    [[nodiscard]] size_t row_size() const noexcept;
+
+    winrt::com_ptr<IStream> destination_;
+    std::optional<buffered_stream_writer> writer_; // Created when the first pixels are written.
+    bool initialized_{};
+    bool ascii_format_{};
+    bool committed_{};
+    uint32_t width_{};
+    uint32_t height_{};
+    uint32_t rows_written_{};
+    GUID pixel_format_{GUID_NULL};
+    std::mutex mutex_;
+};
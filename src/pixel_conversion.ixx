@@ -0,0 +1,1520 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "simd.hpp"
+
+export module pixel_conversion;
+
+import std;
+
+// Purpose: the pixel conversion kernels that are used by the decoder.
+//          This module only depends on the C++ standard library to make it possible to unit test and benchmark
+//          the kernels independent of COM and WIC.
+
+using std::byte;
+using std::size_t;
+using std::span;
+using std::uint16_t;
+using std::uint32_t;
+
+export namespace scalar {
+
+/// <summary>
+/// Packs 1 byte per pixel 2-bit samples into 4 pixels per byte (leftmost pixel in the most significant bits).
+/// </summary>
+void pack_row_to_crumbs(const byte* byte_pixels, byte* crumb_pixels, const size_t width) noexcept
+{
+    size_t i{};
+    for (size_t j{}; i != width / 4; ++i)
+    {
+        byte value{byte_pixels[j++] << 6};
+        value |= byte_pixels[j++] << 4;
+        value |= byte_pixels[j++] << 2;
+        value |= byte_pixels[j++];
+        crumb_pixels[i] = value;
+    }
+
+    if (const size_t remaining{width % 4}; remaining != 0)
+    {
+        const byte* tail{byte_pixels + (i * 4)};
+        byte value{};
+        for (size_t k{}; k != remaining; ++k)
+        {
+            value |= tail[k] << (6 - (2 * k));
+        }
+        crumb_pixels[i] = value;
+    }
+}
+
+/// <summary>
+/// Packs 1 byte per pixel 4-bit samples into 2 pixels per byte (leftmost pixel in the most significant bits).
+/// </summary>
+void pack_row_to_nibbles(const byte* byte_pixels, byte* nibble_pixels, const size_t width) noexcept
+{
+    size_t i{};
+    for (size_t j{}; i != width / 2; ++i)
+    {
+        nibble_pixels[i] = byte_pixels[j++] << 4;
+        nibble_pixels[i] |= byte_pixels[j++];
+    }
+
+    if (width % 2)
+    {
+        nibble_pixels[i] = byte_pixels[i * 2] << 4;
+    }
+}
+
+/// <summary>
+/// Converts big endian 16-bit samples to little endian. Source and destination may point to the same memory.
+/// </summary>
+void convert_to_little_endian(const byte* big_endian_samples, uint16_t* samples, const size_t sample_count) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        samples[i] = static_cast<uint16_t>((std::to_integer<uint32_t>(big_endian_samples[i * 2]) << 8) |
+                                           std::to_integer<uint32_t>(big_endian_samples[(i * 2) + 1]));
+    }
+}
+
+/// <summary>
+/// Converts big endian 16-bit samples to 8-bit samples, rescaled from 0..max_value to 0..255 with rounding.
+/// Samples above max_value (invalid pixel data) are saturated to 255.
+/// </summary>
+void convert_to_8_bit_and_rescale(const byte* big_endian_samples, byte* samples, const size_t sample_count,
+                                  const uint32_t max_value) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        const uint32_t sample{(std::to_integer<uint32_t>(big_endian_samples[i * 2]) << 8) |
+                              std::to_integer<uint32_t>(big_endian_samples[(i * 2) + 1])};
+        samples[i] = static_cast<byte>(std::min(((sample * 255) + (max_value / 2)) / max_value, 255U));
+    }
+}
+
+/// <summary>
+/// Rescales 8-bit samples from 0..max_value to 0..255 with rounding. Samples above max_value (invalid pixel data)
+/// are saturated to 255. Source and destination may point to the same memory.
+/// </summary>
+void rescale_8_bit(const byte* samples, byte* rescaled, const size_t sample_count, const uint32_t max_value) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        const uint32_t sample{std::to_integer<uint32_t>(samples[i])};
+        rescaled[i] = static_cast<byte>(std::min(((sample * 255) + (max_value / 2)) / max_value, 255U));
+    }
+}
+
+/// <summary>
+/// Converts big endian 16-bit samples to little endian, rescaled from 0..max_value to 0..65535 with rounding.
+/// Samples above max_value (invalid pixel data) are saturated to 65535. Source and destination may point to the same
+/// memory.
+/// </summary>
+void convert_to_little_endian_and_rescale(const byte* big_endian_samples, uint16_t* samples, const size_t sample_count,
+                                          const uint32_t max_value) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        const std::uint64_t sample{(std::to_integer<uint32_t>(big_endian_samples[i * 2]) << 8) |
+                                   std::to_integer<uint32_t>(big_endian_samples[(i * 2) + 1])};
+        samples[i] =
+            static_cast<uint16_t>(std::min(((sample * 65535) + (max_value / 2)) / max_value, std::uint64_t{65535}));
+    }
+}
+
+/// <summary>
+/// Adds 8-bit samples to 32-bit sums (used to box filter rows vertically).
+/// </summary>
+void accumulate_row(const byte* samples, uint32_t* sums, const size_t sample_count) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        sums[i] += std::to_integer<uint32_t>(samples[i]);
+    }
+}
+
+/// <summary>
+/// Adds big endian 16-bit samples to 32-bit sums (used to box filter rows vertically).
+/// </summary>
+void accumulate_big_endian_row(const byte* big_endian_samples, uint32_t* sums, const size_t sample_count) noexcept
+{
+    for (size_t i{}; i != sample_count; ++i)
+    {
+        sums[i] += (std::to_integer<uint32_t>(big_endian_samples[i * 2]) << 8) |
+                   std::to_integer<uint32_t>(big_endian_samples[(i * 2) + 1]);
+    }
+}
+
+/// <summary>
+/// Completes a box filter: averages factor adjacent pixels of the vertical sums of row_count rows into 1 8-bit pixel.
+/// </summary>
+void average_row(const uint32_t* sums, byte* destination, const size_t destination_width,
+                 const size_t samples_per_pixel, const size_t factor, const size_t row_count) noexcept
+{
+    const size_t divisor{factor * row_count};
+    for (size_t x{}; x != destination_width; ++x)
+    {
+        const uint32_t* block{sums + (x * factor * samples_per_pixel)};
+        for (size_t sample{}; sample != samples_per_pixel; ++sample)
+        {
+            std::uint64_t sum{};
+            for (size_t i{}; i != factor; ++i)
+            {
+                sum += block[(i * samples_per_pixel) + sample];
+            }
+            destination[(x * samples_per_pixel) + sample] = static_cast<byte>((sum + (divisor / 2)) / divisor);
+        }
+    }
+}
+
+/// <summary>
+/// Completes a box filter: averages factor adjacent pixels of the vertical sums of row_count rows into 1 big endian
+/// 16-bit pixel.
+/// </summary>
+void average_big_endian_row(const uint32_t* sums, byte* destination, const size_t destination_width,
+                            const size_t samples_per_pixel, const size_t factor, const size_t row_count) noexcept
+{
+    const size_t divisor{factor * row_count};
+    for (size_t x{}; x != destination_width; ++x)
+    {
+        const uint32_t* block{sums + (x * factor * samples_per_pixel)};
+        for (size_t sample{}; sample != samples_per_pixel; ++sample)
+        {
+            std::uint64_t sum{};
+            for (size_t i{}; i != factor; ++i)
+            {
+                sum += block[(i * samples_per_pixel) + sample];
+            }
+
+            const std::uint64_t average{(sum + (divisor / 2)) / divisor};
+            byte* target{destination + (((x * samples_per_pixel) + sample) * 2)};
+            target[0] = static_cast<byte>(average >> 8);
+            target[1] = static_cast<byte>(average);
+        }
+    }
+}
+
+/// <summary>
+/// Inverts all bits (PBM uses 1 for black, WIC BlackWhite uses 1 for white). Source and destination may point to the
+/// same memory.
+/// </summary>
+void invert_bits(const byte* source, byte* destination, const size_t size) noexcept
+{
+    for (size_t i{}; i != size; ++i)
+    {
+        destination[i] = ~source[i];
+    }
+}
+
+/// <summary>
+/// Expands 1 bit per pixel PBM pixels (1 = black, leftmost pixel in the most significant bit) to 8-bit gray
+/// (0 = black, 255 = white).
+/// </summary>
+void expand_bits_to_gray(const byte* bits, byte* gray, const size_t width) noexcept
+{
+    for (size_t i{}; i != width; ++i)
+    {
+        const bool black{(bits[i / 8] & (byte{0x80} >> (i % 8))) != byte{}};
+        gray[i] = black ? byte{} : byte{0xFF};
+    }
+}
+
+/// <summary>
+/// Expands 8-bit gray + alpha pixels (PAM GRAYSCALE_ALPHA) to RGBA, rescaled from 0..max_value to 0..255.
+/// </summary>
+void expand_gray_alpha_to_rgba(const byte* gray_alpha, byte* rgba, const size_t pixel_count,
+                               const uint32_t max_value) noexcept
+{
+    byte samples[2];
+    for (size_t i{}; i != pixel_count; ++i)
+    {
+        rescale_8_bit(gray_alpha + (i * 2), samples, 2, max_value);
+        rgba[(i * 4) + 0] = samples[0];
+        rgba[(i * 4) + 1] = samples[0];
+        rgba[(i * 4) + 2] = samples[0];
+        rgba[(i * 4) + 3] = samples[1];
+    }
+}
+
+/// <summary>
+/// Expands big endian 16-bit gray + alpha pixels to little endian RGBA, rescaled from 0..max_value to 0..65535.
+/// </summary>
+void expand_big_endian_gray_alpha_to_rgba(const byte* gray_alpha, uint16_t* rgba, const size_t pixel_count,
+                                          const uint32_t max_value) noexcept
+{
+    uint16_t samples[2];
+    for (size_t i{}; i != pixel_count; ++i)
+    {
+        convert_to_little_endian_and_rescale(gray_alpha + (i * 4), samples, 2, max_value);
+        rgba[(i * 4) + 0] = samples[0];
+        rgba[(i * 4) + 1] = samples[0];
+        rgba[(i * 4) + 2] = samples[0];
+        rgba[(i * 4) + 3] = samples[1];
+    }
+}
+
+/// <summary>
+/// Swaps the red and blue samples of 8-bit RGB pixels (RGB to BGR). Source and destination may point to the same
+/// memory.
+/// </summary>
+void swap_red_and_blue(const byte* rgb, byte* bgr, const size_t pixel_count) noexcept
+{
+    for (size_t i{}; i != pixel_count; ++i)
+    {
+        const byte red{rgb[i * 3]};
+        const byte green{rgb[(i * 3) + 1]};
+        const byte blue{rgb[(i * 3) + 2]};
+        bgr[i * 3] = blue;
+        bgr[(i * 3) + 1] = green;
+        bgr[(i * 3) + 2] = red;
+    }
+}
+
+/// <summary>
+/// Expands 8-bit RGB pixels to BGRA pixels with an opaque alpha sample.
+/// </summary>
+void expand_rgb_to_bgra(const byte* rgb, byte* bgra, const size_t pixel_count) noexcept
+{
+    for (size_t i{}; i != pixel_count; ++i)
+    {
+        bgra[i * 4] = rgb[(i * 3) + 2];
+        bgra[(i * 4) + 1] = rgb[(i * 3) + 1];
+        bgra[(i * 4) + 2] = rgb[i * 3];
+        bgra[(i * 4) + 3] = byte{0xFF};
+    }
+}
+
+} // namespace scalar
+
+namespace {
+
+#ifdef SIMD_SSE2
+
+// Combines the 2 bytes of each 16-bit lane into (low byte << shift) | high byte.
+template<int Shift>
+[[nodiscard]] __m128i pack_byte_pairs(const __m128i pixels) noexcept
+{
+    const __m128i low_byte_mask{_mm_set1_epi16(0x00FF)};
+    return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(pixels, low_byte_mask), Shift), _mm_srli_epi16(pixels, 8));
+}
+
+// Combines the 2 16-bit words of each 32-bit lane into (low word << 4) | high word.
+[[nodiscard]] __m128i pack_word_pairs(const __m128i pixels) noexcept
+{
+    const __m128i low_word_mask{_mm_set1_epi32(0x0000FFFF)};
+    return _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pixels, low_word_mask), 4), _mm_srli_epi32(pixels, 16));
+}
+
+[[nodiscard]] __m128i load_masked(const byte* pixels, const __m128i mask) noexcept
+{
+    return _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels)), mask);
+}
+
+#endif
+
+#ifdef SIMD_AVX2
+
+template<int Shift>
+[[nodiscard]] SIMD_TARGET_AVX2 __m256i pack_byte_pairs(const __m256i pixels) noexcept
+{
+    const __m256i low_byte_mask{_mm256_set1_epi16(0x00FF)};
+    return _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(pixels, low_byte_mask), Shift), _mm256_srli_epi16(pixels, 8));
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 __m256i pack_word_pairs(const __m256i pixels) noexcept
+{
+    const __m256i low_word_mask{_mm256_set1_epi32(0x0000FFFF)};
+    return _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(pixels, low_word_mask), 4), _mm256_srli_epi32(pixels, 16));
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 __m256i load_masked(const byte* pixels, const __m256i mask) noexcept
+{
+    return _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels)), mask);
+}
+
+#endif
+
+// The vectorized loops process complete groups of pixels and return the number of processed pixels.
+// The remaining pixels (including the width % 4 or width % 2 tail) are packed by the scalar implementation.
+// The *_avx2 and *_ssse3 loops are only called when simd::cpu reports support for them, the SSE2 loops then process
+// the pixels that remain after the wider loop.
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t pack_row_to_crumbs_avx2(const byte* byte_pixels, byte* crumb_pixels,
+                                                             const size_t width) noexcept
+{
+    // 64 pixels => 16 bytes.
+    size_t i{};
+    const __m256i mask{_mm256_set1_epi8(0x03)};
+    for (; width - i >= 64; i += 64)
+    {
+        const __m256i first{pack_word_pairs(pack_byte_pairs<2>(load_masked(byte_pixels + i, mask)))};
+        const __m256i second{pack_word_pairs(pack_byte_pairs<2>(load_masked(byte_pixels + i + 32, mask)))};
+
+        // packs works per 128-bit lane: restore the order of the 64-bit quads before narrowing to bytes.
+        const __m256i words{_mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xD8)};
+        const __m128i packed{_mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(crumb_pixels + (i / 4)), packed);
+    }
+
+    return i;
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t pack_row_to_nibbles_avx2(const byte* byte_pixels, byte* nibble_pixels,
+                                                              const size_t width) noexcept
+{
+    // 64 pixels => 32 bytes.
+    size_t i{};
+    const __m256i mask{_mm256_set1_epi8(0x0F)};
+    for (; width - i >= 64; i += 64)
+    {
+        const __m256i first{pack_byte_pairs<4>(load_masked(byte_pixels + i, mask))};
+        const __m256i second{pack_byte_pairs<4>(load_masked(byte_pixels + i + 32, mask))};
+
+        const __m256i packed{_mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8)};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(nibble_pixels + (i / 2)), packed);
+    }
+
+    return i;
+}
+
+#endif
+
+[[nodiscard]] size_t pack_row_to_crumbs_simd([[maybe_unused]] const byte* byte_pixels,
+                                             [[maybe_unused]] byte* crumb_pixels,
+                                             [[maybe_unused]] const size_t width) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = pack_row_to_crumbs_avx2(byte_pixels, crumb_pixels, width);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 32 pixels => 8 bytes.
+    const __m128i mask{_mm_set1_epi8(0x03)};
+    for (; width - i >= 32; i += 32)
+    {
+        const __m128i first{pack_word_pairs(pack_byte_pairs<2>(load_masked(byte_pixels + i, mask)))};
+        const __m128i second{pack_word_pairs(pack_byte_pairs<2>(load_masked(byte_pixels + i + 16, mask)))};
+
+        const __m128i words{_mm_packs_epi32(first, second)};
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(crumb_pixels + (i / 4)), _mm_packus_epi16(words, words));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t pack_row_to_nibbles_simd([[maybe_unused]] const byte* byte_pixels,
+                                              [[maybe_unused]] byte* nibble_pixels,
+                                              [[maybe_unused]] const size_t width) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = pack_row_to_nibbles_avx2(byte_pixels, nibble_pixels, width);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 32 pixels => 16 bytes.
+    const __m128i mask{_mm_set1_epi8(0x0F)};
+    for (; width - i >= 32; i += 32)
+    {
+        const __m128i first{pack_byte_pairs<4>(load_masked(byte_pixels + i, mask))};
+        const __m128i second{pack_byte_pairs<4>(load_masked(byte_pixels + i + 16, mask))};
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(nibble_pixels + (i / 2)), _mm_packus_epi16(first, second));
+    }
+#endif
+
+    return i;
+}
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t convert_to_little_endian_avx2(const byte* big_endian_samples, uint16_t* samples,
+                                                                   const size_t sample_count) noexcept
+{
+    // 32 samples per iteration; the loads are done before the stores to allow in-place conversion.
+    size_t i{};
+    const __m256i swap_mask{_mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7,
+                                             6, 9, 8, 11, 10, 13, 12, 15, 14)};
+    for (; sample_count - i >= 32; i += 32)
+    {
+        const byte* source{big_endian_samples + (i * 2)};
+        const __m256i first{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source))};
+        const __m256i second{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + 32))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i), _mm256_shuffle_epi8(first, swap_mask));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i + 16), _mm256_shuffle_epi8(second, swap_mask));
+    }
+
+    return i;
+}
+
+#endif
+
+#ifdef SIMD_SSSE3
+
+[[nodiscard]] SIMD_TARGET_SSSE3 size_t convert_to_little_endian_ssse3(const byte* big_endian_samples, uint16_t* samples,
+                                                                     const size_t sample_count) noexcept
+{
+    // 16 samples per iteration, the byte swap is a single pshufb.
+    size_t i{};
+    const __m128i swap_mask{_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)};
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const byte* source{big_endian_samples + (i * 2)};
+        const __m128i first{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))};
+        const __m128i second{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_shuffle_epi8(first, swap_mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i + 8), _mm_shuffle_epi8(second, swap_mask));
+    }
+
+    return i;
+}
+
+#endif
+
+[[nodiscard]] size_t convert_to_little_endian_simd([[maybe_unused]] const byte* big_endian_samples,
+                                                   [[maybe_unused]] uint16_t* samples,
+                                                   [[maybe_unused]] const size_t sample_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = convert_to_little_endian_avx2(big_endian_samples, samples, sample_count);
+    }
+#endif
+
+#ifdef SIMD_SSSE3
+    if (simd::cpu.ssse3)
+    {
+        i += convert_to_little_endian_ssse3(big_endian_samples + (i * 2), samples + i, sample_count - i);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 16 samples per iteration, the byte swap is a 16-bit shift/or (pshufb is not part of the x64 baseline).
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const byte* source{big_endian_samples + (i * 2)};
+        const __m128i first{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))};
+        const __m128i second{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i),
+                         _mm_or_si128(_mm_slli_epi16(first, 8), _mm_srli_epi16(first, 8)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i + 8),
+                         _mm_or_si128(_mm_slli_epi16(second, 8), _mm_srli_epi16(second, 8)));
+    }
+#endif
+
+    return i;
+}
+
+#ifdef SIMD_SSE2
+
+// Rescales 32-bit lanes with (value * 255 + max_value / 2) / max_value in single precision: the dividend is below 2^24
+// and exact, the quotient of the multiplication with the reciprocal is corrected by 1 with the exact remainder.
+[[nodiscard]] __m128i rescale_lanes_to_8_bit(const __m128i values, const __m128 half, const __m128 divisor,
+                                             const __m128 reciprocal) noexcept
+{
+    const __m128 one{_mm_set1_ps(1.F)};
+    const __m128 dividend{_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(values), _mm_set1_ps(255.F)), half)};
+    const __m128 quotient{_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(dividend, reciprocal)))};
+    const __m128 remainder{_mm_sub_ps(dividend, _mm_mul_ps(quotient, divisor))};
+    const __m128 correction{_mm_sub_ps(_mm_and_ps(_mm_cmpge_ps(remainder, divisor), one),
+                                       _mm_and_ps(_mm_cmplt_ps(remainder, _mm_setzero_ps()), one))};
+    return _mm_cvttps_epi32(_mm_add_ps(quotient, correction));
+}
+
+// Rescales 2 32-bit lanes with (value * 65535 + max_value / 2) / max_value in double precision: the dividend is exact
+// and a multiple of 1/2 away from a multiple of max_value, the error of the reciprocal is far below 1/2 / max_value.
+[[nodiscard]] __m128d rescale_lanes_to_16_bit(const __m128d values, const __m128d half,
+                                              const __m128d reciprocal) noexcept
+{
+    const __m128d dividend{_mm_add_pd(_mm_mul_pd(values, _mm_set1_pd(65535.)), half)};
+    return _mm_min_pd(_mm_mul_pd(dividend, reciprocal), _mm_set1_pd(65535.));
+}
+
+#endif
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 __m256i rescale_lanes_to_8_bit(const __m256i values, const __m256 half,
+                                                             const __m256 divisor, const __m256 reciprocal) noexcept
+{
+    const __m256 one{_mm256_set1_ps(1.F)};
+    const __m256 dividend{_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(values), _mm256_set1_ps(255.F)), half)};
+    const __m256 quotient{_mm256_round_ps(_mm256_mul_ps(dividend, reciprocal), _MM_FROUND_TO_ZERO)};
+    const __m256 remainder{_mm256_sub_ps(dividend, _mm256_mul_ps(quotient, divisor))};
+    const __m256 correction{
+        _mm256_sub_ps(_mm256_and_ps(_mm256_cmp_ps(remainder, divisor, _CMP_GE_OQ), one),
+                      _mm256_and_ps(_mm256_cmp_ps(remainder, _mm256_setzero_ps(), _CMP_LT_OQ), one))};
+    return _mm256_cvttps_epi32(_mm256_add_ps(quotient, correction));
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 __m256d rescale_lanes_to_16_bit(const __m256d values, const __m256d half,
+                                                              const __m256d reciprocal) noexcept
+{
+    const __m256d dividend{_mm256_add_pd(_mm256_mul_pd(values, _mm256_set1_pd(65535.)), half)};
+    return _mm256_min_pd(_mm256_mul_pd(dividend, reciprocal), _mm256_set1_pd(65535.));
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t convert_to_8_bit_and_rescale_avx2(const byte* big_endian_samples, byte* samples,
+                                                                       const size_t sample_count,
+                                                                       const uint32_t max_value) noexcept
+{
+    // 16 samples per iteration.
+    size_t i{};
+    const __m256i swap_mask{_mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7,
+                                             6, 9, 8, 11, 10, 13, 12, 15, 14)};
+    const __m256 half{_mm256_set1_ps(static_cast<float>(max_value / 2))};
+    const __m256 divisor{_mm256_set1_ps(static_cast<float>(max_value))};
+    const __m256 reciprocal{_mm256_set1_ps(1.F / static_cast<float>(max_value))};
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const __m256i words{_mm256_shuffle_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(big_endian_samples + (i * 2))), swap_mask)};
+        const __m256i low{
+            rescale_lanes_to_8_bit(_mm256_unpacklo_epi16(words, _mm256_setzero_si256()), half, divisor, reciprocal)};
+        const __m256i high{
+            rescale_lanes_to_8_bit(_mm256_unpackhi_epi16(words, _mm256_setzero_si256()), half, divisor, reciprocal)};
+
+        // The unpack and pack instructions work per 128-bit lane: every lane holds 8 consecutive samples.
+        const __m256i packed{_mm256_packus_epi16(_mm256_packs_epi32(low, high), _mm256_setzero_si256())};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i),
+                         _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08)));
+    }
+
+    return i;
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t convert_to_little_endian_and_rescale_avx2(const byte* big_endian_samples,
+                                                                               uint16_t* samples,
+                                                                               const size_t sample_count,
+                                                                               const uint32_t max_value) noexcept
+{
+    // 8 samples per iteration; the load is done before the store to allow in-place conversion.
+    size_t i{};
+    const __m128i swap_mask{_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)};
+    const __m256d half{_mm256_set1_pd((max_value / 2) + 0.5)};
+    const __m256d reciprocal{_mm256_set1_pd(1. / max_value)};
+    for (; sample_count - i >= 8; i += 8)
+    {
+        const __m256i values{_mm256_cvtepu16_epi32(_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(big_endian_samples + (i * 2))), swap_mask))};
+        const __m128i low{_mm256_cvttpd_epi32(
+            rescale_lanes_to_16_bit(_mm256_cvtepi32_pd(_mm256_castsi256_si128(values)), half, reciprocal))};
+        const __m128i high{_mm256_cvttpd_epi32(
+            rescale_lanes_to_16_bit(_mm256_cvtepi32_pd(_mm256_extracti128_si256(values, 1)), half, reciprocal))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_packus_epi32(low, high));
+    }
+
+    return i;
+}
+
+#endif
+
+[[nodiscard]] size_t convert_to_8_bit_and_rescale_simd([[maybe_unused]] const byte* big_endian_samples,
+                                                       [[maybe_unused]] byte* samples,
+                                                       [[maybe_unused]] const size_t sample_count,
+                                                       [[maybe_unused]] const uint32_t max_value) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = convert_to_8_bit_and_rescale_avx2(big_endian_samples, samples, sample_count, max_value);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 8 samples per iteration.
+    const __m128 half{_mm_set1_ps(static_cast<float>(max_value / 2))};
+    const __m128 divisor{_mm_set1_ps(static_cast<float>(max_value))};
+    const __m128 reciprocal{_mm_set1_ps(1.F / static_cast<float>(max_value))};
+    const __m128i zero{_mm_setzero_si128()};
+    for (; sample_count - i >= 8; i += 8)
+    {
+        const __m128i big_endian{_mm_loadu_si128(reinterpret_cast<const __m128i*>(big_endian_samples + (i * 2)))};
+        const __m128i words{_mm_or_si128(_mm_slli_epi16(big_endian, 8), _mm_srli_epi16(big_endian, 8))};
+        const __m128i low{rescale_lanes_to_8_bit(_mm_unpacklo_epi16(words, zero), half, divisor, reciprocal)};
+        const __m128i high{rescale_lanes_to_8_bit(_mm_unpackhi_epi16(words, zero), half, divisor, reciprocal)};
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(samples + i), _mm_packus_epi16(_mm_packs_epi32(low, high), zero));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t rescale_8_bit_simd([[maybe_unused]] const byte* samples, [[maybe_unused]] byte* rescaled,
+                                        [[maybe_unused]] const size_t sample_count,
+                                        [[maybe_unused]] const uint32_t max_value) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_SSE2
+    // 16 samples per iteration.
+    const __m128 half{_mm_set1_ps(static_cast<float>(max_value / 2))};
+    const __m128 divisor{_mm_set1_ps(static_cast<float>(max_value))};
+    const __m128 reciprocal{_mm_set1_ps(1.F / static_cast<float>(max_value))};
+    const __m128i zero{_mm_setzero_si128()};
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const __m128i bytes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i))};
+        const __m128i low_words{_mm_unpacklo_epi8(bytes, zero)};
+        const __m128i high_words{_mm_unpackhi_epi8(bytes, zero)};
+        const std::array values{
+            rescale_lanes_to_8_bit(_mm_unpacklo_epi16(low_words, zero), half, divisor, reciprocal),
+            rescale_lanes_to_8_bit(_mm_unpackhi_epi16(low_words, zero), half, divisor, reciprocal),
+            rescale_lanes_to_8_bit(_mm_unpacklo_epi16(high_words, zero), half, divisor, reciprocal),
+            rescale_lanes_to_8_bit(_mm_unpackhi_epi16(high_words, zero), half, divisor, reciprocal)};
+        const __m128i low{_mm_packs_epi32(values[0], values[1])};
+        const __m128i high{_mm_packs_epi32(values[2], values[3])};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rescaled + i), _mm_packus_epi16(low, high));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t convert_to_little_endian_and_rescale_simd([[maybe_unused]] const byte* big_endian_samples,
+                                                              [[maybe_unused]] uint16_t* samples,
+                                                              [[maybe_unused]] const size_t sample_count,
+                                                              [[maybe_unused]] const uint32_t max_value) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = convert_to_little_endian_and_rescale_avx2(big_endian_samples, samples, sample_count, max_value);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 8 samples per iteration. SSE2 has no unsigned 32 to 16-bit pack: the values are offset to the signed range.
+    const __m128d half{_mm_set1_pd((max_value / 2) + 0.5)};
+    const __m128d reciprocal{_mm_set1_pd(1. / max_value)};
+    const __m128i zero{_mm_setzero_si128()};
+    const __m128i offset_32{_mm_set1_epi32(0x8000)};
+    const __m128i offset_16{_mm_set1_epi16(static_cast<short>(0x8000))};
+    const auto rescale{[&](const __m128i values) noexcept {
+        const __m128i low{_mm_cvttpd_epi32(rescale_lanes_to_16_bit(_mm_cvtepi32_pd(values), half, reciprocal))};
+        const __m128i high{_mm_cvttpd_epi32(
+            rescale_lanes_to_16_bit(_mm_cvtepi32_pd(_mm_srli_si128(values, 8)), half, reciprocal))};
+        return _mm_sub_epi32(_mm_unpacklo_epi64(low, high), offset_32);
+    }};
+    for (; sample_count - i >= 8; i += 8)
+    {
+        const __m128i big_endian{_mm_loadu_si128(reinterpret_cast<const __m128i*>(big_endian_samples + (i * 2)))};
+        const __m128i words{_mm_or_si128(_mm_slli_epi16(big_endian, 8), _mm_srli_epi16(big_endian, 8))};
+        const __m128i packed{_mm_packs_epi32(rescale(_mm_unpacklo_epi16(words, zero)),
+                                             rescale(_mm_unpackhi_epi16(words, zero)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_xor_si128(packed, offset_16));
+    }
+#endif
+
+    return i;
+}
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t accumulate_row_avx2(const byte* samples, uint32_t* sums,
+                                                         const size_t sample_count) noexcept
+{
+    // 16 samples per iteration.
+    size_t i{};
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const __m128i bytes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i))};
+        auto* sum{reinterpret_cast<__m256i*>(sums + i)};
+        _mm256_storeu_si256(sum, _mm256_add_epi32(_mm256_loadu_si256(sum), _mm256_cvtepu8_epi32(bytes)));
+        _mm256_storeu_si256(sum + 1, _mm256_add_epi32(_mm256_loadu_si256(sum + 1),
+                                                      _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8))));
+    }
+
+    return i;
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t accumulate_big_endian_row_avx2(const byte* big_endian_samples, uint32_t* sums,
+                                                                    const size_t sample_count) noexcept
+{
+    // 8 samples per iteration.
+    size_t i{};
+    const __m128i swap_mask{_mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)};
+    for (; sample_count - i >= 8; i += 8)
+    {
+        const __m128i words{_mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(big_endian_samples + (i * 2))), swap_mask)};
+        auto* sum{reinterpret_cast<__m256i*>(sums + i)};
+        _mm256_storeu_si256(sum, _mm256_add_epi32(_mm256_loadu_si256(sum), _mm256_cvtepu16_epi32(words)));
+    }
+
+    return i;
+}
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t invert_bits_avx2(const byte* source, byte* destination, const size_t size) noexcept
+{
+    // 32 bytes (256 pixels) per iteration.
+    size_t i{};
+    const __m256i ones{_mm256_set1_epi8(-1)};
+    for (; size - i >= 32; i += 32)
+    {
+        const __m256i bits{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_xor_si256(bits, ones));
+    }
+
+    return i;
+}
+
+#endif
+
+[[nodiscard]] size_t accumulate_row_simd([[maybe_unused]] const byte* samples, [[maybe_unused]] uint32_t* sums,
+                                         [[maybe_unused]] const size_t sample_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = accumulate_row_avx2(samples, sums, sample_count);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 16 samples per iteration: widen the bytes to 16 bits and then to 32 bits by interleaving with zeros.
+    const __m128i zero{_mm_setzero_si128()};
+    for (; sample_count - i >= 16; i += 16)
+    {
+        const __m128i bytes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i))};
+        const __m128i low_words{_mm_unpacklo_epi8(bytes, zero)};
+        const __m128i high_words{_mm_unpackhi_epi8(bytes, zero)};
+        const std::array values{_mm_unpacklo_epi16(low_words, zero), _mm_unpackhi_epi16(low_words, zero),
+                                _mm_unpacklo_epi16(high_words, zero), _mm_unpackhi_epi16(high_words, zero)};
+
+        auto* sum{reinterpret_cast<__m128i*>(sums + i)};
+        for (size_t j{}; j != values.size(); ++j)
+        {
+            _mm_storeu_si128(sum + j, _mm_add_epi32(_mm_loadu_si128(sum + j), values[j]));
+        }
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t accumulate_big_endian_row_simd([[maybe_unused]] const byte* big_endian_samples,
+                                                    [[maybe_unused]] uint32_t* sums,
+                                                    [[maybe_unused]] const size_t sample_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = accumulate_big_endian_row_avx2(big_endian_samples, sums, sample_count);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 8 samples per iteration.
+    const __m128i zero{_mm_setzero_si128()};
+    for (; sample_count - i >= 8; i += 8)
+    {
+        const __m128i big_endian{_mm_loadu_si128(reinterpret_cast<const __m128i*>(big_endian_samples + (i * 2)))};
+        const __m128i words{_mm_or_si128(_mm_slli_epi16(big_endian, 8), _mm_srli_epi16(big_endian, 8))};
+
+        auto* sum{reinterpret_cast<__m128i*>(sums + i)};
+        _mm_storeu_si128(sum, _mm_add_epi32(_mm_loadu_si128(sum), _mm_unpacklo_epi16(words, zero)));
+        _mm_storeu_si128(sum + 1, _mm_add_epi32(_mm_loadu_si128(sum + 1), _mm_unpackhi_epi16(words, zero)));
+    }
+#endif
+
+    return i;
+}
+
+#ifdef SIMD_SSE2
+
+/// <summary>
+/// Sums factor adjacent pixels (1 to 4 samples) of the vertical sums and divides the sums by factor * row_count (a
+/// power of 2, the shift) with rounding. The averages are returned in the first samples_per_pixel lanes, the other
+/// lanes are undefined. With 3 samples per pixel, 1 sum after the block is read: the block must not be the last of the
+/// row.
+/// </summary>
+[[nodiscard]] __m128i average_pixel_sse2(const uint32_t* block, const size_t samples_per_pixel, const size_t factor,
+                                         const __m128i rounding, const __m128i shift) noexcept
+{
+    __m128i sum{_mm_setzero_si128()};
+    if (samples_per_pixel >= 3)
+    {
+        for (size_t i{}; i != factor; ++i)
+        {
+            sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (i * samples_per_pixel))));
+        }
+    }
+    else
+    {
+        // 4 / samples_per_pixel pixels per load, the lanes are folded into the first pixel after the loop.
+        for (size_t i{}; i != factor * samples_per_pixel; i += 4)
+        {
+            sum = _mm_add_epi32(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)));
+        }
+
+        sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+        if (samples_per_pixel == 1)
+        {
+            sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 4));
+        }
+    }
+
+    return _mm_srl_epi32(_mm_add_epi32(sum, rounding), shift);
+}
+
+/// <summary>
+/// Sums the even and odd lanes of 8 consecutive sums: 4 gray pixels of a box filter with a factor of 2.
+/// </summary>
+[[nodiscard]] __m128i sum_pixel_pairs_sse2(const uint32_t* sums) noexcept
+{
+    const __m128 first{_mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums)))};
+    const __m128 second{_mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + 4)))};
+    return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0))),
+                         _mm_castps_si128(_mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+
+/// <summary>
+/// Converts 4 32-bit lanes with values up to 65535 to big endian 16-bit samples in the low 64 bits.
+/// </summary>
+[[nodiscard]] __m128i pack_big_endian_words(const __m128i values) noexcept
+{
+    // SSE2 only has a signed saturating pack: bias the values to the signed range and back.
+    const __m128i words{_mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(values, _mm_set1_epi32(0x8000)), _mm_setzero_si128()),
+                                      _mm_set1_epi16(static_cast<short>(0x8000)))};
+    return _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+}
+
+/// <summary>
+/// Returns true when the box filter can use the SSE2 kernels: power of 2 sizes small enough that the rounded sums of
+/// factor x row_count samples with max_value fit in the 32-bit lanes.
+/// </summary>
+[[nodiscard]] bool is_simd_box_filter(const size_t samples_per_pixel, const size_t factor, const size_t row_count,
+                                      const std::uint64_t max_value) noexcept
+{
+    return samples_per_pixel >= 1 && samples_per_pixel <= 4 && factor >= 2 && std::has_single_bit(factor) &&
+           std::has_single_bit(row_count) &&
+           (max_value + 1) * factor * row_count <= std::numeric_limits<uint32_t>::max();
+}
+
+#endif
+
+[[nodiscard]] size_t average_row_simd([[maybe_unused]] const uint32_t* sums, [[maybe_unused]] byte* destination,
+                                      [[maybe_unused]] const size_t destination_width,
+                                      [[maybe_unused]] const size_t samples_per_pixel,
+                                      [[maybe_unused]] const size_t factor,
+                                      [[maybe_unused]] const size_t row_count) noexcept
+{
+    size_t x{};
+
+#ifdef SIMD_SSE2
+    if (!is_simd_box_filter(samples_per_pixel, factor, row_count, 255))
+        return 0;
+
+    const __m128i shift{_mm_cvtsi32_si128(std::countr_zero(factor) + std::countr_zero(row_count))};
+    const __m128i rounding{_mm_set1_epi32(static_cast<int>(factor * row_count / 2))};
+    if (samples_per_pixel == 1 && factor == 2)
+    {
+        // 4 pixels per iteration.
+        for (; destination_width - x >= 4; x += 4)
+        {
+            const __m128i average{_mm_srl_epi32(_mm_add_epi32(sum_pixel_pairs_sse2(sums + (x * 2)), rounding), shift)};
+            const __m128i words{_mm_packs_epi32(average, average)};
+            const int bytes{_mm_cvtsi128_si32(_mm_packus_epi16(words, words))};
+            std::memcpy(destination + x, &bytes, sizeof bytes);
+        }
+
+        return x;
+    }
+
+    // 1 pixel per iteration, the last pixel is left to the scalar code for 3 samples (the sums are read with 4 lanes).
+    const size_t width{samples_per_pixel == 3 && destination_width != 0 ? destination_width - 1 : destination_width};
+    for (; x != width; ++x)
+    {
+        const __m128i average{
+            average_pixel_sse2(sums + (x * factor * samples_per_pixel), samples_per_pixel, factor, rounding, shift)};
+        const __m128i words{_mm_packs_epi32(average, average)};
+        const int bytes{_mm_cvtsi128_si32(_mm_packus_epi16(words, words))};
+        std::memcpy(destination + (x * samples_per_pixel), &bytes, samples_per_pixel);
+    }
+#endif
+
+    return x;
+}
+
+[[nodiscard]] size_t average_big_endian_row_simd([[maybe_unused]] const uint32_t* sums,
+                                                 [[maybe_unused]] byte* destination,
+                                                 [[maybe_unused]] const size_t destination_width,
+                                                 [[maybe_unused]] const size_t samples_per_pixel,
+                                                 [[maybe_unused]] const size_t factor,
+                                                 [[maybe_unused]] const size_t row_count) noexcept
+{
+    size_t x{};
+
+#ifdef SIMD_SSE2
+    if (!is_simd_box_filter(samples_per_pixel, factor, row_count, 65535))
+        return 0;
+
+    const __m128i shift{_mm_cvtsi32_si128(std::countr_zero(factor) + std::countr_zero(row_count))};
+    const __m128i rounding{_mm_set1_epi32(static_cast<int>(factor * row_count / 2))};
+    if (samples_per_pixel == 1 && factor == 2)
+    {
+        // 4 pixels per iteration.
+        for (; destination_width - x >= 4; x += 4)
+        {
+            const __m128i average{_mm_srl_epi32(_mm_add_epi32(sum_pixel_pairs_sse2(sums + (x * 2)), rounding), shift)};
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + (x * 2)), pack_big_endian_words(average));
+        }
+
+        return x;
+    }
+
+    // 1 pixel per iteration, the last pixel is left to the scalar code for 3 samples (the sums are read with 4 lanes).
+    const size_t width{samples_per_pixel == 3 && destination_width != 0 ? destination_width - 1 : destination_width};
+    for (; x != width; ++x)
+    {
+        const __m128i average{
+            average_pixel_sse2(sums + (x * factor * samples_per_pixel), samples_per_pixel, factor, rounding, shift)};
+        std::array<byte, 8> words;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(words.data()), pack_big_endian_words(average));
+        std::memcpy(destination + (x * samples_per_pixel * 2), words.data(), samples_per_pixel * 2);
+    }
+#endif
+
+    return x;
+}
+
+[[nodiscard]] size_t invert_bits_simd([[maybe_unused]] const byte* source, [[maybe_unused]] byte* destination,
+                                      [[maybe_unused]] const size_t size) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = invert_bits_avx2(source, destination, size);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 16 bytes (128 pixels) per iteration.
+    const __m128i ones{_mm_set1_epi8(-1)};
+    for (; size - i >= 16; i += 16)
+    {
+        const __m128i bits{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_xor_si128(bits, ones));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t expand_gray_alpha_to_rgba_simd([[maybe_unused]] const byte* gray_alpha,
+                                                    [[maybe_unused]] byte* rgba,
+                                                    [[maybe_unused]] const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_SSE2
+    // 8 pixels per iteration. Every 16-bit lane holds gray | alpha << 8: interleaving it with gray | gray << 8
+    // gives the R, G, B, A bytes.
+    const __m128i low_byte_mask{_mm_set1_epi16(0xFF)};
+    for (; pixel_count - i >= 8; i += 8)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(gray_alpha + (i * 2)))};
+        const __m128i gray{_mm_and_si128(pixels, low_byte_mask)};
+        const __m128i gray_gray{_mm_or_si128(gray, _mm_slli_epi16(gray, 8))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i * 4)), _mm_unpacklo_epi16(gray_gray, pixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i * 4) + 16), _mm_unpackhi_epi16(gray_gray, pixels));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t expand_big_endian_gray_alpha_to_rgba_simd([[maybe_unused]] const byte* gray_alpha,
+                                                               [[maybe_unused]] uint16_t* rgba,
+                                                               [[maybe_unused]] const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_SSE2
+    // 4 pixels per iteration, the same interleave as the 8-bit expansion with 32-bit lanes.
+    const __m128i low_word_mask{_mm_set1_epi32(0xFFFF)};
+    for (; pixel_count - i >= 4; i += 4)
+    {
+        const __m128i big_endian{_mm_loadu_si128(reinterpret_cast<const __m128i*>(gray_alpha + (i * 4)))};
+        const __m128i pixels{_mm_or_si128(_mm_slli_epi16(big_endian, 8), _mm_srli_epi16(big_endian, 8))};
+        const __m128i gray{_mm_and_si128(pixels, low_word_mask)};
+        const __m128i gray_gray{_mm_or_si128(gray, _mm_slli_epi32(gray, 16))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i * 4)), _mm_unpacklo_epi32(gray_gray, pixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + (i * 4) + 8), _mm_unpackhi_epi32(gray_gray, pixels));
+    }
+#endif
+
+    return i;
+}
+
+// The RGB swizzles load 16 bytes (5 1/3 pixels) at a time: the loops stop while a complete load is still possible.
+
+#ifdef SIMD_AVX2
+
+[[nodiscard]] SIMD_TARGET_AVX2 size_t expand_rgb_to_bgra_avx2(const byte* rgb, byte* bgra,
+                                                             const size_t pixel_count) noexcept
+{
+    // 8 pixels per iteration: every 128-bit lane is loaded with 4 pixels, pshufb works per lane.
+    size_t i{};
+    const __m256i swizzle_mask{_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4,
+                                                3, -1, 8, 7, 6, -1, 11, 10, 9, -1)};
+    const __m256i alpha{_mm256_set1_epi32(static_cast<int>(0xFF000000))};
+    for (; pixel_count - i >= 10; i += 8)
+    {
+        const byte* source{rgb + (i * 3)};
+        const __m256i pixels{_mm256_loadu2_m128i(reinterpret_cast<const __m128i*>(source + 12),
+                                                 reinterpret_cast<const __m128i*>(source))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bgra + (i * 4)),
+                            _mm256_or_si256(_mm256_shuffle_epi8(pixels, swizzle_mask), alpha));
+    }
+
+    return i;
+}
+
+#endif
+
+#ifdef SIMD_SSSE3
+
+[[nodiscard]] SIMD_TARGET_SSSE3 size_t swap_red_and_blue_ssse3(const byte* rgb, byte* bgr,
+                                                              const size_t pixel_count) noexcept
+{
+    // 4 pixels per iteration. The last 4 bytes are stored unchanged (the next pixel, converted by the next
+    // iteration): this keeps the in-place conversion correct.
+    size_t i{};
+    const __m128i swizzle_mask{_mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15)};
+    for (; pixel_count - i >= 6; i += 4)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (i * 3)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bgr + (i * 3)), _mm_shuffle_epi8(pixels, swizzle_mask));
+    }
+
+    return i;
+}
+
+[[nodiscard]] SIMD_TARGET_SSSE3 size_t expand_rgb_to_bgra_ssse3(const byte* rgb, byte* bgra,
+                                                               const size_t pixel_count) noexcept
+{
+    // 4 pixels per iteration.
+    size_t i{};
+    const __m128i swizzle_mask{_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)};
+    const __m128i alpha{_mm_set1_epi32(static_cast<int>(0xFF000000))};
+    for (; pixel_count - i >= 6; i += 4)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (i * 3)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + (i * 4)),
+                         _mm_or_si128(_mm_shuffle_epi8(pixels, swizzle_mask), alpha));
+    }
+
+    return i;
+}
+
+#endif
+
+[[nodiscard]] size_t swap_red_and_blue_simd([[maybe_unused]] const byte* rgb, [[maybe_unused]] byte* bgr,
+                                            [[maybe_unused]] const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_SSSE3
+    if (simd::cpu.ssse3)
+    {
+        i = swap_red_and_blue_ssse3(rgb, bgr, pixel_count);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 16 pixels (3 registers) per iteration without pshufb: every byte of the BGR output is the byte 2 positions
+    // further (blue), the same byte (green) or the byte 2 positions back (red). These are byte shifts across the 3
+    // registers, selected with a mask that repeats every 3 bytes. The 48 bytes hold complete pixels and are loaded
+    // before the stores, which keeps the in-place conversion correct.
+    const __m128i phase0{_mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1)};
+    const __m128i phase1{_mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0)};
+    const __m128i phase2{_mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0)};
+    for (; pixel_count - i >= 16; i += 16)
+    {
+        const byte* source{rgb + (i * 3)};
+        const __m128i first{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))};
+        const __m128i second{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 16))};
+        const __m128i third{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 32))};
+
+        const __m128i first_next{_mm_or_si128(_mm_srli_si128(first, 2), _mm_slli_si128(second, 14))};
+        const __m128i second_next{_mm_or_si128(_mm_srli_si128(second, 2), _mm_slli_si128(third, 14))};
+        const __m128i third_next{_mm_srli_si128(third, 2)};
+        const __m128i first_previous{_mm_slli_si128(first, 2)};
+        const __m128i second_previous{_mm_or_si128(_mm_slli_si128(second, 2), _mm_srli_si128(first, 14))};
+        const __m128i third_previous{_mm_or_si128(_mm_slli_si128(third, 2), _mm_srli_si128(second, 14))};
+
+        byte* destination{bgr + (i * 3)};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination),
+                         _mm_or_si128(_mm_or_si128(_mm_and_si128(first_next, phase0), _mm_and_si128(first, phase1)),
+                                      _mm_and_si128(first_previous, phase2)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 16),
+                         _mm_or_si128(_mm_or_si128(_mm_and_si128(second_next, phase2), _mm_and_si128(second, phase0)),
+                                      _mm_and_si128(second_previous, phase1)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + 32),
+                         _mm_or_si128(_mm_or_si128(_mm_and_si128(third_next, phase1), _mm_and_si128(third, phase2)),
+                                      _mm_and_si128(third_previous, phase0)));
+    }
+#endif
+
+    return i;
+}
+
+[[nodiscard]] size_t expand_rgb_to_bgra_simd([[maybe_unused]] const byte* rgb, [[maybe_unused]] byte* bgra,
+                                             [[maybe_unused]] const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef SIMD_AVX2
+    if (simd::cpu.avx2)
+    {
+        i = expand_rgb_to_bgra_avx2(rgb, bgra, pixel_count);
+    }
+#endif
+
+#ifdef SIMD_SSSE3
+    if (simd::cpu.ssse3)
+    {
+        i += expand_rgb_to_bgra_ssse3(rgb + (i * 3), bgra + (i * 4), pixel_count - i);
+    }
+#endif
+
+#ifdef SIMD_SSE2
+    // 4 pixels per iteration without pshufb: the pixels at byte offset 0, 3, 6 and 9 are gathered in 32-bit lanes
+    // (R | G << 8 | B << 16) and red and blue are exchanged with 32-bit shifts.
+    const __m128i green_mask{_mm_set1_epi32(0x0000FF00)};
+    const __m128i red_mask{_mm_set1_epi32(0x00FF0000)};
+    const __m128i blue_mask{_mm_set1_epi32(0x000000FF)};
+    const __m128i alpha{_mm_set1_epi32(static_cast<int>(0xFF000000))};
+    for (; pixel_count - i >= 6; i += 4)
+    {
+        const __m128i bytes{_mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (i * 3)))};
+        const __m128i pixels{_mm_unpacklo_epi64(_mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3)),
+                                                _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9)))};
+        const __m128i green_and_alpha{_mm_or_si128(_mm_and_si128(pixels, green_mask), alpha)};
+        const __m128i red_and_blue{_mm_or_si128(_mm_and_si128(_mm_slli_epi32(pixels, 16), red_mask),
+                                                _mm_and_si128(_mm_srli_epi32(pixels, 16), blue_mask))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + (i * 4)), _mm_or_si128(green_and_alpha, red_and_blue));
+    }
+#endif
+
+    return i;
+}
+
+// 8 gray pixels for each value of a byte of PBM pixels.
+constexpr auto bits_to_gray_table{[] {
+    std::array<std::array<byte, 8>, 256> table{};
+    for (size_t value{}; value != table.size(); ++value)
+    {
+        for (size_t bit{}; bit != 8; ++bit)
+        {
+            table[value][bit] = (value & (0x80U >> bit)) != 0 ? byte{} : byte{0xFF};
+        }
+    }
+    return table;
+}()};
+
+} // namespace
+
+
+export void pack_row_to_crumbs(const byte* byte_pixels, byte* crumb_pixels, const size_t width) noexcept
+{
+    const size_t packed{pack_row_to_crumbs_simd(byte_pixels, crumb_pixels, width)};
+    scalar::pack_row_to_crumbs(byte_pixels + packed, crumb_pixels + (packed / 4), width - packed);
+}
+
+export void pack_row_to_nibbles(const byte* byte_pixels, byte* nibble_pixels, const size_t width) noexcept
+{
+    const size_t packed{pack_row_to_nibbles_simd(byte_pixels, nibble_pixels, width)};
+    scalar::pack_row_to_nibbles(byte_pixels + packed, nibble_pixels + (packed / 2), width - packed);
+}
+
+export void pack_to_crumbs(const span<const byte> byte_pixels, byte* crumb_pixels, const size_t width,
+                           const size_t height, const size_t stride) noexcept
+{
+    for (size_t row{}; row != height; ++row)
+    {
+        pack_row_to_crumbs(byte_pixels.data() + (row * width), crumb_pixels + (row * stride), width);
+    }
+}
+
+export void pack_to_nibbles(const span<const byte> byte_pixels, byte* nibble_pixels, const size_t width,
+                            const size_t height, const size_t stride) noexcept
+{
+    for (size_t row{}; row != height; ++row)
+    {
+        pack_row_to_nibbles(byte_pixels.data() + (row * width), nibble_pixels + (row * stride), width);
+    }
+}
+
+/// <summary>
+/// Unpacks a row of 1, 2 or 4 bits per pixel (the first pixel in the most significant bits) to 1 byte per pixel.
+/// </summary>
+export void unpack_row(const byte* packed_pixels, byte* byte_pixels, const size_t width,
+                       const uint32_t bits_per_pixel) noexcept
+{
+    const size_t pixels_per_byte{8 / bits_per_pixel};
+    const byte mask{static_cast<byte>((1U << bits_per_pixel) - 1)};
+    for (size_t i{}; i != width; ++i)
+    {
+        const size_t shift{8 - (((i % pixels_per_byte) + 1) * bits_per_pixel)};
+        byte_pixels[i] = (packed_pixels[i / pixels_per_byte] >> shift) & mask;
+    }
+}
+
+export void convert_to_little_endian(const byte* big_endian_samples, uint16_t* samples, const size_t sample_count) noexcept
+{
+    const size_t converted{convert_to_little_endian_simd(big_endian_samples, samples, sample_count)};
+    scalar::convert_to_little_endian(big_endian_samples + (converted * 2), samples + converted, sample_count - converted);
+}
+
+/// <summary>
+/// Converts big endian 16-bit samples to 8-bit samples in the same pass as the byte swap, rescaled from
+/// 0..max_value to 0..255 with rounding (used to return 16-bit images in an 8-bit pixel format).
+/// </summary>
+export void convert_to_8_bit_and_rescale(const byte* big_endian_samples, byte* samples, const size_t sample_count,
+                                         const uint32_t max_value) noexcept
+{
+    const size_t converted{convert_to_8_bit_and_rescale_simd(big_endian_samples, samples, sample_count, max_value)};
+    scalar::convert_to_8_bit_and_rescale(big_endian_samples + (converted * 2), samples + converted,
+                                         sample_count - converted, max_value);
+}
+
+/// <summary>
+/// Rescales 8-bit samples from 0..max_value to 0..255 with rounding (used for maximum values that are not 2^n - 1).
+/// Source and destination may point to the same memory.
+/// </summary>
+export void rescale_8_bit(const byte* samples, byte* rescaled, const size_t sample_count,
+                          const uint32_t max_value) noexcept
+{
+    const size_t converted{rescale_8_bit_simd(samples, rescaled, sample_count, max_value)};
+    scalar::rescale_8_bit(samples + converted, rescaled + converted, sample_count - converted, max_value);
+}
+
+/// <summary>
+/// Converts big endian 16-bit samples to little endian in the same pass as an exact rescale from 0..max_value to
+/// 0..65535 with rounding (used for maximum values that are not 2^n - 1, a shift would not use the complete range).
+/// Source and destination may point to the same memory.
+/// </summary>
+export void convert_to_little_endian_and_rescale(const byte* big_endian_samples, uint16_t* samples,
+                                                 const size_t sample_count, const uint32_t max_value) noexcept
+{
+    const size_t converted{
+        convert_to_little_endian_and_rescale_simd(big_endian_samples, samples, sample_count, max_value)};
+    scalar::convert_to_little_endian_and_rescale(big_endian_samples + (converted * 2), samples + converted,
+                                                 sample_count - converted, max_value);
+}
+
+/// <summary>
+/// Converts little endian 16-bit samples to big endian (the byte order of binary Netpbm files). A byte swap is its
+/// own inverse: the SIMD kernel of the decoder is reused.
+/// </summary>
+export void convert_to_big_endian(const uint16_t* samples, byte* big_endian_samples, const size_t sample_count) noexcept
+{
+    convert_to_little_endian(reinterpret_cast<const byte*>(samples), reinterpret_cast<uint16_t*>(big_endian_samples),
+                             sample_count);
+}
+
+/// <summary>
+/// Inverts all bits of the packed pixels of a PBM row (1 = black) to the WIC BlackWhite format (1 = white).
+/// Source and destination may point to the same memory.
+/// </summary>
+export void invert_bits(const byte* source, byte* destination, const size_t size) noexcept
+{
+    const size_t inverted{invert_bits_simd(source, destination, size)};
+    scalar::invert_bits(source + inverted, destination + inverted, size - inverted);
+}
+
+/// <summary>
+/// Inverts the packed pixels of a PBM row segment that starts at bit_offset (1 - 7) in the first source byte, and
+/// shifts them to start at the most significant bit of the first destination byte (used to decode regions that don't
+/// start at a byte boundary).
+/// </summary>
+export void shift_and_invert_bits(const byte* source, byte* destination, const size_t bit_offset,
+                                  const size_t pixel_count) noexcept
+{
+    const size_t size{(pixel_count + 7) / 8};
+    const size_t source_size{(bit_offset + pixel_count + 7) / 8};
+    for (size_t i{}; i != size; ++i)
+    {
+        const byte next{i + 1 != source_size ? source[i + 1] >> (8 - bit_offset) : byte{}};
+        destination[i] = ~((source[i] << bit_offset) | next);
+    }
+}
+
+/// <summary>
+/// Expands 1 bit per pixel PBM pixels (1 = black) to 8-bit gray (0 = black, 255 = white) with a lookup table:
+/// 8 pixels per table entry.
+/// </summary>
+export void expand_bits_to_gray(const byte* bits, byte* gray, const size_t width) noexcept
+{
+    const size_t byte_count{width / 8};
+    for (size_t i{}; i != byte_count; ++i)
+    {
+        std::memcpy(gray + (i * 8), bits_to_gray_table[std::to_integer<size_t>(bits[i])].data(), 8);
+    }
+
+    scalar::expand_bits_to_gray(bits + byte_count, gray + (byte_count * 8), width % 8);
+}
+
+/// <summary>
+/// Expands 8-bit gray + alpha pixels to RGBA: WIC has no gray + alpha pixel format. Samples with a max_value below
+/// 255 are first rescaled with rescale_8_bit into a buffer on the stack, 256 pixels at a time.
+/// </summary>
+export void expand_gray_alpha_to_rgba(const byte* gray_alpha, byte* rgba, const size_t pixel_count,
+                                      const uint32_t max_value) noexcept
+{
+    const auto expand{[](const byte* source, byte* destination, const size_t count) noexcept {
+        const size_t expanded{expand_gray_alpha_to_rgba_simd(source, destination, count)};
+        scalar::expand_gray_alpha_to_rgba(source + (expanded * 2), destination + (expanded * 4), count - expanded, 255);
+    }};
+
+    if (max_value == 255)
+    {
+        expand(gray_alpha, rgba, pixel_count);
+        return;
+    }
+
+    constexpr size_t chunk_size{256};
+    std::array<byte, chunk_size * 2> rescaled;
+    for (size_t i{}; i < pixel_count; i += chunk_size)
+    {
+        const size_t count{std::min(pixel_count - i, chunk_size)};
+        rescale_8_bit(gray_alpha + (i * 2), rescaled.data(), count * 2, max_value);
+        expand(rescaled.data(), rgba + (i * 4), count);
+    }
+}
+
+/// <summary>
+/// Expands big endian 16-bit gray + alpha pixels to little endian RGBA. Samples with a max_value below 65535 are
+/// first byte swapped and rescaled with convert_to_little_endian_and_rescale into a buffer on the stack, 256 pixels at
+/// a time, and then copied to the R, G, B and A samples.
+/// </summary>
+export void expand_big_endian_gray_alpha_to_rgba(const byte* gray_alpha, uint16_t* rgba, const size_t pixel_count,
+                                                 const uint32_t max_value) noexcept
+{
+    if (max_value == 65535)
+    {
+        const size_t expanded{expand_big_endian_gray_alpha_to_rgba_simd(gray_alpha, rgba, pixel_count)};
+        scalar::expand_big_endian_gray_alpha_to_rgba(gray_alpha + (expanded * 4), rgba + (expanded * 4),
+                                                     pixel_count - expanded, 65535);
+        return;
+    }
+
+    constexpr size_t chunk_size{256};
+    std::array<uint16_t, chunk_size * 2> rescaled;
+    for (size_t i{}; i < pixel_count; i += chunk_size)
+    {
+        const size_t count{std::min(pixel_count - i, chunk_size)};
+        convert_to_little_endian_and_rescale(gray_alpha + (i * 4), rescaled.data(), count * 2, max_value);
+        for (size_t j{}; j != count; ++j)
+        {
+            uint16_t* pixel{rgba + ((i + j) * 4)};
+            pixel[0] = rescaled[j * 2];
+            pixel[1] = rescaled[j * 2];
+            pixel[2] = rescaled[j * 2];
+            pixel[3] = rescaled[(j * 2) + 1];
+        }
+    }
+}
+
+/// <summary>
+/// Swaps the red and blue samples of 8-bit RGB pixels (the order of GUID_WICPixelFormat24bppBGR) with pshufb.
+/// Source and destination may point to the same memory.
+/// </summary>
+export void swap_red_and_blue(const byte* rgb, byte* bgr, const size_t pixel_count) noexcept
+{
+    const size_t swapped{swap_red_and_blue_simd(rgb, bgr, pixel_count)};
+    scalar::swap_red_and_blue(rgb + (swapped * 3), bgr + (swapped * 3), pixel_count - swapped);
+}
+
+/// <summary>
+/// Expands 8-bit RGB pixels to opaque BGRA pixels (GUID_WICPixelFormat32bppBGRA, the format used to render) with
+/// pshufb.
+/// </summary>
+export void expand_rgb_to_bgra(const byte* rgb, byte* bgra, const size_t pixel_count) noexcept
+{
+    const size_t expanded{expand_rgb_to_bgra_simd(rgb, bgra, pixel_count)};
+    scalar::expand_rgb_to_bgra(rgb + (expanded * 3), bgra + (expanded * 4), pixel_count - expanded);
+}
+
+/// <summary>
+/// Converts in-place big endian 16-bit samples (the de facto standard for binary Netpbm files) to little endian.
+/// </summary>
+export void convert_to_little_endian(const span<uint16_t> samples) noexcept
+{
+    convert_to_little_endian(reinterpret_cast<const byte*>(samples.data()), samples.data(), samples.size());
+}
+
+/// <summary>
+/// Adds 8-bit samples to 32-bit sums (used to box filter rows vertically).
+/// </summary>
+export void accumulate_row(const byte* samples, uint32_t* sums, const size_t sample_count) noexcept
+{
+    const size_t accumulated{accumulate_row_simd(samples, sums, sample_count)};
+    scalar::accumulate_row(samples + accumulated, sums + accumulated, sample_count - accumulated);
+}
+
+/// <summary>
+/// Adds big endian 16-bit samples to 32-bit sums (used to box filter rows vertically).
+/// </summary>
+export void accumulate_big_endian_row(const byte* big_endian_samples, uint32_t* sums, const size_t sample_count) noexcept
+{
+    const size_t accumulated{accumulate_big_endian_row_simd(big_endian_samples, sums, sample_count)};
+    scalar::accumulate_big_endian_row(big_endian_samples + (accumulated * 2), sums + accumulated,
+                                      sample_count - accumulated);
+}
+
+/// <summary>
+/// Completes a box filter: averages factor adjacent pixels of the vertical sums of row_count rows into 1 8-bit pixel.
+/// Power of 2 sizes (the scaled decode) use SIMD kernels, other sizes (thumbnails) the scalar code.
+/// </summary>
+export void average_row(const uint32_t* sums, byte* destination, const size_t destination_width,
+                        const size_t samples_per_pixel, const size_t factor, const size_t row_count) noexcept
+{
+    const size_t averaged{
+        average_row_simd(sums, destination, destination_width, samples_per_pixel, factor, row_count)};
+    scalar::average_row(sums + (averaged * factor * samples_per_pixel), destination + (averaged * samples_per_pixel),
+                        destination_width - averaged, samples_per_pixel, factor, row_count);
+}
+
+/// <summary>
+/// Completes a box filter: averages factor adjacent pixels of the vertical sums of row_count rows into 1 big endian
+/// 16-bit pixel.
+/// </summary>
+export void average_big_endian_row(const uint32_t* sums, byte* destination, const size_t destination_width,
+                                   const size_t samples_per_pixel, const size_t factor, const size_t row_count) noexcept
+{
+    const size_t averaged{
+        average_big_endian_row_simd(sums, destination, destination_width, samples_per_pixel, factor, row_count)};
+    scalar::average_big_endian_row(sums + (averaged * factor * samples_per_pixel),
+                                   destination + (averaged * samples_per_pixel * 2), destination_width - averaged,
+                                   samples_per_pixel, factor, row_count);
+}
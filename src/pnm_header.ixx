@@ -13,7 +13,9 @@ import winrt;
 
 import buffered_stream_reader;
 import errors;
+#ifdef _WIN32
 import util;
+#endif
 
 using winrt::throw_hresult;
 using std::uint32_t;
@@ -22,9 +24,45 @@ export enum class PnmType
 {
     Bitmap,
     Graymap,
-    Pixmap
+    Pixmap,
+    ArbitraryMap
 };
 
+/// <summary>
+/// Meaning of the samples of a pixel (the PAM TUPLTYPE). PBM, PGM and PPM files have an implied tuple type.
+/// </summary>
+export enum class TupleType
+{
+    Unknown,
+    BlackAndWhite,
+    Grayscale,
+    Rgb,
+    GrayscaleAlpha,
+    RgbAlpha
+};
+
+/// <summary>
+/// Returns the digit of the magic number ("P1" to "P7") of an image type. Only bitmaps, graymaps and pixmaps have a
+/// plain (ASCII) format.
+/// </summary>
+export [[nodiscard]] constexpr char magic_number_digit(const PnmType pnm_type, const bool ascii_format) noexcept
+{
+    switch (pnm_type)
+    {
+    case PnmType::Bitmap:
+        return ascii_format ? '1' : '4';
+    case PnmType::Graymap:
+        return ascii_format ? '2' : '5';
+    case PnmType::Pixmap:
+        return ascii_format ? '3' : '6';
+    case PnmType::ArbitraryMap:
+        break;
+    }
+
+    return '7';
+}
+
+#ifdef _WIN32
 export bool is_pnm_file(_In_ IStream* stream)
 {
     char magic[2];
@@ -32,15 +70,18 @@ export bool is_pnm_file(_In_ IStream* stream)
     unsigned long read;
     check_hresult(stream->Read(magic, sizeof magic, &read), wincodec::error_stream_read);
 
-    return read == sizeof magic && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6');
+    return read == sizeof magic && magic[0] == 'P' && magic[1] >= '2' && magic[1] <= '7';
 }
+#endif
 
 export struct pnm_header
 {
-    PnmType PnmType;
+    ::PnmType PnmType;
     bool AsciiFormat;
     uint32_t width;
     uint32_t height;
+    uint32_t depth; // Samples per pixel.
+    TupleType tuple_type;
     USHORT MaxColorValue;
 
     pnm_header() = default;
@@ -68,23 +109,35 @@ export struct pnm_header
         {
         case '1': // P1: bitmap, ASCII
             AsciiFormat = true;
+            [[fallthrough]];
         case '4': // P4: bitmap, binary
             PnmType = PnmType::Bitmap;
             break;
         case '2': // P2: graymap, ASCII
             AsciiFormat = true;
+            [[fallthrough]];
         case '5': // P5: graymap, binary
             PnmType = PnmType::Graymap;
             break;
         case '3': // P3: pixmap, ASCII
             AsciiFormat = true;
+            [[fallthrough]];
         case '6': // P6: pixmap, binary
             PnmType = PnmType::Pixmap;
             break;
+        case '7': // P7: arbitrary map, binary
+            PnmType = PnmType::ArbitraryMap;
+            parse_arbitrary_map_header(streamReader);
+            return error_ok;
         default:
             throw_hresult(wincodec::error_bad_header);
         }
 
+        depth = PnmType == PnmType::Pixmap ? 3 : 1;
+        tuple_type = PnmType == PnmType::Bitmap    ? TupleType::BlackAndWhite
+                     : PnmType == PnmType::Graymap ? TupleType::Grayscale
+                                                   : TupleType::Rgb;
+
         width = streamReader.read_int();
         height = streamReader.read_int();
 
@@ -107,4 +160,120 @@ export struct pnm_header
 
         return error_ok;
     }
+
+    /// <summary>
+    /// Returns the size in bytes of the pixel data of a binary image: the next image of a multi-image file starts
+    /// directly after it.
+    /// </summary>
+    [[nodiscard]] uint64_t pixel_data_size() const noexcept
+    {
+        const uint64_t row_size{PnmType == PnmType::Bitmap
+                                    ? (static_cast<uint64_t>(width) + 7) / 8
+                                    : static_cast<uint64_t>(width) * depth * (MaxColorValue > 255 ? 2 : 1)};
+        return row_size * height;
+    }
+
+private:
+    /// <summary>
+    /// Parses the lines with a keyword and a value of a PAM header, until the ENDHDR line.
+    /// </summary>
+    void parse_arbitrary_map_header(buffered_stream_reader& stream_reader)
+    {
+        width = 0;
+        height = 0;
+        depth = 0;
+        uint32_t max_value{};
+        std::optional<TupleType> tuple{};
+
+        for (;;)
+        {
+            const std::string_view keyword{stream_reader.read_word()};
+            if (keyword == "ENDHDR")
+                break;
+
+            if (keyword == "WIDTH")
+            {
+                width = stream_reader.read_int();
+            }
+            else if (keyword == "HEIGHT")
+            {
+                height = stream_reader.read_int();
+            }
+            else if (keyword == "DEPTH")
+            {
+                depth = stream_reader.read_int();
+            }
+            else if (keyword == "MAXVAL")
+            {
+                max_value = stream_reader.read_int();
+            }
+            else if (keyword == "TUPLTYPE")
+            {
+                tuple = to_tuple_type(stream_reader.read_word());
+            }
+            else
+            {
+                throw_hresult(wincodec::error_bad_header);
+            }
+        }
+
+        if (width < 1 || height < 1 || depth < 1 || max_value < 1 || max_value > 65535)
+            throw_hresult(wincodec::error_bad_header);
+
+        // TUPLTYPE is optional: without it, the depth determines the meaning of the samples.
+        constexpr std::array default_tuple_types{TupleType::Grayscale, TupleType::GrayscaleAlpha, TupleType::Rgb,
+                                                 TupleType::RgbAlpha};
+        tuple_type = tuple.value_or(depth <= default_tuple_types.size() ? default_tuple_types[depth - 1]
+                                                                        : TupleType::Unknown);
+        if (const uint32_t expected_depth{tuple_type_depth(tuple_type)};
+            expected_depth != 0 && expected_depth != depth)
+            throw_hresult(wincodec::error_bad_header);
+
+        MaxColorValue = static_cast<USHORT>(max_value);
+    }
+
+    [[nodiscard]] static TupleType to_tuple_type(const std::string_view name) noexcept
+    {
+        if (name == "BLACKANDWHITE")
+            return TupleType::BlackAndWhite;
+
+        if (name == "GRAYSCALE")
+            return TupleType::Grayscale;
+
+        if (name == "RGB")
+            return TupleType::Rgb;
+
+        if (name == "GRAYSCALE_ALPHA")
+            return TupleType::GrayscaleAlpha;
+
+        if (name == "RGB_ALPHA")
+            return TupleType::RgbAlpha;
+
+        return TupleType::Unknown;
+    }
+
+    /// <summary>
+    /// Returns the number of samples per pixel of a tuple type, or 0 when any depth is allowed.
+    /// </summary>
+    [[nodiscard]] static constexpr uint32_t tuple_type_depth(const TupleType type) noexcept
+    {
+        switch (type)
+        {
+        case TupleType::BlackAndWhite:
+        case TupleType::Grayscale:
+            return 1;
+
+        case TupleType::GrayscaleAlpha:
+            return 2;
+
+        case TupleType::Rgb:
+            return 3;
+
+        case TupleType::RgbAlpha:
+            return 4;
+
+        default:
+            return 0;
+        }
+    }
 };
@@ -34,7 +34,8 @@ export void set_value(const std::wstring& sub_key, _Null_terminated_ const wchar
     set_value(sub_key.c_str(), value_name, value);
 }
 
-export void set_value(_Null_terminated_ const wchar_t* sub_key, _Null_terminated_ const wchar_t* value_name, const std::uint32_t value)
+export void set_value(_Null_terminated_ const wchar_t* sub_key, _Null_terminated_ const wchar_t* value_name,
+                      const std::uint32_t value)
 {
     check_win32(RegSetKeyValue(hkey_local_machine, sub_key, value_name, REG_DWORD, &value, sizeof value));
 }
@@ -63,6 +64,18 @@ export void set_value(const std::wstring& sub_key, _Null_terminated_ const wchar
     set_value(sub_key.c_str(), value_name, value, value_size_in_bytes);
 }
 
+export [[nodiscard]] std::optional<std::uint32_t> get_value(_Null_terminated_ const wchar_t* sub_key,
+                                                           _Null_terminated_ const wchar_t* value_name) noexcept
+{
+    std::uint32_t value;
+    DWORD value_size{sizeof value};
+    if (RegGetValueW(hkey_local_machine, sub_key, value_name, RRF_RT_REG_DWORD, nullptr, &value, &value_size) !=
+        ERROR_SUCCESS)
+        return std::nullopt;
+
+    return value;
+}
+
 export HRESULT delete_tree(_Null_terminated_ const wchar_t* sub_key) noexcept
 {
     if (const LSTATUS result = RegDeleteTreeW(hkey_local_machine, sub_key); result != ERROR_SUCCESS)
@@ -0,0 +1,47 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module settings;
+
+import std;
+
+import registry;
+
+// Purpose: optional tuning settings, read once from the registry (HKEY_LOCAL_MACHINE\SOFTWARE\Team CharLS\Netpbm Codec).
+
+constexpr wchar_t settings_sub_key[]{LR"(SOFTWARE\Team CharLS\Netpbm Codec)"};
+
+export struct settings final
+{
+    /// <summary>
+    /// Number of worker threads used to convert large images (registry value ThreadCount, 0 = hardware threads).
+    /// </summary>
+    std::uint32_t thread_count;
+
+    /// <summary>
+    /// Minimum image size in bytes for multi-threaded conversion (registry value ParallelThreshold).
+    /// </summary>
+    std::uint32_t parallel_threshold;
+
+    /// <summary>
+    /// Number of frames of a multi-image stream that are decoded ahead on worker threads, while the caller consumes
+    /// the current frame (registry value PrefetchFrameCount, 0 = disabled).
+    /// </summary>
+    std::uint32_t prefetch_frame_count;
+};
+
+export [[nodiscard]] const settings& get_settings()
+{
+    static const settings instance{[] {
+        const std::uint32_t thread_count{registry::get_value(settings_sub_key, L"ThreadCount").value_or(0)};
+
+        return settings{.thread_count{thread_count == 0 ? std::max(std::thread::hardware_concurrency(), 1U)
+                                                        : thread_count},
+                        .parallel_threshold{registry::get_value(settings_sub_key, L"ParallelThreshold")
+                                                .value_or(16 * 1024 * 1024)},
+                        .prefetch_frame_count{
+                            registry::get_value(settings_sub_key, L"PrefetchFrameCount").value_or(0)}};
+    }()};
+
+    return instance;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#pragma once
+
+// Select the SIMD instruction sets of the x86/x64 kernels. Other architectures (ARM64) use the portable scalar
+// implementations.
+// SSE2 is part of the x64 baseline and is used unconditionally. The SSSE3 and AVX2 kernels are always compiled, but
+// only called when the CPU supports them: the binaries don't require a /arch (MSVC) or -m (GCC\Clang) option and run
+// on every x64 CPU. MSVC allows all intrinsics in any function, GCC\Clang need a target attribute on the functions
+// that use them.
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_SSE2 1
+#define SIMD_SSSE3 1
+#define SIMD_AVX2 1
+#endif
+
+#ifdef SIMD_SSE2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+
+#define SIMD_TARGET_SSSE3
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace simd {
+
+struct cpu_features final
+{
+    bool ssse3;
+    bool avx2;
+};
+
+[[nodiscard]] inline cpu_features detect_cpu_features() noexcept
+{
+#ifdef _MSC_VER
+    int registers[4];
+    __cpuid(registers, 0);
+    const int highest_function{registers[0]};
+
+    __cpuid(registers, 1);
+    const bool ssse3{(registers[2] & (1 << 9)) != 0};
+
+    // AVX2 also needs the OS to save the YMM registers: OSXSAVE and AVX are set and XCR0 enables the SSE and AVX state.
+    constexpr int osxsave_and_avx{(1 << 27) | (1 << 28)};
+    bool avx2{};
+    if (highest_function >= 7 && (registers[2] & osxsave_and_avx) == osxsave_and_avx && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(registers, 7, 0);
+        avx2 = (registers[1] & (1 << 5)) != 0;
+    }
+
+    return {.ssse3{ssse3}, .avx2{avx2}};
+#else
+    __builtin_cpu_init();
+    return {.ssse3{__builtin_cpu_supports("ssse3") != 0}, .avx2{__builtin_cpu_supports("avx2") != 0}};
+#endif
+}
+
+// Detected once, when the module is loaded: the kernels only test a flag to select their implementation.
+inline const cpu_features cpu{detect_cpu_features()};
+
+} // namespace simd
+
+#endif
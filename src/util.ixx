@@ -13,9 +13,7 @@ import winrt;
 
 import errors;
 
-namespace {
-
-[[nodiscard]] HMODULE get_current_module() noexcept
+export [[nodiscard]] HMODULE get_current_module() noexcept
 {
     HMODULE module;
     GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
@@ -24,8 +22,6 @@ namespace {
     return module;
 }
 
-} // namespace
-
 export constexpr std::byte operator"" _byte(const unsigned long long int n)
 {
     return static_cast<std::byte>(n);
@@ -52,6 +48,12 @@ export [[nodiscard]] const char* pixel_format_to_string(const GUID& guid) noexce
     if (guid == GUID_WICPixelFormat48bppRGB)
         return "GUID_WICPixelFormat48bppRGB";
 
+    if (guid == GUID_WICPixelFormat32bppRGBA)
+        return "GUID_WICPixelFormat32bppRGBA";
+
+    if (guid == GUID_WICPixelFormat64bppRGBA)
+        return "GUID_WICPixelFormat64bppRGBA";
+
     return "Unknown";
 }
 
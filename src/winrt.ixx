@@ -22,9 +22,12 @@ export module winrt;
 export namespace winrt {
 
 using winrt::check_hresult;
+using winrt::check_pointer;
 using winrt::check_win32;
 using winrt::com_ptr;
+using winrt::file_handle;
 using winrt::get_module_lock;
+using winrt::handle;
 using winrt::hresult;
 using winrt::implements;
 using winrt::make;
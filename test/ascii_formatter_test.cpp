@@ -0,0 +1,88 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "cpp_unit_test.hpp"
+
+import std;
+
+import ascii_formatter;
+
+using std::byte;
+using std::size_t;
+using std::string;
+using std::uint16_t;
+using std::uint8_t;
+using std::vector;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace {
+
+[[nodiscard]] string format(const vector<uint16_t>& values, size_t& line_length)
+{
+    vector<byte> text(max_formatted_size(values.size()));
+    const size_t size{format_decimal_values(values.data(), values.size(), text.data(), line_length)};
+    return {reinterpret_cast<const char*>(text.data()), size};
+}
+
+} // namespace
+
+TEST_CLASS(ascii_formatter_test)
+{
+public:
+    TEST_METHOD(format_decimal_values_separated_by_space) // NOLINT
+    {
+        size_t line_length{};
+        const string text{format({0, 9, 10, 99, 100, 999, 1000, 9999, 10000, 65535}, line_length)};
+
+        Assert::AreEqual(string{"0 9 10 99 100 999 1000 9999 10000 65535"}, text);
+        Assert::AreEqual(text.size(), line_length);
+    }
+
+    TEST_METHOD(format_decimal_values_continues_line) // NOLINT
+    {
+        size_t line_length{5};
+        const string text{format({1, 2}, line_length)};
+
+        Assert::AreEqual(string{" 1 2"}, text);
+        Assert::AreEqual(size_t{9}, line_length);
+    }
+
+    TEST_METHOD(format_decimal_values_wraps_at_70_characters) // NOLINT
+    {
+        // 11 values of 5 digits and 10 spaces make 65 characters: the 12th value starts a new line.
+        size_t line_length{};
+        const string text{format(vector<uint16_t>(12, 65535), line_length)};
+
+        Assert::AreEqual(size_t{65}, text.find('\n'));
+        Assert::AreEqual(size_t{5}, line_length);
+    }
+
+    TEST_METHOD(format_decimal_values_8_bit) // NOLINT
+    {
+        const std::array<uint8_t, 3> values{7, 42, 255};
+        vector<byte> text(max_formatted_size(values.size()));
+        size_t line_length{};
+
+        const size_t size{format_decimal_values(values.data(), values.size(), text.data(), line_length)};
+
+        Assert::AreEqual(string{"7 42 255"}, string{reinterpret_cast<const char*>(text.data()), size});
+    }
+
+    TEST_METHOD(format_decimal_values_same_as_scalar) // NOLINT
+    {
+        vector<uint16_t> values(65536);
+        std::iota(values.begin(), values.end(), uint16_t{});
+        vector<byte> expected(max_formatted_size(values.size()));
+        size_t expected_line_length{};
+        const size_t expected_size{
+            scalar::format_decimal_values(values.data(), values.size(), expected.data(), expected_line_length)};
+
+        size_t line_length{};
+        const string text{format(values, line_length)};
+
+        Assert::AreEqual(expected_size, text.size());
+        Assert::AreEqual(expected_line_length, line_length);
+        Assert::IsTrue(std::equal(text.begin(), text.end(), reinterpret_cast<const char*>(expected.data())));
+    }
+};
@@ -0,0 +1,203 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "cpp_unit_test.hpp"
+
+import std;
+
+import ascii_parser;
+
+using std::byte;
+using std::size_t;
+using std::string_view;
+using std::uint16_t;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace {
+
+[[nodiscard]] const byte* as_bytes(const string_view text) noexcept
+{
+    return reinterpret_cast<const byte*>(text.data());
+}
+
+} // namespace
+
+TEST_CLASS(ascii_parser_test)
+{
+public:
+    TEST_METHOD(is_whitespace_all_characters) // NOLINT
+    {
+        for (unsigned int c{}; c != 256; ++c)
+        {
+            const bool expected{c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r'};
+            Assert::AreEqual(expected, is_whitespace(static_cast<byte>(c)));
+        }
+    }
+
+    TEST_METHOD(find_non_whitespace_every_position) // NOLINT
+    {
+        for (size_t position{}; position != 20; ++position)
+        {
+            std::string text(20, ' ');
+            for (size_t i{}; i != position; ++i)
+            {
+                text[i] = "\t\n\v\f\r "[i % 6];
+            }
+            text[position] = '1';
+
+            Assert::AreEqual(position, find_non_whitespace(as_bytes(text), text.size()));
+        }
+    }
+
+    TEST_METHOD(find_non_whitespace_only_whitespace) // NOLINT
+    {
+        constexpr string_view text{" \t\r\n          \n"};
+        Assert::AreEqual(text.size(), find_non_whitespace(as_bytes(text), text.size()));
+    }
+
+    TEST_METHOD(find_non_whitespace_high_ascii) // NOLINT
+    {
+        // Bytes with the high bit set (for example 0x89 and 0x8D) are not whitespace.
+        constexpr string_view text{"        \x89"};
+        Assert::AreEqual(size_t{8}, find_non_whitespace(as_bytes(text), text.size()));
+    }
+
+    TEST_METHOD(find_end_of_line_line_feed_or_carriage_return) // NOLINT
+    {
+        constexpr string_view line_feed{"# comment\nP5"};
+        Assert::AreEqual(size_t{9}, find_end_of_line(as_bytes(line_feed), line_feed.size()));
+
+        constexpr string_view carriage_return{"# comment\r\n"};
+        Assert::AreEqual(size_t{9}, find_end_of_line(as_bytes(carriage_return), carriage_return.size()));
+
+        constexpr string_view no_end{"# comment"};
+        Assert::AreEqual(no_end.size(), find_end_of_line(as_bytes(no_end), no_end.size()));
+    }
+
+    TEST_METHOD(parse_decimal_values_equals_scalar) // NOLINT
+    {
+        // Long enough for several SIMD windows, with values that cross the window boundaries.
+        std::string text;
+        std::vector<size_t> value_ends;
+        for (unsigned int i{}; i != 1000; ++i)
+        {
+            text += std::to_string((i * 7919) % 65536);
+            value_ends.push_back(text.size());
+            text += "\t\n\v\f\r "[i % 6];
+            if (i % 5 == 0)
+            {
+                text += "   ";
+            }
+        }
+
+        std::vector<uint16_t> expected(1000);
+        const auto [expected_consumed, expected_count, expected_valid]{
+            scalar::parse_decimal_values(as_bytes(text), text.size(), expected.data(), expected.size())};
+        Assert::AreEqual(size_t{1000}, expected_count);
+        Assert::IsTrue(expected_valid);
+
+        std::vector<uint16_t> actual(1000);
+        const auto [consumed, count, valid]{parse_decimal_values(as_bytes(text), text.size(), actual.data(), 999)};
+        Assert::AreEqual(size_t{999}, count);
+        Assert::IsTrue(valid);
+        Assert::IsTrue(std::equal(actual.begin(), actual.begin() + 999, expected.begin()));
+        Assert::AreEqual(value_ends[999], expected_consumed);
+        Assert::AreEqual(value_ends[998], consumed);
+    }
+
+    TEST_METHOD(count_values_every_position) // NOLINT
+    {
+        constexpr string_view text{"1 22\t333\n\n4444 55555 x\r\n7"};
+        for (size_t size{}; size <= text.size(); ++size)
+        {
+            const string_view part{text.substr(0, size)};
+            size_t expected{};
+            for (size_t i{}; i != part.size(); ++i)
+            {
+                if (!is_whitespace(byte{static_cast<unsigned char>(part[i])}) &&
+                    (i == 0 || is_whitespace(byte{static_cast<unsigned char>(part[i - 1])})))
+                {
+                    ++expected;
+                }
+            }
+
+            Assert::AreEqual(expected, count_values(as_bytes(part), part.size()));
+        }
+    }
+
+    TEST_METHOD(parse_decimal_values_parallel_equals_serial) // NOLINT
+    {
+        // Large enough for several chunks.
+        constexpr size_t count{500'000};
+        std::string text;
+        for (size_t i{}; i != count; ++i)
+        {
+            text += std::to_string((i * 7919) % 65536);
+            text += i % 16 == 15 ? '\n' : ' ';
+        }
+        text += "P2 extra data";
+
+        std::vector<uint16_t> expected(count);
+        const auto expected_result{parse_decimal_values(as_bytes(text), text.size(), expected.data(), count)};
+
+        for (const size_t thread_count : {1U, 3U, 8U})
+        {
+            std::vector<uint16_t> actual(count);
+            const auto [consumed, value_count, valid]{
+                parse_decimal_values_parallel(as_bytes(text), text.size(), actual.data(), count, thread_count)};
+
+            Assert::IsTrue(valid);
+            Assert::AreEqual(count, value_count);
+            Assert::AreEqual(expected_result.consumed, consumed);
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(parse_decimal_values_parallel_invalid_character) // NOLINT
+    {
+        std::string text(1'000'000, ' ');
+        text[900'000] = 'x';
+        std::vector<uint16_t> values(1);
+        const auto [consumed, value_count, valid]{
+            parse_decimal_values_parallel(as_bytes(text), text.size(), values.data(), values.size(), 4)};
+
+        Assert::IsFalse(valid);
+    }
+
+    TEST_METHOD(parse_decimal_values_leading_zeros) // NOLINT
+    {
+        constexpr string_view text{"0 00000000000000000000000000000000000000000000000000000000000000000000000065535 1"};
+        std::array<uint16_t, 3> values{};
+        const auto [consumed, count, valid]{parse_decimal_values(as_bytes(text), text.size(), values.data(), 3)};
+
+        Assert::IsTrue(valid);
+        Assert::AreEqual(size_t{3}, count);
+        Assert::AreEqual(text.size(), consumed);
+        Assert::AreEqual(uint16_t{65535}, values[1]);
+        Assert::AreEqual(uint16_t{1}, values[2]);
+    }
+
+    TEST_METHOD(parse_decimal_values_invalid_character) // NOLINT
+    {
+        std::string text(100, ' ');
+        text[70] = '1';
+        text[71] = 'x';
+        std::array<uint16_t, 2> values{};
+        const auto [consumed, count, valid]{parse_decimal_values(as_bytes(text), text.size(), values.data(), 2)};
+
+        Assert::IsFalse(valid);
+        Assert::AreEqual(size_t{0}, count);
+    }
+
+    TEST_METHOD(parse_decimal_values_too_large) // NOLINT
+    {
+        std::string text(100, ' ');
+        text.replace(10, 5, "65536");
+        std::array<uint16_t, 2> values{};
+        const auto [consumed, count, valid]{parse_decimal_values(as_bytes(text), text.size(), values.data(), 2)};
+
+        Assert::IsFalse(valid);
+        Assert::AreEqual(size_t{0}, count);
+    }
+};
@@ -0,0 +1,77 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "cpp_unit_test.hpp"
+
+import std;
+
+import band_pipeline;
+
+using std::size_t;
+using std::vector;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+TEST_CLASS(band_pipeline_test)
+{
+public:
+    TEST_METHOD(converts_every_row_once_after_read) // NOLINT
+    {
+        for (const size_t thread_count : {1U, 3U, 8U})
+        {
+            for (const size_t rows_per_band : {1U, 7U, 64U})
+            {
+                constexpr size_t row_count{1000};
+                vector<int> read(row_count);
+                vector<int> converted(row_count);
+                std::atomic<bool> converted_before_read{};
+
+                run_band_pipeline(
+                    row_count, rows_per_band, thread_count,
+                    [&](size_t, const size_t first_row, const size_t band_row_count) {
+                        std::fill_n(read.begin() + static_cast<std::ptrdiff_t>(first_row), band_row_count, 1);
+                    },
+                    [&](size_t, const size_t first_row, const size_t band_row_count) {
+                        for (size_t row{first_row}; row != first_row + band_row_count; ++row)
+                        {
+                            if (read[row] == 0)
+                            {
+                                converted_before_read = true;
+                            }
+                            ++converted[row];
+                        }
+                    });
+
+                Assert::IsFalse(converted_before_read);
+                Assert::IsTrue(std::ranges::all_of(converted, [](const int count) { return count == 1; }));
+            }
+        }
+    }
+
+    TEST_METHOD(read_exception_is_rethrown) // NOLINT
+    {
+        Assert::ExpectException<std::runtime_error>([] {
+            run_band_pipeline(
+                100, 10, 4,
+                [](const size_t band, size_t, size_t) {
+                    if (band == 5)
+                        throw std::runtime_error("read failed");
+                },
+                [](size_t, size_t, size_t) {});
+        });
+    }
+
+    TEST_METHOD(run_parallel_runs_every_task_once) // NOLINT
+    {
+        for (const size_t thread_count : {1U, 3U, 8U})
+        {
+            for (const size_t task_count : {0U, 1U, 100U})
+            {
+                vector<std::atomic<int>> runs(task_count);
+                run_parallel(task_count, thread_count, [&](const size_t task) noexcept { ++runs[task]; });
+
+                Assert::IsTrue(std::ranges::all_of(runs, [](const std::atomic<int>& count) { return count == 1; }));
+            }
+        }
+    }
+};
@@ -56,6 +56,171 @@ TEST_CLASS(buffered_stream_reader_test)
         Assert::AreEqual(256U, value);
     }
 
+    TEST_METHOD(read_int_skips_comments) // NOLINT
+    {
+        // The comment is longer than the initial read: the reader needs to refill while skipping it.
+        const std::string text{"# " + std::string(10'000, 'x') + "\r\n \t12\n#\n34 "};
+        std::vector<char> source(text.begin(), text.end());
+        buffered_stream_reader reader(create_memory_stream(source).get());
+
+        Assert::AreEqual(12U, reader.read_int());
+        Assert::AreEqual(34U, reader.read_int());
+    }
+
+    TEST_METHOD(read_int_not_terminated_by_whitespace) // NOLINT
+    {
+        const std::string text{"12a "};
+        std::vector<char> source(text.begin(), text.end());
+        buffered_stream_reader reader(create_memory_stream(source).get());
+
+        Assert::ExpectException<winrt::hresult_error>([&reader] { std::ignore = reader.read_int(); });
+    }
+
+    TEST_METHOD(read_span) // NOLINT
+    {
+        std::vector<char> source(100'000);
+        for (size_t i{}; i != source.size(); ++i)
+        {
+            source[i] = static_cast<char>(i);
+        }
+        buffered_stream_reader reader(create_memory_stream(source).get());
+
+        const auto first{reader.read_span(60'000)};
+        Assert::AreEqual(static_cast<int>(source[59'999]), static_cast<int>(first[59'999]));
+
+        // Crosses the boundary of the initial read buffer.
+        const auto second{reader.read_span(40'000)};
+        Assert::AreEqual(static_cast<int>(source[60'000]), static_cast<int>(second[0]));
+        Assert::AreEqual(static_cast<int>(source[99'999]), static_cast<int>(second[39'999]));
+    }
+
+    TEST_METHOD(read_with_small_initial_read_size) // NOLINT
+    {
+        std::vector<char> source(10'000);
+        for (size_t i{}; i != source.size(); ++i)
+        {
+            source[i] = static_cast<char>(i);
+        }
+        buffered_stream_reader reader(create_memory_stream(source).get(), 16);
+
+        // The buffer grows when more data is needed than the initial read.
+        std::vector<char> destination(20);
+        reader.read_bytes(destination.data(), destination.size());
+        Assert::AreEqual(static_cast<int>(source[19]), static_cast<int>(destination[19]));
+
+        const auto rest{reader.read_span(9'980)};
+        Assert::AreEqual(static_cast<int>(source[9'999]), static_cast<int>(rest[9'979]));
+        Assert::AreEqual(uint64_t{10'000}, reader.position());
+    }
+
+    TEST_METHOD(read_span_not_enough_available) // NOLINT
+    {
+        std::vector<char> source(2);
+        buffered_stream_reader reader(create_memory_stream(source).get());
+
+        Assert::ExpectException<winrt::hresult_error>([&reader] { std::ignore = reader.read_span(3); });
+    }
+
+    TEST_METHOD(read_buffer_from_memory_resource) // NOLINT
+    {
+        std::vector<char> source(100);
+        std::array<std::byte, 4096> arena;
+        std::pmr::monotonic_buffer_resource resource{arena.data(), arena.size(), std::pmr::null_memory_resource()};
+
+        // The read buffer is sized to the stream and allocated from the supplied resource.
+        buffered_stream_reader reader(create_memory_stream(source).get(), buffered_stream_reader::header_read_size,
+                                      &resource);
+        const auto view{reader.read_span(100)};
+        Assert::IsTrue(view.data() >= arena.data() && view.data() + view.size() <= arena.data() + arena.size());
+    }
+
+    TEST_METHOD(read_span_from_memory) // NOLINT
+    {
+        const std::string source{"P5 2 1 255 "};
+        const std::array pixels{std::byte{1}, std::byte{2}};
+        std::vector<std::byte> data(source.size());
+        std::memcpy(data.data(), source.data(), source.size());
+        data.insert(data.end(), pixels.begin(), pixels.end());
+        buffered_stream_reader reader{span<const std::byte>{data}};
+
+        char magic[2];
+        reader.read_bytes(magic, sizeof magic);
+        Assert::AreEqual(2U, reader.read_int());
+        Assert::AreEqual(1U, reader.read_int());
+        Assert::AreEqual(255U, reader.read_int());
+
+        // Memory backed views point directly into the source data.
+        const auto view{reader.read_span(2)};
+        Assert::IsTrue(reader.is_memory_backed());
+        Assert::IsTrue(view.data() == data.data() + source.size());
+        Assert::ExpectException<winrt::hresult_error>([&reader] { std::ignore = reader.read_span(1); });
+    }
+
+    TEST_METHOD(memory_resource_of_memory_reader) // NOLINT
+    {
+        const std::array data{std::byte{1}, std::byte{2}};
+        std::pmr::monotonic_buffer_resource resource;
+        buffered_stream_reader reader{span<const std::byte>{data}, &resource};
+
+        Assert::IsTrue(reader.memory_resource() == &resource);
+        Assert::AreEqual(size_t{2}, reader.read_bytes(2).size());
+    }
+
+    TEST_METHOD(read_decimal_values_across_reads) // NOLINT
+    {
+        std::string text;
+        for (unsigned int i{}; i != 1000; ++i)
+        {
+            text += std::to_string(i * 65);
+            text += i % 10 == 9 ? '\n' : ' ';
+        }
+        text.pop_back(); // The last value is terminated by the end of the stream.
+        std::vector<char> source(text.begin(), text.end());
+
+        // The small initial read size forces values to be split across reads.
+        buffered_stream_reader reader(create_memory_stream(source).get(), 16);
+        std::vector<std::uint16_t> values(1000);
+        reader.read_decimal_values(values.data(), 1);
+        reader.read_decimal_values(values.data() + 1, 999);
+
+        for (size_t i{}; i != values.size(); ++i)
+        {
+            Assert::AreEqual(static_cast<std::uint16_t>(i * 65), values[i]);
+        }
+        Assert::ExpectException<winrt::hresult_error>([&reader] {
+            std::uint16_t value;
+            reader.read_decimal_values(&value, 1);
+        });
+    }
+
+    TEST_METHOD(read_remaining) // NOLINT
+    {
+        std::vector<char> source(100'000);
+        for (size_t i{}; i != source.size(); ++i)
+        {
+            source[i] = static_cast<char>(i);
+        }
+        buffered_stream_reader reader(create_memory_stream(source).get(), 16);
+
+        std::array<char, 10> first;
+        reader.read_bytes(first.data(), first.size());
+        const auto rest{reader.read_remaining()};
+        Assert::AreEqual(source.size() - first.size(), rest.size());
+        Assert::AreEqual(static_cast<int>(source.back()), static_cast<int>(rest.back()));
+        Assert::AreEqual(uint64_t{source.size()}, reader.position());
+    }
+
+    TEST_METHOD(read_decimal_values_invalid_character) // NOLINT
+    {
+        std::string text{"1 2 3a 4"};
+        std::vector<char> source(text.begin(), text.end());
+        buffered_stream_reader reader(create_memory_stream(source).get());
+
+        std::array<std::uint16_t, 4> values;
+        Assert::ExpectException<winrt::hresult_error>(
+            [&reader, &values] { reader.read_decimal_values(values.data(), values.size()); });
+    }
+
 private:
     static com_ptr<IStream> create_memory_stream(span<char> source)
     {
@@ -11,6 +11,7 @@ import <win.hpp>;
 import test.winrt;
 
 export constexpr GUID net_pbm_decoder_class_id{0x6891bbe, 0xcc02, 0x4bb2, {0x9c, 0xf0, 0x30, 0x3f, 0xc4, 0xe6, 0x68, 0xc3}};
+export constexpr GUID net_pbm_encoder_class_id{0x3f1a5d4e, 0x8c27, 0x4b9a, {0xa6, 0xe2, 0x5d, 0x0c, 0x9b, 0x7e, 0x41, 0xf3}};
 
 /// <summary>
 /// Helper class that provides methods to create COM objects without registry registration.
@@ -45,6 +46,14 @@ export class codec_factory final
         return decoder;
     }
 
+    [[nodiscard]] winrt::com_ptr<IWICBitmapEncoder> create_encoder() const
+    {
+        winrt::com_ptr<IWICBitmapEncoder> encoder;
+        winrt::check_hresult(get_class_factory(net_pbm_encoder_class_id)->CreateInstance(nullptr, IID_PPV_ARGS(encoder.put())));
+
+        return encoder;
+    }
+
     [[nodiscard]] winrt::com_ptr<IClassFactory> get_class_factory(GUID const& class_id) const
     {
         winrt::com_ptr<IClassFactory> class_factory;
@@ -0,0 +1,111 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "cpp_unit_test.hpp"
+
+import std;
+
+import memory_pool;
+
+using std::size_t;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace {
+
+class counting_resource final : public std::pmr::memory_resource
+{
+public:
+    size_t allocated{};
+    size_t deallocated{};
+
+private:
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, const size_t bytes, const size_t alignment) override
+    {
+        deallocated += bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    [[nodiscard]] bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+} // namespace
+
+TEST_CLASS(memory_pool_test)
+{
+public:
+    TEST_METHOD(pooled_buffer_uses_resource) // NOLINT
+    {
+        counting_resource resource;
+        {
+            pooled_buffer buffer{100, &resource};
+            Assert::AreEqual(size_t{100}, buffer.size());
+            Assert::AreEqual(size_t{100}, resource.allocated);
+
+            pooled_buffer moved{std::move(buffer)};
+            Assert::AreEqual(size_t{100}, moved.size());
+            Assert::IsNull(buffer.data()); // NOLINT(bugprone-use-after-move)
+        }
+
+        Assert::AreEqual(size_t{100}, resource.deallocated);
+    }
+
+    TEST_METHOD(thread_memory_pool_recycles) // NOLINT
+    {
+        const std::byte* first;
+        {
+            const pooled_buffer buffer{65536, thread_memory_pool()};
+            first = buffer.data();
+        }
+
+        const pooled_buffer buffer{65536, thread_memory_pool()};
+        Assert::IsTrue(first == buffer.data());
+    }
+
+    TEST_METHOD(release_thread_memory_pool_on_worker_thread) // NOLINT
+    {
+        std::thread worker{[] {
+            {
+                const pooled_buffer buffer{65536, thread_memory_pool()};
+            }
+
+            release_thread_memory_pool();
+
+            // The pool can be used again after its memory is released.
+            const pooled_buffer buffer{65536, thread_memory_pool()};
+            Assert::AreEqual(size_t{65536}, buffer.size());
+        }};
+        worker.join();
+    }
+
+    TEST_METHOD(recycling_memory_resource_reuses_blocks_of_same_size) // NOLINT
+    {
+        counting_resource upstream;
+        {
+            recycling_memory_resource resource{1, &upstream};
+            const std::byte* first;
+            {
+                const pooled_buffer buffer{1000, &resource};
+                first = buffer.data();
+            }
+
+            const pooled_buffer same_size{1000, &resource};
+            Assert::IsTrue(first == same_size.data());
+            Assert::AreEqual(size_t{1000}, upstream.allocated);
+
+            const pooled_buffer other_size{2000, &resource};
+            Assert::AreEqual(size_t{3000}, upstream.allocated);
+        }
+
+        Assert::AreEqual(size_t{3000}, upstream.deallocated);
+    }
+};
@@ -5,6 +5,7 @@
 #include "intellisense.hpp"
 #include "cpp_unit_test.hpp"
 
+import std;
 import <win.hpp>;
 import test.winrt;
 
@@ -102,11 +103,31 @@ TEST_CLASS(netpbm_bitmap_decoder_test)
     }
 
     TEST_METHOD(GetThumbnail) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        check_hresult(
+            SHCreateStreamOnFileEx(L"tulips-gray-8bit-512-512.pgm", STGM_READ | STGM_SHARE_DENY_WRITE, 0, false, nullptr, stream.put()));
+
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        com_ptr<IWICBitmapSource> bitmap_source;
+        const auto result{decoder->GetThumbnail(bitmap_source.put())};
+        Assert::AreEqual(error_ok, result);
+
+        uint32_t width;
+        uint32_t height;
+        check_hresult(bitmap_source->GetSize(&width, &height));
+        Assert::AreEqual(256U, width);
+        Assert::AreEqual(256U, height);
+    }
+
+    TEST_METHOD(GetThumbnail_not_initialized) // NOLINT
     {
         com_ptr<IWICBitmapSource> bitmap_source;
         const auto result{codec_factory_.create_decoder()->GetThumbnail(bitmap_source.put())};
 
-        Assert::AreEqual(wincodec::error_codec_no_thumbnail, result);
+        Assert::AreEqual(wincodec::error_not_initialized, result);
     }
 
     TEST_METHOD(GetFrameCount) // NOLINT
@@ -114,8 +135,23 @@ TEST_CLASS(netpbm_bitmap_decoder_test)
         uint32_t frame_count;
         const auto result{codec_factory_.create_decoder()->GetFrameCount(&frame_count)};
 
+        Assert::AreEqual(wincodec::error_not_initialized, result);
+    }
+
+    TEST_METHOD(GetFrameCount_multiple_images) // NOLINT
+    {
+        // Binary images are concatenated without separator, a plain image can only be the last one.
+        const std::string source{std::string{"P5 2 1 255 \x01\x02"} + "P6\n1 1\n65535\n\x01\x02\x03\x04\x05\x06" +
+                                 "P4 9 1 \xFF\x80" + "P2 1 1 255 7\n"};
+        const com_ptr stream{create_memory_stream(source.data(), source.size())};
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        uint32_t frame_count;
+        const auto result{decoder->GetFrameCount(&frame_count)};
+
         Assert::AreEqual(error_ok, result);
-        Assert::AreEqual(1U, frame_count);
+        Assert::AreEqual(4U, frame_count);
     }
 
     TEST_METHOD(GetFrameCount_count_parameter_is_null) // NOLINT
@@ -237,7 +273,7 @@ TEST_CLASS(netpbm_bitmap_decoder_test)
 
         const auto result{codec_factory_.create_decoder()->Initialize(stream.get(), static_cast<WICDecodeOptions>(4))};
 
-        // Cache options is not used by decoder and by design not validated.
+        // Unknown cache options are by design not validated (handled as decode on demand).
         Assert::AreEqual(error_ok, result);
     }
 
@@ -286,12 +322,86 @@ TEST_CLASS(netpbm_bitmap_decoder_test)
 
     TEST_METHOD(GetFrame_with_bad_index) // NOLINT
     {
+        const std::string source{"P5 2 1 255 \x01\x02"};
+        const com_ptr stream{create_memory_stream(source.data(), source.size())};
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
         com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
-        const auto result{codec_factory_.create_decoder()->GetFrame(1, bitmap_frame_decode.put())};
+        const auto result{decoder->GetFrame(1, bitmap_frame_decode.put())};
 
         Assert::AreEqual(wincodec::error_frame_missing, result);
     }
 
+    TEST_METHOD(GetFrame_seeks_to_frame) // NOLINT
+    {
+        const std::string source{std::string{"P5 2 1 255 \x01\x02"} + "P5 2 1 255 \x03\x04" +
+                                 "P6 1 1 255 \x05\x06\x07"};
+        const com_ptr stream{create_memory_stream(source.data(), source.size())};
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+        check_hresult(decoder->GetFrame(2, bitmap_frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat24bppRGB == pixel_format);
+
+        vector<std::byte> pixels(3);
+        check_hresult(bitmap_frame_decode->CopyPixels(nullptr, 3, 3, reinterpret_cast<BYTE*>(pixels.data())));
+        Assert::AreEqual(5, static_cast<int>(pixels[0]));
+        Assert::AreEqual(7, static_cast<int>(pixels[2]));
+
+        check_hresult(decoder->GetFrame(1, bitmap_frame_decode.put()));
+        check_hresult(bitmap_frame_decode->CopyPixels(nullptr, 2, 2, reinterpret_cast<BYTE*>(pixels.data())));
+        Assert::AreEqual(3, static_cast<int>(pixels[0]));
+        Assert::AreEqual(4, static_cast<int>(pixels[1]));
+    }
+
+    TEST_METHOD(GetFrame_frames_decode_concurrently) // NOLINT
+    {
+        // Every frame reads from its own clone of the stream: the seeks of one frame don't move the other.
+        constexpr uint32_t width{512};
+        constexpr uint32_t height{64};
+        const std::string header{"P5 512 64 255\n"};
+        const std::string source{header + std::string(width * height, '\x11') + header +
+                                 std::string(width * height, '\x22')};
+        const com_ptr stream{create_memory_stream(source.data(), source.size())};
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        std::array<com_ptr<IWICBitmapFrameDecode>, 2> frames;
+        check_hresult(decoder->GetFrame(0, frames[0].put()));
+        check_hresult(decoder->GetFrame(1, frames[1].put()));
+
+        std::array<bool, 2> identical{};
+        {
+            std::array<std::jthread, 2> threads;
+            for (size_t i{}; i != frames.size(); ++i)
+            {
+                threads[i] = std::jthread{[&, i] {
+                    const auto expected{static_cast<std::byte>(0x11 * (i + 1))};
+                    vector<std::byte> row(width);
+                    bool all_identical{true};
+                    for (int32_t y{}; y != static_cast<int32_t>(height); ++y)
+                    {
+                        const WICRect rectangle{.X{0}, .Y{y}, .Width{static_cast<int32_t>(width)}, .Height{1}};
+                        all_identical &= frames[i]->CopyPixels(&rectangle, width, width,
+                                                               reinterpret_cast<BYTE*>(row.data())) == error_ok &&
+                                         std::ranges::all_of(row, [expected](const std::byte value) {
+                                             return value == expected;
+                                         });
+                    }
+                    identical[i] = all_identical;
+                }};
+            }
+        }
+
+        Assert::IsTrue(identical[0]);
+        Assert::IsTrue(identical[1]);
+    }
+
     TEST_METHOD(GetFrame_not_initialized) // NOLINT
     {
         com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
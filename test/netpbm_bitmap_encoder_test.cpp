@@ -0,0 +1,304 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "macros.hpp"
+#include "intellisense.hpp"
+#include "cpp_unit_test.hpp"
+
+import std;
+import <win.hpp>;
+import test.winrt;
+
+import test.errors;
+import codec_factory;
+
+using namespace winrt;
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using std::array;
+using std::string;
+using std::vector;
+
+// {70ab66f5-cd48-43a1-aa29-10131b7f4ff1}
+constexpr GUID container_format_netpbm{0x70ab66f5, 0xcd48, 0x43a1, {0xaa, 0x29, 0x10, 0x13, 0x1b, 0x7f, 0x4f, 0xf1}};
+
+
+TEST_CLASS(netpbm_bitmap_encoder_test)
+{
+public:
+    TEST_METHOD(GetContainerFormat) // NOLINT
+    {
+        GUID container_format;
+        const auto result{codec_factory_.create_encoder()->GetContainerFormat(&container_format)};
+
+        Assert::AreEqual(error_ok, result);
+        Assert::IsTrue(container_format_netpbm == container_format);
+    }
+
+    TEST_METHOD(CreateNewFrame_not_initialized) // NOLINT
+    {
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        const auto result{codec_factory_.create_encoder()->CreateNewFrame(frame_encode.put(), nullptr)};
+
+        Assert::AreEqual(wincodec::error_not_initialized, result);
+    }
+
+    TEST_METHOD(Commit_without_frame) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+        const auto result{encoder->Commit()};
+
+        Assert::AreEqual(wincodec::error_wrong_state, result);
+    }
+
+    TEST_METHOD(Commit_frame_with_missing_rows) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 2, 2, GUID_WICPixelFormat8bppGray)};
+
+        array<BYTE, 2> row{1, 2};
+        check_hresult(frame_encode->WritePixels(1, 2, 2, row.data()));
+        const auto result{frame_encode->Commit()};
+
+        Assert::AreEqual(wincodec::error_wrong_state, result);
+    }
+
+    TEST_METHOD(WritePixels_too_many_rows) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 2, 1, GUID_WICPixelFormat8bppGray)};
+
+        array<BYTE, 4> pixels{};
+        const auto result{frame_encode->WritePixels(2, 2, 4, pixels.data())};
+
+        Assert::AreEqual(wincodec::error_codec_too_many_scan_lines, result);
+    }
+
+    TEST_METHOD(encode_gray_8_bit) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 2, 2, GUID_WICPixelFormat8bppGray)};
+
+        // Rows with stride padding.
+        array<BYTE, 8> pixels{1, 2, 0xFF, 0xFF, 3, 4, 0xFF, 0xFF};
+        check_hresult(frame_encode->WritePixels(2, 4, static_cast<uint32_t>(pixels.size()), pixels.data()));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P5\n2 2\n255\n\x01\x02\x03\x04"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_gray_16_bit_is_big_endian) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{
+            create_frame_encode(encoder.get(), stream.get(), 2, 1, GUID_WICPixelFormat16bppGray)};
+
+        array<uint16_t, 2> pixels{0x0102, 0xFFFE};
+        check_hresult(frame_encode->WritePixels(1, 4, 4, reinterpret_cast<BYTE*>(pixels.data())));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P5\n2 1\n65535\n\x01\x02\xFF\xFE"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_bitmap) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{
+            create_frame_encode(encoder.get(), stream.get(), 10, 1, GUID_WICPixelFormatBlackWhite)};
+
+        // WIC uses 1 for white, PBM 1 for black. The padding bits are written as 0.
+        array<BYTE, 2> pixels{0xF0, 0x7F};
+        check_hresult(frame_encode->WritePixels(1, 2, 2, pixels.data()));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P4\n10 1\n\x0F\x80"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_gray_4_bit_with_max_value_15) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 3, 1, GUID_WICPixelFormat4bppGray)};
+
+        array<BYTE, 2> pixels{0x1F, 0x70};
+        check_hresult(frame_encode->WritePixels(1, 2, 2, pixels.data()));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P5\n3 1\n15\n\x01\x0F\x07"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_rgba_as_pam) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 2, 1, GUID_WICPixelFormat32bppRGBA)};
+
+        array<BYTE, 8> pixels{1, 2, 3, 4, 5, 6, 7, 8};
+        check_hresult(frame_encode->WritePixels(1, 8, 8, pixels.data()));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n"
+                                "\x01\x02\x03\x04\x05\x06\x07\x08"},
+                         read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_ascii_format) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{
+            create_ascii_frame_encode(encoder.get(), stream.get(), 3, 2, GUID_WICPixelFormat16bppGray)};
+
+        array<uint16_t, 6> pixels{0, 1, 65535, 10, 200, 3000};
+        check_hresult(frame_encode->WritePixels(2, 6, 12, reinterpret_cast<BYTE*>(pixels.data())));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P2\n3 2\n65535\n0 1 65535\n10 200 3000\n"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(encode_ascii_bitmap) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{
+            create_ascii_frame_encode(encoder.get(), stream.get(), 3, 1, GUID_WICPixelFormatBlackWhite)};
+
+        array<BYTE, 1> pixels{0b1010'0000};
+        check_hresult(frame_encode->WritePixels(1, 1, 1, pixels.data()));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        Assert::AreEqual(string{"P1\n3 1\n0 1 0\n"}, read_stream(stream.get()));
+    }
+
+    TEST_METHOD(WritePixels_buffer_too_small) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        const com_ptr frame_encode{create_frame_encode(encoder.get(), stream.get(), 2, 2, GUID_WICPixelFormat8bppGray)};
+
+        array<BYTE, 4> pixels{};
+        const auto result{frame_encode->WritePixels(2, 3, static_cast<uint32_t>(pixels.size()), pixels.data())};
+
+        Assert::AreEqual(wincodec::error_insufficient_buffer, result);
+    }
+
+    TEST_METHOD(SetPixelFormat_returns_closest_format) // NOLINT
+    {
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+        check_hresult(frame_encode->Initialize(nullptr));
+
+        GUID pixel_format{GUID_WICPixelFormat32bppBGRA};
+        check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+        Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == pixel_format);
+    }
+
+    TEST_METHOD(WriteSource_round_trip) // NOLINT
+    {
+        com_ptr<IStream> source_stream;
+        check_hresult(SHCreateStreamOnFileEx(L"tulips-gray-8bit-512-512.pgm", STGM_READ | STGM_SHARE_DENY_WRITE, 0,
+                                             false, nullptr, source_stream.put()));
+        const com_ptr decoder{codec_factory_.create_decoder()};
+        check_hresult(decoder->Initialize(source_stream.get(), WICDecodeMetadataCacheOnDemand));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(decoder->GetFrame(0, frame_decode.put()));
+
+        const com_ptr stream{create_output_stream()};
+        const com_ptr encoder{codec_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+        check_hresult(frame_encode->Initialize(nullptr));
+        check_hresult(frame_encode->WriteSource(frame_decode.get(), nullptr));
+        check_hresult(frame_encode->Commit());
+        check_hresult(encoder->Commit());
+
+        constexpr size_t pixel_count{512 * 512};
+        vector<char> expected(pixel_count);
+        check_hresult(frame_decode->CopyPixels(nullptr, 512, static_cast<uint32_t>(expected.size()),
+                                               reinterpret_cast<BYTE*>(expected.data())));
+        const string actual{read_stream(stream.get())};
+        Assert::AreEqual(string{"P5\n512 512\n255\n"}, actual.substr(0, actual.size() - pixel_count));
+        Assert::IsTrue(std::equal(expected.begin(), expected.end(), actual.end() - pixel_count));
+    }
+
+private:
+    [[nodiscard]] static com_ptr<IStream> create_output_stream()
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        return stream;
+    }
+
+    [[nodiscard]] static com_ptr<IWICBitmapFrameEncode> create_frame_encode(IWICBitmapEncoder* encoder, IStream* stream,
+                                                                            const uint32_t width, const uint32_t height,
+                                                                            GUID pixel_format)
+    {
+        check_hresult(encoder->Initialize(stream, WICBitmapEncoderNoCache));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+        check_hresult(frame_encode->Initialize(nullptr));
+        check_hresult(frame_encode->SetSize(width, height));
+        check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+        return frame_encode;
+    }
+
+    [[nodiscard]] static com_ptr<IWICBitmapFrameEncode> create_ascii_frame_encode(IWICBitmapEncoder* encoder,
+                                                                                  IStream* stream, const uint32_t width,
+                                                                                  const uint32_t height, GUID pixel_format)
+    {
+        check_hresult(encoder->Initialize(stream, WICBitmapEncoderNoCache));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        com_ptr<IPropertyBag2> encoder_options;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), encoder_options.put()));
+        PROPBAG2 option{};
+        option.pstrName = const_cast<LPOLESTR>(L"AsciiFormat");
+        VARIANT value{};
+        value.vt = VT_BOOL;
+        value.boolVal = VARIANT_TRUE;
+        check_hresult(encoder_options->Write(1, &option, &value));
+        check_hresult(frame_encode->Initialize(encoder_options.get()));
+        check_hresult(frame_encode->SetSize(width, height));
+        check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+        return frame_encode;
+    }
+
+    [[nodiscard]] static string read_stream(IStream* stream)
+    {
+        STATSTG statistics;
+        check_hresult(stream->Stat(&statistics, STATFLAG_NONAME));
+        check_hresult(stream->Seek({}, STREAM_SEEK_SET, nullptr));
+
+        string content(static_cast<size_t>(statistics.cbSize.QuadPart), '\0');
+        ULONG read;
+        check_hresult(stream->Read(content.data(), static_cast<ULONG>(content.size()), &read));
+        content.resize(read);
+
+        return content;
+    }
+
+    codec_factory codec_factory_;
+};
@@ -31,6 +31,25 @@ namespace {
     return {width, height};
 }
 
+/// <summary>
+/// Writes an 8-bit graymap of more than 1 MB to the temp folder: only files of at least 1 MB are memory mapped.
+/// </summary>
+[[nodiscard]] std::filesystem::path write_large_graymap()
+{
+    constexpr uint32_t width{1024};
+    constexpr uint32_t height{1025};
+    auto path{std::filesystem::temp_directory_path() / L"netpbm-wic-codec-test-large.pgm"};
+
+    std::ofstream file{path, std::ios::binary};
+    file << "P5\n" << width << ' ' << height << "\n255\n";
+    for (uint32_t i{}; i != width * height; ++i)
+    {
+        file.put(static_cast<char>(i % 251));
+    }
+
+    return path;
+}
+
 [[nodiscard]] vector<std::byte> unpack_crumbs(const std::byte* crumbs_pixels, const size_t width, const size_t height,
                                                    const size_t stride)
 {
@@ -47,20 +66,9 @@ namespace {
             destination[j++] = (crumbs_row[i] & std::byte{0x0C}) >> 2;
             destination[j++] = crumbs_row[i] & std::byte{0x03};
         }
-        switch (width % 4)
+        for (size_t k{}; k != width % 4; ++k)
         {
-        case 3:
-            destination[j++] = crumbs_row[i] >> 6;
-            [[fallthrough]];
-        case 2:
-            destination[j++] = (crumbs_row[i] & std::byte{0x30}) >> 4;
-            [[fallthrough]];
-        case 1:
-            destination[j++] = (crumbs_row[i] & std::byte{0x0C}) >> 2;
-            break;
-
-        default:
-            break;
+            destination[j++] = (crumbs_row[i] >> (6 - (2 * k))) & std::byte{0x03};
         }
     }
 
@@ -126,7 +134,82 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
 
         com_ptr<IWICBitmapSource> thumbnail;
         const auto result = bitmap_frame_decoder->GetThumbnail(thumbnail.put());
-        Assert::AreEqual(wincodec::error_codec_no_thumbnail, result);
+        Assert::AreEqual(error_ok, result);
+
+        uint32_t width;
+        uint32_t height;
+        check_hresult(thumbnail->GetSize(&width, &height));
+        Assert::AreEqual(256U, width);
+        Assert::AreEqual(256U, height);
+
+        GUID pixel_format;
+        check_hresult(thumbnail->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat8bppGray == pixel_format);
+
+        vector<std::byte> buffer(static_cast<size_t>(width) * height);
+        Assert::AreEqual(error_ok, thumbnail->CopyPixels(nullptr, width, static_cast<uint32_t>(buffer.size()),
+                                                         reinterpret_cast<BYTE*>(buffer.data())));
+    }
+
+    TEST_METHOD(GetThumbnail_16_bit_color) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"16bit_2x1.ppm")};
+
+        com_ptr<IWICBitmapSource> thumbnail;
+        check_hresult(bitmap_frame_decoder->GetThumbnail(thumbnail.put()));
+
+        // Small images are not scaled.
+        const com_ptr<IWICBitmapSource> bitmap_source(bitmap_frame_decoder);
+        vector<uint16_t> expected(6);
+        vector<uint16_t> actual(6);
+        check_hresult(bitmap_source->CopyPixels(nullptr, 12, 12, reinterpret_cast<BYTE*>(expected.data())));
+        check_hresult(thumbnail->CopyPixels(nullptr, 12, 12, reinterpret_cast<BYTE*>(actual.data())));
+        Assert::IsTrue(expected == actual);
+    }
+
+    TEST_METHOD(GetThumbnail_keeps_aspect_ratio) // NOLINT
+    {
+        for (const auto& [image_width, image_height, expected_width, expected_height] :
+             {array{4000U, 1U, 250U, 1U}, array{1U, 4000U, 1U, 250U}, array{1000U, 10U, 250U, 2U}})
+        {
+            std::string source{std::format("P5 {} {} 255 ", image_width, image_height)};
+            source.append(static_cast<size_t>(image_width) * image_height, '\x80');
+            const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+            com_ptr<IWICBitmapSource> thumbnail;
+            check_hresult(bitmap_frame_decoder->GetThumbnail(thumbnail.put()));
+
+            uint32_t width;
+            uint32_t height;
+            check_hresult(thumbnail->GetSize(&width, &height));
+            Assert::AreEqual(expected_width, width);
+            Assert::AreEqual(expected_height, height);
+
+            vector<std::byte> buffer(static_cast<size_t>(width) * height);
+            check_hresult(thumbnail->CopyPixels(nullptr, width, static_cast<uint32_t>(buffer.size()),
+                                                reinterpret_cast<BYTE*>(buffer.data())));
+            Assert::IsTrue(std::ranges::all_of(buffer, [](const std::byte value) { return value == std::byte{0x80}; }));
+        }
+    }
+
+    TEST_METHOD(GetThumbnail_averages_rows_of_band) // NOLINT
+    {
+        // 512 x 512 => 256 x 256: every thumbnail row averages 2 rows of 100 and 200.
+        constexpr size_t size{512};
+        std::string source{std::format("P5 {} {} 255 ", size, size)};
+        for (size_t row{}; row != size; ++row)
+        {
+            source.append(size, row % 2 == 0 ? '\x64' : '\xC8');
+        }
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        com_ptr<IWICBitmapSource> thumbnail;
+        check_hresult(bitmap_frame_decoder->GetThumbnail(thumbnail.put()));
+
+        vector<std::byte> buffer(static_cast<size_t>(256) * 256);
+        check_hresult(thumbnail->CopyPixels(nullptr, 256, static_cast<uint32_t>(buffer.size()),
+                                            reinterpret_cast<BYTE*>(buffer.data())));
+        Assert::IsTrue(std::ranges::all_of(buffer, [](const std::byte value) { return value == std::byte{150}; }));
     }
 
     TEST_METHOD(GetPixelFormat_8bit_image) // NOLINT
@@ -375,6 +458,255 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
         Assert::AreEqual(6, static_cast<int>(buffer[6]));
     }
 
+    TEST_METHOD(decode_bitmap) // NOLINT
+    {
+        // 10 x 2 pixels: 2 bytes per row, 1 is black.
+        std::string source{"P4\n10 2\n"};
+        source += "\xF0\xC0\x0F\x40";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormatBlackWhite == pixel_format);
+
+        constexpr uint32_t stride{4};
+        vector<std::byte> buffer(2 * stride);
+        Assert::AreEqual(error_ok, copy_pixels(bitmap_frame_decoder.get(), stride, buffer));
+
+        // WIC BlackWhite uses 1 for white. Only the first 2 bits of the second byte are pixels.
+        Assert::AreEqual(0x0F, static_cast<int>(buffer[0]));
+        Assert::AreEqual(0x3F, static_cast<int>(buffer[1]) | 0x3F);
+        Assert::AreEqual(0xF0, static_cast<int>(buffer[4]));
+        Assert::AreEqual(0x80, static_cast<int>(buffer[5]) & 0xC0);
+    }
+
+    TEST_METHOD(decode_bitmap_rectangle) // NOLINT
+    {
+        std::string source{"P4 10 2 "};
+        source += "\xF0\xC0\x0F\x40";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        // The rectangle starts in the middle of a byte: the pixels are shifted to the start of the destination byte.
+        constexpr WICRect rectangle{.X{2}, .Y{1}, .Width{8}, .Height{1}};
+        std::byte pixels{};
+        check_hresult(bitmap_frame_decoder->CopyPixels(&rectangle, 4, 1, reinterpret_cast<BYTE*>(&pixels)));
+
+        Assert::AreEqual(0xC2, static_cast<int>(pixels));
+    }
+
+    TEST_METHOD(decode_bitmap_rectangle_at_byte_boundary) // NOLINT
+    {
+        std::string source{"P4 10 2 "};
+        source += "\xF0\xC0\x0F\x40";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        constexpr WICRect rectangle{.X{8}, .Y{0}, .Width{2}, .Height{2}};
+        std::array<std::byte, 2> pixels{};
+        check_hresult(bitmap_frame_decoder->CopyPixels(&rectangle, 1, 2, reinterpret_cast<BYTE*>(pixels.data())));
+
+        Assert::AreEqual(0x00, static_cast<int>(pixels[0]) & 0xC0);
+        Assert::AreEqual(0x80, static_cast<int>(pixels[1]) & 0xC0);
+    }
+
+    TEST_METHOD(GetThumbnail_bitmap_is_gray) // NOLINT
+    {
+        std::string source{"P4 10 2 "};
+        source += "\xF0\xC0\x0F\x40";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        com_ptr<IWICBitmapSource> thumbnail;
+        check_hresult(bitmap_frame_decoder->GetThumbnail(thumbnail.put()));
+
+        GUID pixel_format;
+        check_hresult(thumbnail->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat8bppGray == pixel_format);
+    }
+
+    TEST_METHOD(decode_ascii_8_bit_color) // NOLINT
+    {
+        std::string text{"P3\n# plain pixmap\n2 2\n255\n1 2 3  4 5 6\n7 8 9\n10 11 12\n"};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(text.data(), text.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat24bppRGB == pixel_format);
+
+        constexpr uint32_t stride{8};
+        vector<std::byte> buffer(2 * stride);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), stride, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(1, static_cast<int>(buffer[0]));
+        Assert::AreEqual(6, static_cast<int>(buffer[5]));
+        Assert::AreEqual(7, static_cast<int>(buffer[8]));
+        Assert::AreEqual(12, static_cast<int>(buffer[13]));
+    }
+
+    TEST_METHOD(decode_ascii_12_bit_monochrome) // NOLINT
+    {
+        std::string text{"P2 3 1 4095 0 2048 4095"};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(text.data(), text.size())};
+
+        vector<uint16_t> buffer(3);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), 6, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(uint16_t{0}, buffer[0]);
+        Assert::AreEqual(uint16_t{32776}, buffer[1]); // 2048 * 65535 / 4095 = 32776.0
+        Assert::AreEqual(uint16_t{65535}, buffer[2]);
+    }
+
+    TEST_METHOD(decode_ascii_max_color_value_1000) // NOLINT
+    {
+        std::string text{"P2 3 1 1000 0 500 1000"};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(text.data(), text.size())};
+
+        vector<uint16_t> buffer(3);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), 6, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(uint16_t{0}, buffer[0]);
+        Assert::AreEqual(uint16_t{32768}, buffer[1]); // 500 * 65535 / 1000 = 32767.5
+        Assert::AreEqual(uint16_t{65535}, buffer[2]);
+    }
+
+    TEST_METHOD(decode_16_bit_max_color_value_4000) // NOLINT
+    {
+        std::string source{"P5 3 1 4000\n"};
+        source += std::string{"\x00\x00\x07\xD0\x0F\xA0", 6};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat16bppGray == pixel_format);
+
+        vector<uint16_t> buffer(3);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), 6, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(uint16_t{0}, buffer[0]);
+        Assert::AreEqual(uint16_t{32768}, buffer[1]); // 2000 * 65535 / 4000 = 32767.5
+        Assert::AreEqual(uint16_t{65535}, buffer[2]);
+    }
+
+    TEST_METHOD(decode_14_bit_monochrome) // NOLINT
+    {
+        // 14 bit has no matching shift in the WIC pixel formats: the samples are rescaled.
+        std::string source{"P5 2 1 16383\n"};
+        source += std::string{"\x20\x00\x3F\xFF", 4};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        vector<uint16_t> buffer(2);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), 4, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(uint16_t{32770}, buffer[0]); // 8192 * 65535 / 16383 = 32770.0
+        Assert::AreEqual(uint16_t{65535}, buffer[1]);
+    }
+
+    TEST_METHOD(decode_8_bit_color_max_color_value_100) // NOLINT
+    {
+        std::string source{"P6 1 1 100\n"};
+        source += std::string{"\x00\x32\x64", 3};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat24bppRGB == pixel_format);
+
+        vector<std::byte> buffer(4);
+        const auto result{copy_pixels(bitmap_frame_decoder.get(), 4, buffer)};
+        Assert::AreEqual(error_ok, result);
+
+        Assert::AreEqual(0, std::to_integer<int>(buffer[0]));
+        Assert::AreEqual(128, std::to_integer<int>(buffer[1])); // 50 * 255 / 100 = 127.5
+        Assert::AreEqual(255, std::to_integer<int>(buffer[2]));
+    }
+
+    TEST_METHOD(decode_ascii_value_above_max_color_value) // NOLINT
+    {
+        std::string text{"P2 2 1 15 15 16\n"};
+        const com_ptr stream{create_memory_stream(text)};
+        const com_ptr wic_bitmap_decoder{factory_.create_decoder()};
+        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+        const auto result{wic_bitmap_decoder->GetFrame(0, bitmap_frame_decode.put())};
+        Assert::AreEqual(wincodec::error_bad_stream_data, result);
+    }
+
+    TEST_METHOD(decode_arbitrary_map_rgb_alpha) // NOLINT
+    {
+        std::string source{"P7\nWIDTH 2\nHEIGHT 1\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n"};
+        source += "\x01\x02\x03\x04\x05\x06\x07\x08";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == pixel_format);
+
+        constexpr uint32_t stride{8};
+        vector<std::byte> buffer(stride);
+        Assert::AreEqual(error_ok, copy_pixels(bitmap_frame_decoder.get(), stride, buffer));
+
+        for (size_t i{}; i != buffer.size(); ++i)
+        {
+            Assert::AreEqual(static_cast<int>(i + 1), static_cast<int>(buffer[i]));
+        }
+    }
+
+    TEST_METHOD(decode_arbitrary_map_gray_alpha_16_bit) // NOLINT
+    {
+        // Without TUPLTYPE, a depth of 2 is gray + alpha.
+        std::string source{"P7\nWIDTH 1\nHEIGHT 1\nDEPTH 2\nMAXVAL 65535\nENDHDR\n"};
+        source += "\x12\x34\xAB\xCD";
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat64bppRGBA == pixel_format);
+
+        vector<uint16_t> buffer(4);
+        check_hresult(bitmap_frame_decoder->CopyPixels(nullptr, 8, 8, reinterpret_cast<BYTE*>(buffer.data())));
+
+        Assert::AreEqual(0x1234, static_cast<int>(buffer[0]));
+        Assert::AreEqual(0x1234, static_cast<int>(buffer[1]));
+        Assert::AreEqual(0x1234, static_cast<int>(buffer[2]));
+        Assert::AreEqual(0xABCD, static_cast<int>(buffer[3]));
+    }
+
+    TEST_METHOD(decode_arbitrary_map_gray_alpha_12_bit) // NOLINT
+    {
+        // 12-bit samples are rescaled to 16 bits: 4095 becomes 65535 (a shift would give 65520).
+        std::string source{"P7\nWIDTH 1\nHEIGHT 1\nDEPTH 2\nMAXVAL 4095\nTUPLTYPE GRAYSCALE_ALPHA\nENDHDR\n"};
+        source.append("\x0F\xFF\x08\x00", 4);
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        GUID pixel_format;
+        check_hresult(bitmap_frame_decoder->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat64bppRGBA == pixel_format);
+
+        vector<uint16_t> buffer(4);
+        check_hresult(bitmap_frame_decoder->CopyPixels(nullptr, 8, 8, reinterpret_cast<BYTE*>(buffer.data())));
+
+        Assert::AreEqual(65535, static_cast<int>(buffer[0]));
+        Assert::AreEqual(65535, static_cast<int>(buffer[1]));
+        Assert::AreEqual(65535, static_cast<int>(buffer[2]));
+        Assert::AreEqual(32776, static_cast<int>(buffer[3]));
+    }
+
+    TEST_METHOD(decode_arbitrary_map_with_wrong_depth) // NOLINT
+    {
+        std::string source{"P7\nWIDTH 1\nHEIGHT 1\nDEPTH 3\nMAXVAL 255\nTUPLTYPE GRAYSCALE\nENDHDR\n\x01\x02\x03"};
+        const com_ptr stream{create_memory_stream(source)};
+        const com_ptr wic_bitmap_decoder{factory_.create_decoder()};
+        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+
+        com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+        const auto result{wic_bitmap_decoder->GetFrame(0, bitmap_frame_decode.put())};
+        Assert::AreEqual(wincodec::error_bad_header, result);
+    }
+
     TEST_METHOD(decode_16_bit_color) // NOLINT
     {
         const com_ptr bitmap_frame_decoder{create_frame_decoder(L"16bit_2x1.ppm")};
@@ -440,7 +772,383 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
         Assert::AreEqual(60, static_cast<int>(buffer[13]));
     }
 
+    TEST_METHOD(CopyPixels_rectangle_on_demand_equals_on_load) // NOLINT
+    {
+        copy_pixels_rectangle_on_demand_equals_on_load(L"tulips-gray-8bit-512-512.pgm", 8);
+        copy_pixels_rectangle_on_demand_equals_on_load(L"2bit_parrot_150x200.pgm", 2);
+        copy_pixels_rectangle_on_demand_equals_on_load(L"640_480_16bit.pgm", 16);
+        copy_pixels_rectangle_on_demand_equals_on_load(L"jpegls-conformance-test-8bit-256-256.ppm", 24);
+    }
+
+    TEST_METHOD(CopyPixels_on_load_repeated) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{
+            create_frame_decoder(L"tulips-gray-8bit-512-512.pgm", WICDecodeMetadataCacheOnLoad)};
+
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        vector<std::byte> first(static_cast<size_t>(width) * height);
+        vector<std::byte> second(first.size());
+
+        // The first call is decoded directly, the repeated call is served from the cache.
+        Assert::AreEqual(error_ok, copy_pixels(bitmap_frame_decoder.get(), width, first));
+        Assert::AreEqual(error_ok, copy_pixels(bitmap_frame_decoder.get(), width, second));
+
+        compare("tulips-gray-8bit-512-512.pgm", first);
+        Assert::IsTrue(first == second);
+    }
+
+    TEST_METHOD(CopyPixels_on_load_tiles_of_same_rows) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{
+            create_frame_decoder(L"tulips-gray-8bit-512-512.pgm", WICDecodeMetadataCacheOnLoad)};
+
+        // Tiles side by side share rows but no pixels: each tile is decoded directly.
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        const int32_t half_width{static_cast<int32_t>(width / 2)};
+        const int32_t tile_height{static_cast<int32_t>(height)};
+        vector<std::byte> buffer(static_cast<size_t>(width) * height);
+        for (const WICRect tile : {WICRect{.X{0}, .Y{0}, .Width{half_width}, .Height{tile_height}},
+                                   WICRect{.X{half_width}, .Y{0}, .Width{half_width}, .Height{tile_height}}})
+        {
+            check_hresult(bitmap_frame_decoder->CopyPixels(&tile, width, static_cast<uint32_t>(buffer.size() - tile.X),
+                                                           reinterpret_cast<BYTE*>(buffer.data() + tile.X)));
+        }
+
+        compare("tulips-gray-8bit-512-512.pgm", buffer);
+    }
+
+    TEST_METHOD(GetFrame_on_load_truncated_pixel_data) // NOLINT
+    {
+        std::string source{"P5 2 2 255 \x01\x02\x03"};
+
+        // Decoded on demand, the truncated pixel data is only detected by CopyPixels.
+        const com_ptr on_demand{factory_.create_decoder()};
+        check_hresult(on_demand->Initialize(create_memory_stream(source).get(), WICDecodeMetadataCacheOnDemand));
+        com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+        check_hresult(on_demand->GetFrame(0, bitmap_frame_decode.put()));
+
+        const com_ptr on_load{factory_.create_decoder()};
+        check_hresult(on_load->Initialize(create_memory_stream(source).get(), WICDecodeMetadataCacheOnLoad));
+        const auto result{on_load->GetFrame(0, bitmap_frame_decode.put())};
+        Assert::AreEqual(wincodec::error_bad_stream_data, result);
+    }
+
+    TEST_METHOD(IsIWICBitmapSourceTransform) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.pgm")};
+
+        const auto source_transform{bitmap_frame_decoder.as<IWICBitmapSourceTransform>()};
+
+        uint32_t width{100};
+        uint32_t height{200};
+        check_hresult(source_transform->GetClosestSize(&width, &height));
+        Assert::AreEqual(256U, width);
+        Assert::AreEqual(256U, height);
+
+        BOOL supported;
+        check_hresult(source_transform->DoesSupportTransform(WICBitmapTransformRotate90, &supported));
+        Assert::IsTrue(supported != FALSE);
+    }
+
+    TEST_METHOD(CopyPixels_transform_scaled) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.pgm")};
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        vector<std::byte> pixels(static_cast<size_t>(width) * height);
+        check_hresult(copy_pixels(bitmap_frame_decoder.get(), width, pixels));
+
+        constexpr uint32_t factor{4};
+        const uint32_t scaled_width{width / factor};
+        const uint32_t scaled_height{height / factor};
+        vector<BYTE> scaled(static_cast<size_t>(scaled_width) * scaled_height);
+        GUID pixel_format{GUID_WICPixelFormat8bppGray};
+        check_hresult(bitmap_frame_decoder.as<IWICBitmapSourceTransform>()->CopyPixels(
+            nullptr, scaled_width, scaled_height, &pixel_format, WICBitmapTransformRotate0, scaled_width,
+            static_cast<uint32_t>(scaled.size()), scaled.data()));
+
+        for (size_t y{}; y != scaled_height; ++y)
+        {
+            for (size_t x{}; x != scaled_width; ++x)
+            {
+                uint32_t sum{};
+                for (size_t i{}; i != factor; ++i)
+                {
+                    for (size_t j{}; j != factor; ++j)
+                    {
+                        sum += std::to_integer<uint32_t>(pixels[((y * factor + i) * width) + (x * factor) + j]);
+                    }
+                }
+
+                Assert::AreEqual((sum + 8) / 16, static_cast<uint32_t>(scaled[(y * scaled_width) + x]));
+            }
+        }
+    }
+
+    TEST_METHOD(CopyPixels_transform_rotate_and_flip) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"jpegls-conformance-test-8bit-256-256.ppm")};
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        constexpr WICRect rectangle{.X{3}, .Y{5}, .Width{7}, .Height{11}};
+
+        for (const auto transform : {WICBitmapTransformRotate90, WICBitmapTransformRotate180, WICBitmapTransformRotate270,
+                                     WICBitmapTransformFlipHorizontal, WICBitmapTransformFlipVertical})
+        {
+            copy_pixels_transform_equals_flip_rotator(bitmap_frame_decoder.get(), width, height, rectangle, transform);
+        }
+
+        // Combined: the flip is applied after the rotation.
+        for (const auto [rotation, flip] : {std::pair{WICBitmapTransformRotate90, WICBitmapTransformFlipHorizontal},
+                                            std::pair{WICBitmapTransformRotate180, WICBitmapTransformFlipHorizontal},
+                                            std::pair{WICBitmapTransformRotate270, WICBitmapTransformFlipVertical}})
+        {
+            copy_pixels_transform_equals_flip_rotator(bitmap_frame_decoder.get(), width, height, rectangle,
+                                                      static_cast<WICBitmapTransformOptions>(rotation | flip));
+        }
+    }
+
+    TEST_METHOD(CopyPixels_transform_clip_bitmap) // NOLINT
+    {
+        std::string source{"P4 16 2 \xF0\x0F\xAA\x55"};
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(source.data(), source.size())};
+
+        // A clip without other transformations is decoded directly, it must equal IWICBitmapSource::CopyPixels.
+        constexpr WICRect rectangle{.X{8}, .Y{1}, .Width{8}, .Height{1}};
+        constexpr uint32_t stride{4};
+        std::array<BYTE, stride> expected{};
+        check_hresult(bitmap_frame_decoder->CopyPixels(&rectangle, stride, stride, expected.data()));
+
+        std::array<BYTE, stride> actual{};
+        check_hresult(bitmap_frame_decoder.as<IWICBitmapSourceTransform>()->CopyPixels(
+            &rectangle, 16, 2, nullptr, WICBitmapTransformRotate0, stride, stride, actual.data()));
+
+        Assert::AreEqual(expected[0], actual[0]);
+    }
+
+    TEST_METHOD(GetClosestPixelFormat_16_bit_to_8_bit) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"640_480_16bit.pgm")};
+        const auto source_transform{bitmap_frame_decoder.as<IWICBitmapSourceTransform>()};
+
+        GUID pixel_format{GUID_WICPixelFormat8bppGray};
+        check_hresult(source_transform->GetClosestPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat8bppGray == pixel_format);
+
+        pixel_format = GUID_WICPixelFormat32bppBGRA;
+        check_hresult(source_transform->GetClosestPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat16bppGray == pixel_format);
+    }
+
+    TEST_METHOD(CopyPixels_transform_16_bit_to_8_bit) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"640_480_16bit.pgm")};
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        vector<uint16_t> pixels(static_cast<size_t>(width) * height);
+        check_hresult(copy_pixels(bitmap_frame_decoder.get(), width * 2, pixels));
+
+        vector<BYTE> actual(pixels.size());
+        GUID pixel_format{GUID_WICPixelFormat8bppGray};
+        check_hresult(bitmap_frame_decoder.as<IWICBitmapSourceTransform>()->CopyPixels(
+            nullptr, width, height, &pixel_format, WICBitmapTransformRotate0, width, static_cast<uint32_t>(actual.size()),
+            actual.data()));
+
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            Assert::AreEqual((pixels[i] * 255U + 32767U) / 65535U, static_cast<uint32_t>(actual[i]));
+        }
+    }
+
+    TEST_METHOD(CopyPixels_transform_rgb_to_bgra) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"jpegls-conformance-test-8bit-256-256.ppm")};
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        vector<std::byte> rgb(static_cast<size_t>(width) * height * 3);
+        check_hresult(copy_pixels(bitmap_frame_decoder.get(), width * 3, rgb));
+
+        const auto source_transform{bitmap_frame_decoder.as<IWICBitmapSourceTransform>()};
+        GUID pixel_format{GUID_WICPixelFormat32bppBGRA};
+        check_hresult(source_transform->GetClosestPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat32bppBGRA == pixel_format);
+
+        vector<BYTE> bgra(static_cast<size_t>(width) * height * 4);
+        check_hresult(source_transform->CopyPixels(nullptr, width, height, &pixel_format, WICBitmapTransformRotate0,
+                                                   width * 4, static_cast<uint32_t>(bgra.size()), bgra.data()));
+
+        for (size_t i{}; i != static_cast<size_t>(width) * height; ++i)
+        {
+            Assert::AreEqual(std::to_integer<int>(rgb[(i * 3) + 2]), static_cast<int>(bgra[i * 4]));
+            Assert::AreEqual(std::to_integer<int>(rgb[(i * 3) + 1]), static_cast<int>(bgra[(i * 4) + 1]));
+            Assert::AreEqual(std::to_integer<int>(rgb[i * 3]), static_cast<int>(bgra[(i * 4) + 2]));
+            Assert::AreEqual(255, static_cast<int>(bgra[(i * 4) + 3]));
+        }
+    }
+
+    TEST_METHOD(CopyPixels_transform_rgb_to_bgr_equals_format_converter) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"jpegls-conformance-test-8bit-256-256.ppm")};
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+
+        com_ptr<IWICBitmapSource> converter;
+        check_hresult(WICConvertBitmapSource(GUID_WICPixelFormat24bppBGR, bitmap_frame_decoder.get(), converter.put()));
+        vector<BYTE> expected(static_cast<size_t>(width) * height * 3);
+        check_hresult(converter->CopyPixels(nullptr, width * 3, static_cast<uint32_t>(expected.size()), expected.data()));
+
+        GUID pixel_format{GUID_WICPixelFormat24bppBGR};
+        vector<BYTE> actual(expected.size());
+        check_hresult(bitmap_frame_decoder.as<IWICBitmapSourceTransform>()->CopyPixels(
+            nullptr, width, height, &pixel_format, WICBitmapTransformRotate0, width * 3,
+            static_cast<uint32_t>(actual.size()), actual.data()));
+        Assert::IsTrue(expected == actual);
+    }
+
+    TEST_METHOD(CopyPixels_mapped_file_equals_memory_stream) // NOLINT
+    {
+        copy_pixels_mapped_file_equals_memory_stream(L"640_480_16bit.pgm", 16);
+        copy_pixels_mapped_file_equals_memory_stream(L"2bit_parrot_150x200.pgm", 2);
+        copy_pixels_mapped_file_equals_memory_stream(L"jpegls-conformance-test-8bit-256-256.ppm", 24);
+
+        // The test images above are smaller than 1 MB and are read through the read buffer.
+        const auto path{write_large_graymap()};
+        copy_pixels_mapped_file_equals_memory_stream(path.c_str(), 8);
+        std::filesystem::remove(path);
+    }
+
+    TEST_METHOD(CopyPixels_releases_mapped_file) // NOLINT
+    {
+        // While a view of the file is mapped, the file can't be truncated: the view is only kept during CopyPixels.
+        const auto path{write_large_graymap()};
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(path.c_str(), STGM_READ | STGM_SHARE_DENY_NONE, 0, false, nullptr,
+                                                 stream.put()));
+            const com_ptr wic_bitmap_decoder{factory_.create_decoder()};
+            check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+            com_ptr<IWICBitmapFrameDecode> bitmap_frame_decoder;
+            check_hresult(wic_bitmap_decoder->GetFrame(0, bitmap_frame_decoder.put()));
+
+            constexpr WICRect rectangle{.X{0}, .Y{1}, .Width{2}, .Height{1}};
+            array<BYTE, 2> buffer{};
+            check_hresult(bitmap_frame_decoder->CopyPixels(&rectangle, static_cast<uint32_t>(buffer.size()),
+                                                           static_cast<uint32_t>(buffer.size()), buffer.data()));
+            Assert::AreEqual(BYTE{1024 % 251}, buffer[0]);
+
+            std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        }
+        std::filesystem::remove(path);
+    }
+
+    TEST_METHOD(CopyPixels_rectangle_outside_image) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.pgm")};
+
+        constexpr WICRect rectangle{.X{500}, .Y{0}, .Width{13}, .Height{1}};
+        array<BYTE, 13> buffer{};
+        const auto result{bitmap_frame_decoder->CopyPixels(&rectangle, static_cast<uint32_t>(buffer.size()),
+                                                           static_cast<uint32_t>(buffer.size()), buffer.data())};
+        Assert::AreEqual(error_invalid_argument, result);
+    }
+
+    TEST_METHOD(CopyPixels_buffer_too_small) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.pgm")};
+
+        constexpr WICRect rectangle{.X{0}, .Y{0}, .Width{10}, .Height{2}};
+        array<BYTE, 19> buffer{};
+        const auto result{
+            bitmap_frame_decoder->CopyPixels(&rectangle, 10, static_cast<uint32_t>(buffer.size()), buffer.data())};
+        Assert::AreEqual(wincodec::error_insufficient_buffer, result);
+    }
+
+    TEST_METHOD(CopyPixels_buffer_size_overflow) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.pgm")};
+
+        // 2 * stride wraps around to 0 in a 32-bit size_t.
+        constexpr WICRect rectangle{.X{0}, .Y{0}, .Width{10}, .Height{3}};
+        array<BYTE, 19> buffer{};
+        const auto result{bitmap_frame_decoder->CopyPixels(&rectangle, 0x80000000, static_cast<uint32_t>(buffer.size()),
+                                                           buffer.data())};
+        Assert::AreEqual(wincodec::error_insufficient_buffer, result);
+    }
+
 private:
+    static void copy_pixels_transform_equals_flip_rotator(IWICBitmapFrameDecode* bitmap_frame_decoder,
+                                                          const uint32_t width, const uint32_t height,
+                                                          const WICRect& rectangle,
+                                                          const WICBitmapTransformOptions transform)
+    {
+        const bool rotated{transform == WICBitmapTransformRotate90 || transform == WICBitmapTransformRotate270};
+        const uint32_t stride{static_cast<uint32_t>(rotated ? rectangle.Height : rectangle.Width) * 3};
+        const size_t buffer_size{static_cast<size_t>(stride) * (rotated ? rectangle.Width : rectangle.Height)};
+
+        com_ptr<IWICBitmapClipper> clipper;
+        check_hresult(imaging_factory()->CreateBitmapClipper(clipper.put()));
+        check_hresult(clipper->Initialize(bitmap_frame_decoder, &rectangle));
+        com_ptr<IWICBitmapFlipRotator> flip_rotator;
+        check_hresult(imaging_factory()->CreateBitmapFlipRotator(flip_rotator.put()));
+        check_hresult(flip_rotator->Initialize(clipper.get(), transform));
+        vector<BYTE> expected(buffer_size);
+        check_hresult(flip_rotator->CopyPixels(nullptr, stride, static_cast<uint32_t>(expected.size()), expected.data()));
+
+        com_ptr<IWICBitmapSourceTransform> source_transform;
+        check_hresult(bitmap_frame_decoder->QueryInterface(IID_PPV_ARGS(source_transform.put())));
+        vector<BYTE> actual(buffer_size);
+        check_hresult(source_transform->CopyPixels(&rectangle, width, height, nullptr, transform, stride,
+                                                   static_cast<uint32_t>(actual.size()), actual.data()));
+
+        Assert::IsTrue(expected == actual);
+    }
+
+    void copy_pixels_rectangle_on_demand_equals_on_load(_Null_terminated_ const wchar_t* filename,
+                                                         const uint32_t bits_per_pixel) const
+    {
+        const com_ptr on_demand{create_frame_decoder(filename, WICDecodeMetadataCacheOnDemand)};
+        const com_ptr on_load{create_frame_decoder(filename, WICDecodeMetadataCacheOnLoad)};
+
+        // Note: use byte aligned rectangles, as the unused bits of packed pixels are not defined.
+        const auto [width, height]{get_size(*on_demand)};
+        const auto aligned_width{static_cast<int32_t>((width - 16) & ~7U)};
+        for (const WICRect rectangle : {WICRect{.X{0}, .Y{0}, .Width{static_cast<int32_t>(width)}, .Height{3}},
+                                        WICRect{.X{8}, .Y{7}, .Width{aligned_width}, .Height{11}},
+                                        WICRect{.X{8}, .Y{static_cast<int32_t>(height) - 1}, .Width{8}, .Height{1}}})
+        {
+            const uint32_t stride{((static_cast<uint32_t>(rectangle.Width) * bits_per_pixel) + 31) / 32 * 4};
+            vector<BYTE> expected(static_cast<size_t>(stride) * rectangle.Height);
+            vector<BYTE> actual(expected.size());
+
+            check_hresult(on_load->CopyPixels(&rectangle, stride, static_cast<uint32_t>(expected.size()), expected.data()));
+            check_hresult(on_demand->CopyPixels(&rectangle, stride, static_cast<uint32_t>(actual.size()), actual.data()));
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    void copy_pixels_mapped_file_equals_memory_stream(_Null_terminated_ const wchar_t* filename,
+                                                      const uint32_t bits_per_pixel) const
+    {
+        // File streams are decoded from a memory mapped view of the file, memory streams through the read buffer.
+        std::ifstream file{filename, std::ios::binary};
+        vector<char> file_bytes{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+        const com_ptr memory_stream_decoder{create_frame_decoder(file_bytes.data(), file_bytes.size())};
+        const com_ptr mapped_file_decoder{create_frame_decoder(filename)};
+
+        const auto [width, height]{get_size(*mapped_file_decoder)};
+        for (const WICRect rectangle : {WICRect{.X{0}, .Y{0}, .Width{static_cast<int32_t>(width)},
+                                                .Height{static_cast<int32_t>(height)}},
+                                        WICRect{.X{8}, .Y{7}, .Width{16}, .Height{11}}})
+        {
+            const uint32_t stride{((static_cast<uint32_t>(rectangle.Width) * bits_per_pixel) + 31) / 32 * 4};
+            vector<BYTE> expected(static_cast<size_t>(stride) * rectangle.Height);
+            vector<BYTE> actual(expected.size());
+
+            check_hresult(memory_stream_decoder->CopyPixels(&rectangle, stride, static_cast<uint32_t>(expected.size()),
+                                                            expected.data()));
+            check_hresult(mapped_file_decoder->CopyPixels(&rectangle, stride, static_cast<uint32_t>(actual.size()),
+                                                          actual.data()));
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
     void decode_2_bit_monochrome(_Null_terminated_ const wchar_t* filename_actual, const char* filename_expected) const
     {
         const com_ptr bitmap_frame_decoder{create_frame_decoder(filename_actual)};
@@ -487,13 +1195,15 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
         compare(filename_expected, buffer);
     }
 
-    [[nodiscard]] com_ptr<IWICBitmapFrameDecode> create_frame_decoder(_Null_terminated_ const wchar_t* filename) const
+    [[nodiscard]] com_ptr<IWICBitmapFrameDecode> create_frame_decoder(
+        _Null_terminated_ const wchar_t* filename,
+        const WICDecodeOptions cache_options = WICDecodeMetadataCacheOnDemand) const
     {
         com_ptr<IStream> stream;
         check_hresult(SHCreateStreamOnFileEx(filename, STGM_READ | STGM_SHARE_DENY_WRITE, 0, false, nullptr, stream.put()));
 
         const com_ptr wic_bitmap_decoder{factory_.create_decoder()};
-        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), cache_options));
 
         com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
         check_hresult(wic_bitmap_decoder->GetFrame(0, bitmap_frame_decode.put()));
@@ -536,10 +1246,10 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
                                    static_cast<BYTE*>(data));
     }
 
-    constexpr static void convert_to_little_endian_and_shift(span<uint16_t> samples, const uint32_t sample_shift) noexcept
+    constexpr static void convert_to_little_endian_and_rescale(span<uint16_t> samples, const uint32_t max_value) noexcept
     {
-        std::ranges::transform(samples, samples.begin(), [sample_shift](const uint16_t sample) noexcept -> uint16_t {
-            return _byteswap_ushort(sample) << sample_shift;
+        std::ranges::transform(samples, samples.begin(), [max_value](const uint16_t sample) noexcept -> uint16_t {
+            return static_cast<uint16_t>(((_byteswap_ushort(sample) * 65535U) + (max_value / 2)) / max_value);
         });
     }
 
@@ -564,7 +1274,7 @@ TEST_CLASS(netpbm_bitmap_frame_decode_test)
         auto& expected_pixels{anymap_file.image_data()};
 
         const span expected{reinterpret_cast<uint16_t*>(expected_pixels.data()), expected_pixels.size() / sizeof uint16_t};
-        convert_to_little_endian_and_shift(expected, 16 - anymap_file.bits_per_sample());
+        convert_to_little_endian_and_rescale(expected, (1U << anymap_file.bits_per_sample()) - 1);
 
         for (size_t i{}; i < pixels.size(); ++i)
         {
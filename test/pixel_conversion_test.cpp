@@ -0,0 +1,555 @@
+// Copyright (c) Team CharLS.
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "cpp_unit_test.hpp"
+
+import std;
+
+import pixel_conversion;
+
+using std::array;
+using std::byte;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint8_t;
+using std::vector;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace {
+
+[[nodiscard]] vector<byte> create_pixels(const size_t width, const uint8_t max_value)
+{
+    vector<byte> pixels(width);
+    std::mt19937 generator{static_cast<uint32_t>(width)};
+    std::uniform_int_distribution<uint32_t> distribution{0, max_value};
+    std::ranges::generate(pixels, [&] { return static_cast<byte>(distribution(generator)); });
+
+    return pixels;
+}
+
+} // namespace
+
+
+TEST_CLASS(pixel_conversion_test)
+{
+public:
+    TEST_METHOD(pack_row_to_crumbs_tail) // NOLINT
+    {
+        constexpr array pixels{byte{1}, byte{2}, byte{3}, byte{0}, byte{2}, byte{1}};
+        array<byte, 2> crumbs{};
+
+        pack_row_to_crumbs(pixels.data(), crumbs.data(), pixels.size());
+
+        Assert::AreEqual(0x6C, static_cast<int>(crumbs[0]));
+        Assert::AreEqual(0x90, static_cast<int>(crumbs[1]));
+    }
+
+    TEST_METHOD(pack_row_to_crumbs_equals_scalar) // NOLINT
+    {
+        for (size_t width{}; width != 300; ++width)
+        {
+            const auto pixels{create_pixels(width, 3)};
+            vector<byte> expected((width + 3) / 4);
+            vector<byte> actual(expected.size());
+
+            scalar::pack_row_to_crumbs(pixels.data(), expected.data(), width);
+            pack_row_to_crumbs(pixels.data(), actual.data(), width);
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(pack_row_to_nibbles_tail) // NOLINT
+    {
+        constexpr array pixels{byte{1}, byte{15}, byte{7}};
+        array<byte, 2> nibbles{};
+
+        pack_row_to_nibbles(pixels.data(), nibbles.data(), pixels.size());
+
+        Assert::AreEqual(0x1F, static_cast<int>(nibbles[0]));
+        Assert::AreEqual(0x70, static_cast<int>(nibbles[1]));
+    }
+
+    TEST_METHOD(pack_row_to_nibbles_equals_scalar) // NOLINT
+    {
+        for (size_t width{}; width != 300; ++width)
+        {
+            const auto pixels{create_pixels(width, 15)};
+            vector<byte> expected((width + 1) / 2);
+            vector<byte> actual(expected.size());
+
+            scalar::pack_row_to_nibbles(pixels.data(), expected.data(), width);
+            pack_row_to_nibbles(pixels.data(), actual.data(), width);
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(pack_to_crumbs_with_stride) // NOLINT
+    {
+        constexpr size_t width{37};
+        constexpr size_t height{3};
+        constexpr size_t stride{12};
+        const auto pixels{create_pixels(width * height, 3)};
+        vector<byte> crumbs(stride * height);
+
+        pack_to_crumbs(pixels, crumbs.data(), width, height, stride);
+
+        for (size_t row{}; row != height; ++row)
+        {
+            array<byte, stride> expected{};
+            scalar::pack_row_to_crumbs(pixels.data() + (row * width), expected.data(), width);
+            Assert::IsTrue(
+                std::equal(expected.begin(), expected.begin() + ((width + 3) / 4), crumbs.begin() + (row * stride)));
+        }
+    }
+
+    TEST_METHOD(unpack_row_reverses_pack_row) // NOLINT
+    {
+        for (size_t width{}; width != 40; ++width)
+        {
+            const auto crumb_pixels{create_pixels(width, 3)};
+            vector<byte> crumbs((width + 3) / 4);
+            vector<byte> unpacked_crumbs(width);
+            pack_row_to_crumbs(crumb_pixels.data(), crumbs.data(), width);
+            unpack_row(crumbs.data(), unpacked_crumbs.data(), width, 2);
+
+            const auto nibble_pixels{create_pixels(width, 15)};
+            vector<byte> nibbles((width + 1) / 2);
+            vector<byte> unpacked_nibbles(width);
+            pack_row_to_nibbles(nibble_pixels.data(), nibbles.data(), width);
+            unpack_row(nibbles.data(), unpacked_nibbles.data(), width, 4);
+
+            Assert::IsTrue(crumb_pixels == unpacked_crumbs);
+            Assert::IsTrue(nibble_pixels == unpacked_nibbles);
+        }
+    }
+
+    TEST_METHOD(unpack_row_1_bit) // NOLINT
+    {
+        constexpr array bits{byte{0b1010'0001}, byte{0b1100'0000}};
+        array<byte, 10> pixels{};
+
+        unpack_row(bits.data(), pixels.data(), pixels.size(), 1);
+
+        constexpr array expected{byte{1}, byte{0}, byte{1}, byte{0}, byte{0}, byte{0}, byte{0}, byte{1}, byte{1}, byte{1}};
+        Assert::IsTrue(expected == pixels);
+    }
+
+    TEST_METHOD(convert_to_little_endian_in_place) // NOLINT
+    {
+        array<uint16_t, 3> samples{};
+        constexpr array big_endian{byte{0x01}, byte{0x02}, byte{0x03}, byte{0xFF}, byte{0x00}, byte{0x80}};
+        std::memcpy(samples.data(), big_endian.data(), big_endian.size());
+
+        convert_to_little_endian(samples);
+
+        Assert::AreEqual(static_cast<uint16_t>(0x0102), samples[0]);
+        Assert::AreEqual(static_cast<uint16_t>(0x03FF), samples[1]);
+        Assert::AreEqual(static_cast<uint16_t>(0x0080), samples[2]);
+    }
+
+    TEST_METHOD(convert_to_little_endian_equals_scalar) // NOLINT
+    {
+        for (size_t sample_count{}; sample_count != 100; ++sample_count)
+        {
+            const auto big_endian_samples{create_pixels(sample_count * 2, 255)};
+            vector<uint16_t> expected(sample_count);
+            vector<uint16_t> actual(sample_count);
+
+            scalar::convert_to_little_endian(big_endian_samples.data(), expected.data(), sample_count);
+            convert_to_little_endian(big_endian_samples.data(), actual.data(), sample_count);
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(convert_to_8_bit_and_rescale_rounds) // NOLINT
+    {
+        constexpr array big_endian{byte{0x00}, byte{0x00}, byte{0x01}, byte{0xF4}, byte{0x01}, byte{0xF3},
+                                   byte{0x03}, byte{0xE8}, byte{0xFF}, byte{0xFF}};
+        array<byte, 5> samples{};
+
+        convert_to_8_bit_and_rescale(big_endian.data(), samples.data(), samples.size(), 1000);
+
+        Assert::AreEqual(0, static_cast<int>(samples[0]));
+        Assert::AreEqual(128, static_cast<int>(samples[1])); // 500 * 255 / 1000 = 127.5
+        Assert::AreEqual(127, static_cast<int>(samples[2]));
+        Assert::AreEqual(255, static_cast<int>(samples[3]));
+        Assert::AreEqual(255, static_cast<int>(samples[4])); // Above the maximum value.
+    }
+
+    TEST_METHOD(convert_to_8_bit_and_rescale_equals_scalar) // NOLINT
+    {
+        for (const uint32_t max_value : {256U, 1023U, 1000U, 4095U, 65535U})
+        {
+            for (size_t sample_count{}; sample_count != 100; ++sample_count)
+            {
+                const auto big_endian_samples{create_pixels(sample_count * 2, 255)};
+                vector<byte> expected(sample_count);
+                vector<byte> actual(sample_count);
+
+                scalar::convert_to_8_bit_and_rescale(big_endian_samples.data(), expected.data(), sample_count,
+                                                     max_value);
+                convert_to_8_bit_and_rescale(big_endian_samples.data(), actual.data(), sample_count, max_value);
+
+                Assert::IsTrue(expected == actual);
+            }
+        }
+    }
+
+    TEST_METHOD(convert_to_little_endian_and_rescale_rounds) // NOLINT
+    {
+        constexpr array big_endian{byte{0x00}, byte{0x00}, byte{0x00}, byte{0x01}, byte{0x01}, byte{0xF4},
+                                   byte{0x03}, byte{0xE8}, byte{0xFF}, byte{0xFF}};
+        array<uint16_t, 5> samples{};
+
+        convert_to_little_endian_and_rescale(big_endian.data(), samples.data(), samples.size(), 1000);
+
+        Assert::AreEqual(uint16_t{0}, samples[0]);
+        Assert::AreEqual(uint16_t{66}, samples[1]);    // 65.535
+        Assert::AreEqual(uint16_t{32768}, samples[2]); // 32767.5
+        Assert::AreEqual(uint16_t{65535}, samples[3]);
+        Assert::AreEqual(uint16_t{65535}, samples[4]); // Above the maximum value.
+    }
+
+    TEST_METHOD(convert_to_little_endian_and_rescale_equals_scalar) // NOLINT
+    {
+        for (const uint32_t max_value : {256U, 1000U, 4000U, 16383U, 65534U})
+        {
+            for (size_t sample_count{}; sample_count != 100; ++sample_count)
+            {
+                const auto big_endian_samples{create_pixels(sample_count * 2, 255)};
+                vector<uint16_t> expected(sample_count);
+                vector<uint16_t> actual(sample_count);
+
+                scalar::convert_to_little_endian_and_rescale(big_endian_samples.data(), expected.data(), sample_count,
+                                                             max_value);
+                convert_to_little_endian_and_rescale(big_endian_samples.data(), actual.data(), sample_count,
+                                                     max_value);
+
+                Assert::IsTrue(expected == actual);
+            }
+        }
+    }
+
+    TEST_METHOD(convert_to_little_endian_and_rescale_is_exact) // NOLINT
+    {
+        for (const uint32_t max_value : {1000U, 4000U, 4095U, 16383U})
+        {
+            vector<byte> big_endian_samples((max_value + 1) * 2);
+            for (uint32_t value{}; value <= max_value; ++value)
+            {
+                big_endian_samples[value * 2] = static_cast<byte>(value >> 8);
+                big_endian_samples[(value * 2) + 1] = static_cast<byte>(value);
+            }
+            vector<uint16_t> samples(max_value + 1);
+
+            convert_to_little_endian_and_rescale(big_endian_samples.data(), samples.data(), samples.size(), max_value);
+
+            for (uint32_t value{}; value <= max_value; ++value)
+            {
+                const auto expected{static_cast<uint16_t>(((value * 65535ULL) + (max_value / 2)) / max_value)};
+                Assert::AreEqual(expected, samples[value]);
+            }
+        }
+    }
+
+    TEST_METHOD(rescale_8_bit_equals_scalar) // NOLINT
+    {
+        for (const uint32_t max_value : {1U, 2U, 100U, 200U, 254U})
+        {
+            for (size_t sample_count{}; sample_count != 100; ++sample_count)
+            {
+                auto samples{create_pixels(sample_count, 255)};
+                vector<byte> expected(sample_count);
+                vector<byte> actual(sample_count);
+
+                scalar::rescale_8_bit(samples.data(), expected.data(), sample_count, max_value);
+                rescale_8_bit(samples.data(), actual.data(), sample_count, max_value);
+                Assert::IsTrue(expected == actual);
+
+                rescale_8_bit(samples.data(), samples.data(), sample_count, max_value);
+                Assert::IsTrue(expected == samples);
+            }
+        }
+    }
+
+    TEST_METHOD(swap_red_and_blue_equals_scalar) // NOLINT
+    {
+        for (size_t pixel_count{}; pixel_count != 100; ++pixel_count)
+        {
+            auto rgb{create_pixels(pixel_count * 3, 255)};
+            vector<byte> expected(rgb.size());
+            vector<byte> actual(rgb.size());
+
+            scalar::swap_red_and_blue(rgb.data(), expected.data(), pixel_count);
+            swap_red_and_blue(rgb.data(), actual.data(), pixel_count);
+            Assert::IsTrue(expected == actual);
+
+            swap_red_and_blue(rgb.data(), rgb.data(), pixel_count);
+            Assert::IsTrue(expected == rgb);
+        }
+    }
+
+    TEST_METHOD(expand_rgb_to_bgra_equals_scalar) // NOLINT
+    {
+        for (size_t pixel_count{}; pixel_count != 100; ++pixel_count)
+        {
+            const auto rgb{create_pixels(pixel_count * 3, 255)};
+            vector<byte> expected(pixel_count * 4);
+            vector<byte> actual(pixel_count * 4);
+
+            scalar::expand_rgb_to_bgra(rgb.data(), expected.data(), pixel_count);
+            expand_rgb_to_bgra(rgb.data(), actual.data(), pixel_count);
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(expand_rgb_to_bgra_is_opaque) // NOLINT
+    {
+        constexpr array rgb{byte{1}, byte{2}, byte{3}};
+        array<byte, 4> bgra{};
+
+        expand_rgb_to_bgra(rgb.data(), bgra.data(), 1);
+
+        Assert::AreEqual(3, static_cast<int>(bgra[0]));
+        Assert::AreEqual(2, static_cast<int>(bgra[1]));
+        Assert::AreEqual(1, static_cast<int>(bgra[2]));
+        Assert::AreEqual(255, static_cast<int>(bgra[3]));
+    }
+
+    TEST_METHOD(invert_bits_equals_scalar) // NOLINT
+    {
+        for (size_t size{}; size != 100; ++size)
+        {
+            auto bits{create_pixels(size, 255)};
+            vector<byte> expected(size);
+            vector<byte> actual(size);
+
+            scalar::invert_bits(bits.data(), expected.data(), size);
+            invert_bits(bits.data(), actual.data(), size);
+            Assert::IsTrue(expected == actual);
+
+            invert_bits(bits.data(), bits.data(), size);
+            Assert::IsTrue(expected == bits);
+        }
+    }
+
+    TEST_METHOD(shift_and_invert_bits_moves_pixels_to_byte_boundary) // NOLINT
+    {
+        for (size_t bit_offset{1}; bit_offset != 8; ++bit_offset)
+        {
+            for (size_t pixel_count{1}; pixel_count != 40; ++pixel_count)
+            {
+                const auto bits{create_pixels((bit_offset + pixel_count + 7) / 8, 255)};
+                vector<byte> actual((pixel_count + 7) / 8);
+
+                shift_and_invert_bits(bits.data(), actual.data(), bit_offset, pixel_count);
+
+                for (size_t pixel{}; pixel != pixel_count; ++pixel)
+                {
+                    const size_t bit{bit_offset + pixel};
+                    const bool black{(bits[bit / 8] & (byte{0x80} >> (bit % 8))) != byte{}};
+                    const bool white{(actual[pixel / 8] & (byte{0x80} >> (pixel % 8))) != byte{}};
+                    Assert::AreNotEqual(black, white);
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(expand_bits_to_gray_equals_scalar) // NOLINT
+    {
+        for (size_t width{}; width != 100; ++width)
+        {
+            const auto bits{create_pixels((width + 7) / 8, 255)};
+            vector<byte> expected(width);
+            vector<byte> actual(width);
+
+            scalar::expand_bits_to_gray(bits.data(), expected.data(), width);
+            expand_bits_to_gray(bits.data(), actual.data(), width);
+
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(expand_bits_to_gray_black_is_zero) // NOLINT
+    {
+        constexpr array bits{byte{0b1010'0000}};
+        array<byte, 3> gray{};
+
+        expand_bits_to_gray(bits.data(), gray.data(), gray.size());
+
+        Assert::AreEqual(0, static_cast<int>(gray[0]));
+        Assert::AreEqual(255, static_cast<int>(gray[1]));
+        Assert::AreEqual(0, static_cast<int>(gray[2]));
+    }
+
+    TEST_METHOD(expand_gray_alpha_to_rgba_equals_scalar) // NOLINT
+    {
+        // 300 pixels: more than the 256 pixel stack buffer used for rescaled samples.
+        for (const auto [max_value, max_value_16_bit] : {std::pair{255U, 65535U}, std::pair{100U, 4095U}})
+        {
+            for (size_t pixel_count{}; pixel_count != 300; pixel_count += pixel_count < 100 ? 1 : 100)
+            {
+                const auto gray_alpha{create_pixels(pixel_count * 2, static_cast<uint8_t>(max_value))};
+                vector<uint16_t> big_endian_gray_alpha(pixel_count * 2);
+                for (size_t i{}; i != big_endian_gray_alpha.size(); ++i)
+                {
+                    const auto sample{static_cast<uint16_t>((i * 1021) % (max_value_16_bit + 1))};
+                    big_endian_gray_alpha[i] = static_cast<uint16_t>((sample >> 8) | (sample << 8));
+                }
+                vector<byte> expected(pixel_count * 4);
+                vector<byte> actual(pixel_count * 4);
+                vector<uint16_t> expected_16_bit(pixel_count * 4);
+                vector<uint16_t> actual_16_bit(pixel_count * 4);
+                const auto* big_endian{reinterpret_cast<const byte*>(big_endian_gray_alpha.data())};
+
+                scalar::expand_gray_alpha_to_rgba(gray_alpha.data(), expected.data(), pixel_count, max_value);
+                expand_gray_alpha_to_rgba(gray_alpha.data(), actual.data(), pixel_count, max_value);
+                scalar::expand_big_endian_gray_alpha_to_rgba(big_endian, expected_16_bit.data(), pixel_count,
+                                                             max_value_16_bit);
+                expand_big_endian_gray_alpha_to_rgba(big_endian, actual_16_bit.data(), pixel_count, max_value_16_bit);
+
+                Assert::IsTrue(expected == actual);
+                Assert::IsTrue(expected_16_bit == actual_16_bit);
+            }
+        }
+    }
+
+    TEST_METHOD(expand_gray_alpha_to_rgba_copies_gray) // NOLINT
+    {
+        constexpr array gray_alpha{byte{10}, byte{20}};
+        array<byte, 4> rgba{};
+
+        expand_gray_alpha_to_rgba(gray_alpha.data(), rgba.data(), 1, 255);
+
+        Assert::AreEqual(10, static_cast<int>(rgba[0]));
+        Assert::AreEqual(10, static_cast<int>(rgba[1]));
+        Assert::AreEqual(10, static_cast<int>(rgba[2]));
+        Assert::AreEqual(20, static_cast<int>(rgba[3]));
+    }
+
+    TEST_METHOD(accumulate_row_equals_scalar) // NOLINT
+    {
+        for (size_t sample_count{}; sample_count != 100; ++sample_count)
+        {
+            const auto samples{create_pixels(sample_count * 2, 255)};
+            vector<uint32_t> expected(sample_count, 7);
+            vector<uint32_t> actual(sample_count, 7);
+
+            scalar::accumulate_row(samples.data(), expected.data(), sample_count);
+            accumulate_row(samples.data(), actual.data(), sample_count);
+            Assert::IsTrue(expected == actual);
+
+            scalar::accumulate_big_endian_row(samples.data(), expected.data(), sample_count);
+            accumulate_big_endian_row(samples.data(), actual.data(), sample_count);
+            Assert::IsTrue(expected == actual);
+        }
+    }
+
+    TEST_METHOD(average_row_equals_scalar) // NOLINT
+    {
+        // 1 to 4 samples per pixel, power of 2 sizes use the SIMD kernels, 3 uses the scalar code only.
+        for (size_t samples_per_pixel{1}; samples_per_pixel != 5; ++samples_per_pixel)
+        {
+            for (const auto [factor, row_count] : {std::pair{2U, 2U}, std::pair{4U, 1U}, std::pair{8U, 8U},
+                                                   std::pair{3U, 3U}, std::pair{4U, 3U}})
+            {
+                for (size_t width{}; width != 20; ++width)
+                {
+                    vector<uint32_t> sums(width * factor * samples_per_pixel);
+                    for (size_t i{}; i != sums.size(); ++i)
+                    {
+                        sums[i] = static_cast<uint32_t>((i * 7919) % ((65535 * row_count) + 1));
+                    }
+                    vector<uint32_t> sums_8_bit(sums.size());
+                    std::ranges::transform(sums, sums_8_bit.begin(),
+                                           [row_count](const uint32_t sum) { return sum % ((255 * row_count) + 1); });
+                    vector<byte> expected(width * samples_per_pixel * 2);
+                    vector<byte> actual(width * samples_per_pixel * 2);
+
+                    scalar::average_row(sums_8_bit.data(), expected.data(), width, samples_per_pixel, factor,
+                                        row_count);
+                    average_row(sums_8_bit.data(), actual.data(), width, samples_per_pixel, factor, row_count);
+                    Assert::IsTrue(expected == actual);
+
+                    scalar::average_big_endian_row(sums.data(), expected.data(), width, samples_per_pixel, factor,
+                                                   row_count);
+                    average_big_endian_row(sums.data(), actual.data(), width, samples_per_pixel, factor, row_count);
+                    Assert::IsTrue(expected == actual);
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(average_row_box_filter) // NOLINT
+    {
+        // Vertical sums of 2 rows, 4 pixels wide => 2 pixels.
+        constexpr array<uint32_t, 4> sums{1, 2, 510, 508};
+        array<byte, 2> destination{};
+
+        average_row(sums.data(), destination.data(), destination.size(), 1, 2, 2);
+
+        Assert::AreEqual(1, static_cast<int>(destination[0]));
+        Assert::AreEqual(255, static_cast<int>(destination[1]));
+    }
+
+    TEST_METHOD(average_big_endian_row_box_filter) // NOLINT
+    {
+        constexpr array<uint32_t, 2> sums{0x1FFFE, 0x1FFFC};
+        array<byte, 2> destination{};
+
+        average_big_endian_row(sums.data(), destination.data(), 1, 1, 2, 2);
+
+        Assert::AreEqual(0xFF, static_cast<int>(destination[0]));
+        Assert::AreEqual(0xFF, static_cast<int>(destination[1]));
+    }
+
+    TEST_METHOD(average_row_of_1_row_rounds_average) // NOLINT
+    {
+        constexpr array source{byte{1}, byte{2}, byte{10}, byte{20}, byte{255}, byte{254}};
+        array<uint32_t, 6> sums{};
+        array<byte, 3> destination{};
+
+        accumulate_row(source.data(), sums.data(), sums.size());
+        average_row(sums.data(), destination.data(), destination.size(), 1, 2, 1);
+
+        Assert::AreEqual(2, static_cast<int>(destination[0]));
+        Assert::AreEqual(15, static_cast<int>(destination[1]));
+        Assert::AreEqual(255, static_cast<int>(destination[2]));
+    }
+
+    TEST_METHOD(average_big_endian_row_of_1_row_rgb) // NOLINT
+    {
+        // 2 RGB pixels into 1, samples stored big endian.
+        constexpr array source{byte{0x01}, byte{0x00}, byte{0xFF}, byte{0xFF}, byte{0x00}, byte{0x00},
+                               byte{0x03}, byte{0x00}, byte{0xFF}, byte{0xFD}, byte{0x00}, byte{0x01}};
+        array<uint32_t, 6> sums{};
+        array<byte, 6> destination{};
+
+        accumulate_big_endian_row(source.data(), sums.data(), sums.size());
+        average_big_endian_row(sums.data(), destination.data(), 1, 3, 2, 1);
+
+        Assert::AreEqual(0x02, static_cast<int>(destination[0]));
+        Assert::AreEqual(0x00, static_cast<int>(destination[1]));
+        Assert::AreEqual(0xFF, static_cast<int>(destination[2]));
+        Assert::AreEqual(0xFE, static_cast<int>(destination[3]));
+        Assert::AreEqual(0x00, static_cast<int>(destination[4]));
+        Assert::AreEqual(0x01, static_cast<int>(destination[5]));
+    }
+
+    TEST_METHOD(average_row_box_filter_3_by_2) // NOLINT
+    {
+        // Thumbnail boxes are not a power of 2: vertical sums of 2 rows, 3 pixels wide => 1 pixel.
+        constexpr array<uint32_t, 3> sums{2, 3, 4};
+        array<byte, 1> destination{};
+
+        average_row(sums.data(), destination.data(), destination.size(), 1, 3, 2);
+
+        Assert::AreEqual(2, static_cast<int>(destination[0]));
+    }
+};
@@ -34,7 +34,7 @@ TEST_CLASS(pnm_header_test)
         const com_ptr stream{create_memory_stream(initial_values)};
 
         const bool result{is_pnm_file(stream.get())};
-        Assert::IsFalse(result);
+        Assert::IsTrue(result);
     }
 
     TEST_METHOD(is_pnm_file_for_p3) // NOLINT
@@ -43,7 +43,7 @@ TEST_CLASS(pnm_header_test)
         const com_ptr stream{create_memory_stream(initial_values)};
 
         const bool result{is_pnm_file(stream.get())};
-        Assert::IsFalse(result);
+        Assert::IsTrue(result);
     }
 
     TEST_METHOD(is_pnm_file_for_p4) // NOLINT
@@ -52,7 +52,7 @@ TEST_CLASS(pnm_header_test)
         const com_ptr stream{create_memory_stream(initial_values)};
 
         const bool result{is_pnm_file(stream.get())};
-        Assert::IsFalse(result);
+        Assert::IsTrue(result);
     }
 
     TEST_METHOD(is_pnm_file_for_p5) // NOLINT
@@ -78,6 +78,15 @@ TEST_CLASS(pnm_header_test)
         constexpr array initial_values{byte{'P'}, byte{'7'}};
         const com_ptr stream{create_memory_stream(initial_values)};
 
+        const bool result{is_pnm_file(stream.get())};
+        Assert::IsTrue(result);
+    }
+
+    TEST_METHOD(is_pnm_file_for_p8) // NOLINT
+    {
+        constexpr array initial_values{byte{'P'}, byte{'8'}};
+        const com_ptr stream{create_memory_stream(initial_values)};
+
         const bool result{is_pnm_file(stream.get())};
         Assert::IsFalse(result);
     }